@@ -0,0 +1,323 @@
+#include "Analysis.h"
+#include "Builtins.h"
+#include "Tokenizer.h"
+#include "Functions.h"
+
+#include <unordered_map>
+
+namespace expr
+{
+	void GetChildPointers(Node* node, std::vector<Node**>& out)
+	{
+		switch (node->GetNodeType()) {
+		case NodeType::BinaryExpression: {
+			BinaryExpressionNode* bexpr = (BinaryExpressionNode*)node;
+			out.push_back(&bexpr->Left);
+			out.push_back(&bexpr->Right);
+		} break;
+		case NodeType::TernaryExpression: {
+			TernaryExpressionNode* texpr = (TernaryExpressionNode*)node;
+			out.push_back(&texpr->Condition);
+			out.push_back(&texpr->OnTrue);
+			out.push_back(&texpr->OnFalse);
+		} break;
+		case NodeType::UnaryExpression:
+			out.push_back(&((UnaryExpressionNode*)node)->Child);
+			break;
+		case NodeType::Cast:
+			out.push_back(&((CastNode*)node)->Object);
+			break;
+		case NodeType::MethodCall:
+			out.push_back(&((MethodCallNode*)node)->Object);
+			// fallthrough
+		case NodeType::FunctionCall: {
+			FunctionCallNode* fcall = (FunctionCallNode*)node;
+			for (auto& arg : fcall->Arguments)
+				out.push_back(&arg);
+		} break;
+		case NodeType::MemberAccess:
+			out.push_back(&((MemberAccessNode*)node)->Object);
+			break;
+		case NodeType::ArrayAccess: {
+			ArrayAccessNode* aaccess = (ArrayAccessNode*)node;
+			out.push_back(&aaccess->Object);
+			for (auto& index : aaccess->Indices)
+				out.push_back(&index);
+		} break;
+		default: break;
+		}
+	}
+	void GetChildren(Node* node, std::vector<Node*>& out)
+	{
+		std::vector<Node**> ptrs;
+		GetChildPointers(node, ptrs);
+		for (Node** ptr : ptrs)
+			out.push_back(*ptr);
+	}
+
+	static void m_countReferences(Node* node, std::unordered_map<Node*, int>& refs)
+	{
+		// only walk the children of a node the first time we see it
+		if (refs[node]++ > 0)
+			return;
+
+		std::vector<Node*> children;
+		GetChildren(node, children);
+		for (Node* child : children)
+			m_countReferences(child, refs);
+	}
+	void GetSharedNodes(Node* root, std::unordered_set<Node*>& out)
+	{
+		std::unordered_map<Node*, int> refs;
+		if (root != nullptr)
+			m_countReferences(root, refs);
+
+		for (const auto& ref : refs)
+			if (ref.second > 1)
+				out.insert(ref.first);
+	}
+
+	static void m_getVariables(Node* node, std::unordered_set<Node*>& visited, std::unordered_set<std::string>& names, std::vector<std::string>& out)
+	{
+		if (!visited.insert(node).second)
+			return;
+
+		if (node->GetNodeType() == NodeType::Identifier) {
+			const char* name = ((IdentifierNode*)node)->Name;
+			if (names.insert(name).second)
+				out.push_back(name);
+			return;
+		}
+
+		std::vector<Node*> children;
+		GetChildren(node, children);
+		for (Node* child : children)
+			m_getVariables(child, visited, names, out);
+	}
+	void GetVariables(Node* root, std::vector<std::string>& out)
+	{
+		std::unordered_set<Node*> visited;
+		std::unordered_set<std::string> names;
+		if (root != nullptr)
+			m_getVariables(root, visited, names, out);
+	}
+
+	bool IsPure(Node* node)
+	{
+		switch (node->GetNodeType()) {
+		case NodeType::MethodCall:
+			return false;
+		case NodeType::FunctionCall: {
+			// user functions from the shader module might have side effects
+			FunctionCallNode* fcall = (FunctionCallNode*)node;
+			return fcall->TokenType != TokenType_Identifier || fcall->BuiltinID != Builtin_None;
+		} break;
+		default: break;
+		}
+		return true;
+	}
+
+	bool CanFail(Node* root)
+	{
+		if (root == nullptr)
+			return false;
+
+		// out of range indices read 0 (see ApplyIndex), so only impure nodes can fail
+		if (!IsPure(root))
+			return true;
+
+		std::vector<Node*> children;
+		GetChildren(root, children);
+		for (Node* child : children)
+			if (CanFail(child))
+				return true;
+		return false;
+	}
+
+	static bool m_resolveType(Node* node, const std::unordered_map<std::string, ValueType>& variables, std::unordered_map<Node*, ValueType>& types, ValueType& out)
+	{
+		ValueType a, b, c;
+
+		switch (node->GetNodeType()) {
+		case NodeType::FloatLiteral: out = ValueType::Float; return true;
+		case NodeType::IntegerLiteral: out = ValueType::Int; return true;
+		case NodeType::BooleanLiteral: out = ValueType::Bool; return true;
+		case NodeType::Identifier: {
+			auto it = variables.find(((IdentifierNode*)node)->Name);
+			if (it == variables.end())
+				return false;
+			out = it->second;
+			return true;
+		} break;
+		case NodeType::BinaryExpression: {
+			BinaryExpressionNode* bexpr = (BinaryExpressionNode*)node;
+			return ResolveType(bexpr->Left, variables, types, a) && ResolveType(bexpr->Right, variables, types, b) &&
+				ResolveBinaryType(bexpr->Operator, a, b, c, out);
+		} break;
+		case NodeType::UnaryExpression: {
+			UnaryExpressionNode* uexpr = (UnaryExpressionNode*)node;
+			return ResolveType(uexpr->Child, variables, types, a) && ResolveUnaryType(uexpr->Operator, a, out);
+		} break;
+		case NodeType::TernaryExpression: {
+			// see ApplySelect()
+			TernaryExpressionNode* texpr = (TernaryExpressionNode*)node;
+			if (!ResolveType(texpr->Condition, variables, types, c) || GetBaseType(c) != ValueType::Bool || IsMatrix(c) ||
+				!ResolveType(texpr->OnTrue, variables, types, a) || !ResolveType(texpr->OnFalse, variables, types, b))
+				return false;
+			if (a == b) {
+				out = a;
+				return true;
+			}
+			if (IsScalar(a) != IsScalar(b) || !ResolveBinaryType('+', a, b, c, out))
+				return false;
+			out = GetSameShape(a, c);
+			return true;
+		} break;
+		case NodeType::Cast: {
+			// see ApplyCast()
+			CastNode* cast = (CastNode*)node;
+			if (!GetTokenValueType(cast->Type, c) || !ResolveType(cast->Object, variables, types, a))
+				return false;
+			if (!IsScalar(c)) {
+				out = c;
+				return true;
+			}
+			if (IsMatrix(a) && c != ValueType::Float)
+				return false;
+			out = GetSameShape(a, c);
+			return true;
+		} break;
+		case NodeType::FunctionCall: {
+			FunctionCallNode* fcall = (FunctionCallNode*)node;
+			ValueType args[16];
+			if (fcall->Arguments.size() > 16)
+				return false;
+			for (size_t i = 0; i < fcall->Arguments.size(); i++)
+				if (!ResolveType(fcall->Arguments[i], variables, types, args[i]))
+					return false;
+
+			if (GetTokenValueType(fcall->TokenType, out))
+				return !fcall->Arguments.empty();
+
+			NativeFunction func = GetNativeFunction((Builtin)fcall->BuiltinID);
+			return func != nullptr && ResolveFunctionType(func, args, (int)fcall->Arguments.size(), out);
+		} break;
+		case NodeType::MemberAccess: {
+			MemberAccessNode* maccess = (MemberAccessNode*)node;
+			if (!ResolveType(maccess->Object, variables, types, a) || IsMatrix(a) || maccess->SwizzleCount == 0)
+				return false;
+			out = GetVectorType(GetBaseType(a), maccess->SwizzleCount);
+			return true;
+		} break;
+		case NodeType::ArrayAccess: {
+			ArrayAccessNode* aaccess = (ArrayAccessNode*)node;
+			if (!ResolveType(aaccess->Object, variables, types, a))
+				return false;
+			for (Node* index : aaccess->Indices) {
+				if (!ResolveType(index, variables, types, b) || !IsScalar(b) || (GetBaseType(b) != ValueType::Int && GetBaseType(b) != ValueType::Uint))
+					return false;
+				if (IsMatrix(a)) a = GetVectorType(ValueType::Float, GetRowCount(a));
+				else if (IsVector(a)) a = GetBaseType(a);
+				else return false;
+			}
+			out = a;
+			return true;
+		} break;
+		default: break;
+		}
+		return false;
+	}
+	bool ResolveType(Node* node, const std::unordered_map<std::string, ValueType>& variables, std::unordered_map<Node*, ValueType>& types, ValueType& out)
+	{
+		auto it = types.find(node);
+		if (it != types.end()) {
+			out = it->second;
+			return true;
+		}
+
+		if (!m_resolveType(node, variables, types, out))
+			return false;
+		types[node] = out;
+		return true;
+	}
+
+	static int m_getCost(Node* node)
+	{
+		switch (node->GetNodeType()) {
+		case NodeType::BinaryExpression: {
+			int op = ((BinaryExpressionNode*)node)->Operator;
+			return (op == '/' || op == '%') ? 4 : 1;
+		} break;
+		case NodeType::TernaryExpression:
+		case NodeType::UnaryExpression:
+		case NodeType::Cast:
+		case NodeType::ArrayAccess:
+			return 1;
+		case NodeType::MethodCall:
+			return 32;
+		case NodeType::FunctionCall: {
+			FunctionCallNode* fcall = (FunctionCallNode*)node;
+			if (fcall->TokenType != TokenType_Identifier)
+				return 1;
+
+			switch (fcall->BuiltinID) {
+			case Builtin_None: return 16; // user function
+			case Builtin_Texture: return 32;
+			case Builtin_Inverse: return 24;
+			case Builtin_Determinant:
+			case Builtin_Sin: case Builtin_Cos: case Builtin_Tan:
+			case Builtin_Asin: case Builtin_Acos: case Builtin_Atan:
+			case Builtin_Sinh: case Builtin_Cosh: case Builtin_Tanh:
+			case Builtin_Asinh: case Builtin_Acosh: case Builtin_Atanh:
+			case Builtin_Pow: case Builtin_Exp: case Builtin_Exp2: case Builtin_Log: case Builtin_Log2:
+				return 8;
+			case Builtin_Sqrt: case Builtin_InverseSqrt: case Builtin_Length: case Builtin_Distance: case Builtin_Normalize:
+				return 4;
+			default: break;
+			}
+			return 2;
+		} break;
+		default: break;
+		}
+		return 0;
+	}
+	static int m_estimateCost(Node* node, std::unordered_set<Node*>& visited)
+	{
+		if (!visited.insert(node).second)
+			return 0;
+
+		std::vector<Node*> children;
+		GetChildren(node, children);
+
+		int cost = m_getCost(node);
+		for (Node* child : children)
+			cost += m_estimateCost(child, visited);
+		return cost;
+	}
+	int EstimateCost(Node* root)
+	{
+		std::unordered_set<Node*> visited;
+		return root ? m_estimateCost(root, visited) : 0;
+	}
+
+	bool UsesDerivatives(Node* root)
+	{
+		if (root == nullptr)
+			return false;
+
+		if (root->GetNodeType() == NodeType::MethodCall) // Sample() & co.
+			return true;
+		if (root->GetNodeType() == NodeType::FunctionCall) {
+			const BuiltinInfo* info = GetBuiltinInfo((Builtin)((FunctionCallNode*)root)->BuiltinID);
+			if (info != nullptr && (info->Signature == BuiltinSignature::Derivative || info->Signature == BuiltinSignature::Texture))
+				return true;
+		}
+
+		std::vector<Node*> children;
+		GetChildren(root, children);
+		for (Node* child : children)
+			if (UsesDerivatives(child))
+				return true;
+		return false;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+#include "Node.h"
+
+#include <vector>
+#include <string>
+#include <unordered_set>
+#include <unordered_map>
+
+namespace expr
+{
+	// pointers to the child slots of a node, so passes can replace children in place
+	void GetChildPointers(Node* node, std::vector<Node**>& out);
+	void GetChildren(Node* node, std::vector<Node*>& out);
+
+	// nodes that are referenced more than once - the AST turns into a DAG after common
+	// subexpression elimination and evaluators should compute these only once
+	void GetSharedNodes(Node* root, std::unordered_set<Node*>& out);
+
+	// names of the variables the expression reads, in the order they first appear - only
+	// nodes reachable from the root count, passes can leave pruned nodes in the parser's list
+	void GetVariables(Node* root, std::vector<std::string>& out);
+
+	// true if evaluating the node itself (not its children) has no side effects
+	bool IsPure(Node* node);
+
+	// true if the subtree can fail for some inputs and not for others (user functions, method
+	// calls) - such a subtree must not run before the conditions that guard it
+	bool CanFail(Node* root);
+
+	// result type of the subtree under the native evaluators' rules, without evaluating it -
+	// used for the branches that short circuiting skips. types caches the resolved nodes and
+	// has to be cleared when a variable changes its type
+	bool ResolveType(Node* node, const std::unordered_map<std::string, ValueType>& variables, std::unordered_map<Node*, ValueType>& types, ValueType& out);
+
+	// rough cost of evaluating the subtree, shared nodes are only counted once
+	int EstimateCost(Node* root);
+
+	// true if the subtree uses derivatives (ddx, implicit lod texture sampling, ...) - these
+	// need all invocations of a quad and can't be moved into non-uniform control flow
+	bool UsesDerivatives(Node* root);
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+#include <math.h>
+#include <limits>
+#include <type_traits>
+
+namespace expr
+{
+	// scalar kernels of the operators that can trap or are undefined for some integer inputs -
+	// the evaluators, the constant folder and VectorMath.h all go through these so that an
+	// expression typed into a watch window can never take the host down:
+	//		x / 0 and x % 0 are 0, INT_MIN / -1 wraps to INT_MIN and INT_MIN % -1 is 0
+	//		% follows the sign of the divisor (OpSMod), float % is OpFMod
+	//		shift counts are masked to the width of the type, like x86 does it
+	template<typename T> inline T ScalarDivide(T a, T b)
+	{
+		if constexpr (std::is_integral<T>::value) {
+			if (b == 0)
+				return 0;
+			if constexpr (std::is_signed<T>::value)
+				if (b == -1 && a == std::numeric_limits<T>::min())
+					return a;
+			return a / b;
+		} else
+			return a / b;
+	}
+	template<typename T> inline T ScalarModulo(T a, T b)
+	{
+		if constexpr (std::is_same<T, bool>::value)
+			return false;
+		else if constexpr (std::is_integral<T>::value) {
+			if (b == 0)
+				return 0;
+			if constexpr (std::is_signed<T>::value)
+				if (b == -1)
+					return 0;
+			T r = a % b;
+			if (std::is_signed<T>::value && r != 0 && ((r < 0) != (b < 0)))
+				r += b;
+			return r;
+		} else
+			return a - b * floorf(a / b);
+	}
+	template<typename T> inline T ScalarShiftLeft(T a, T b)
+	{
+		if constexpr (std::is_same<T, bool>::value || !std::is_integral<T>::value)
+			return T(0);
+		else {
+			// shifting the unsigned bits keeps negative values defined
+			typedef typename std::make_unsigned<T>::type Bits;
+			return T(Bits(a) << (int(b) & (int(sizeof(T)) * 8 - 1)));
+		}
+	}
+	template<typename T> inline T ScalarShiftRight(T a, T b)
+	{
+		if constexpr (std::is_same<T, bool>::value || !std::is_integral<T>::value)
+			return T(0);
+		else
+			return T(a >> (int(b) & (int(sizeof(T)) * 8 - 1))); // arithmetic for signed types
+	}
+}
\ No newline at end of file
@@ -0,0 +1,454 @@
+#include "BatchEvaluator.h"
+#include "Functions.h"
+#include "Analysis.h"
+#include "Tokenizer.h"
+
+#include <chrono>
+#include <algorithm>
+
+namespace expr
+{
+	BatchEvaluator::BatchEvaluator(Node* root)
+	{
+		m_root = root;
+		m_laneCount = 0;
+		m_isProfiling = false;
+		m_childTime = 0.0;
+
+		if (root != nullptr) {
+			std::unordered_set<Node*> shared;
+			GetSharedNodes(root, shared);
+
+			m_addNode(root);
+			for (Node* node : shared)
+				m_states[node].IsShared = true;
+		}
+	}
+	void BatchEvaluator::m_addNode(Node* node)
+	{
+		if (m_states.count(node))
+			return;
+
+		NodeState& state = m_states[node];
+		state.IsShared = false;
+		state.Profile = { node, node->SourceStart, node->SourceEnd, 0, 0.0, 0.0, 0, 0 };
+
+		std::vector<Node*> children;
+		GetChildren(node, children);
+		for (Node* child : children)
+			if (child != nullptr)
+				m_addNode(child);
+	}
+
+	void BatchEvaluator::SetVariable(const std::string& name, const Value& val)
+	{
+		Variable& var = m_vars[name];
+		var.Values.assign(1, val);
+		var.Data = var.Values.data();
+		var.Count = 1;
+		var.IsUniform = true;
+		m_setVariableType(name, &val, 1);
+	}
+	void BatchEvaluator::SetVariable(const std::string& name, const Value* values, int count)
+	{
+		Variable& var = m_vars[name];
+		var.Values.assign(values, values + count);
+		var.Data = var.Values.data();
+		var.Count = count;
+		var.IsUniform = false;
+		m_setVariableType(name, values, count);
+	}
+	void BatchEvaluator::BindVariable(const std::string& name, const Value* values, int count)
+	{
+		Variable& var = m_vars[name];
+		var.Values.clear();
+		var.Data = values;
+		var.Count = count;
+		var.IsUniform = false;
+		m_setVariableType(name, values, count);
+	}
+	void BatchEvaluator::m_setVariableType(const std::string& name, const Value* values, int count)
+	{
+		// every lane of a variable is expected to have the same type
+		if (count == 0)
+			return;
+
+		auto type = m_varTypes.find(name);
+		if (type == m_varTypes.end() || type->second != values[0].Type) {
+			m_varTypes[name] = values[0].Type;
+			m_types.clear();
+		}
+	}
+	bool BatchEvaluator::m_getType(Node* node, ValueType& out)
+	{
+		return ResolveType(node, m_varTypes, m_types, out);
+	}
+
+	void BatchEvaluator::SetProfiling(bool enable)
+	{
+		m_isProfiling = enable;
+	}
+	void BatchEvaluator::ResetProfile()
+	{
+		for (auto& state : m_states) {
+			NodeProfile& profile = state.second.Profile;
+			profile.Count = profile.ActiveLanes = profile.TotalLanes = 0;
+			profile.InclusiveTime = profile.ExclusiveTime = 0.0;
+		}
+	}
+	void BatchEvaluator::GetProfile(std::vector<NodeProfile>& out)
+	{
+		for (const auto& state : m_states)
+			out.push_back(state.second.Profile);
+		std::sort(out.begin(), out.end(), [](const NodeProfile& a, const NodeProfile& b) {
+			return a.InclusiveTime > b.InclusiveTime;
+		});
+	}
+
+	bool BatchEvaluator::Evaluate(Value& out)
+	{
+		return Evaluate(1, &out);
+	}
+	bool BatchEvaluator::Evaluate(int laneCount, Value* out, const unsigned char* mask)
+	{
+		m_hasError = false;
+		m_error = "";
+
+		if (m_root == nullptr)
+			return m_fail("empty expression");
+
+		m_laneCount = laneCount;
+		for (auto& state : m_states) {
+			NodeState& node = state.second;
+			if ((int)node.Lanes.size() < laneCount) {
+				node.Lanes.resize(laneCount);
+				node.Mask.resize(laneCount);
+			}
+			if (node.IsShared) {
+				node.Pending.resize(laneCount);
+				node.Done.assign(laneCount, 0);
+			}
+		}
+
+		if (mask != nullptr)
+			m_mask.assign(mask, mask + laneCount);
+		else
+			m_mask.assign(laneCount, 1);
+
+		if (!m_any(m_mask.data()))
+			return true;
+
+		m_childTime = 0.0;
+		if (!m_visit(m_root, m_mask.data()))
+			return false;
+
+		const Value* result = m_getLanes(m_root);
+		for (int l = 0; l < laneCount; l++)
+			if (m_mask[l])
+				out[l] = result[l];
+
+		return true;
+	}
+	bool BatchEvaluator::m_fail(const char* msg)
+	{
+		if (!m_hasError)
+			m_error = msg;
+		m_hasError = true;
+		return false;
+	}
+	bool BatchEvaluator::m_evaluateArray(ArrayFunction func, const Value* const* argLanes, int argCount, Value* out, const unsigned char* mask)
+	{
+		for (int i = 0; i < argCount; i++)
+			m_arrayArgs[i].clear();
+		for (int l = 0; l < m_laneCount; l++) {
+			if (!mask[l])
+				continue;
+			for (int i = 0; i < argCount; i++) {
+				if (argLanes[i][l].Type != ValueType::Float)
+					return false; // vectors & ints go through the NativeFunction
+				m_arrayArgs[i].push_back(argLanes[i][l].Float[0]);
+			}
+		}
+
+		const float* args[2] = { m_arrayArgs[0].data(), m_arrayArgs[1].data() };
+		int count = (int)m_arrayArgs[0].size();
+		m_arrayOut.resize(count);
+		func(args, m_arrayOut.data(), count);
+
+		for (int l = 0, i = 0; l < m_laneCount; l++) {
+			if (!mask[l])
+				continue;
+			out[l].Type = ValueType::Float;
+			out[l].Float[0] = m_arrayOut[i++];
+		}
+		return true;
+	}
+	bool BatchEvaluator::m_any(const unsigned char* mask)
+	{
+		for (int l = 0; l < m_laneCount; l++)
+			if (mask[l])
+				return true;
+		return false;
+	}
+	const Value* BatchEvaluator::m_getLanes(Node* node)
+	{
+		return m_states[node].Lanes.data();
+	}
+
+	bool BatchEvaluator::m_visit(Node* node, const unsigned char* mask)
+	{
+		NodeState& state = m_states[node];
+
+		// shared nodes can be reached from different branches, compute each lane only once
+		if (state.IsShared) {
+			bool isPending = false;
+			for (int l = 0; l < m_laneCount; l++) {
+				state.Pending[l] = mask[l] && !state.Done[l];
+				state.Done[l] |= state.Pending[l];
+				isPending |= state.Pending[l] != 0;
+			}
+			if (!isPending)
+				return true;
+			mask = state.Pending.data();
+		}
+
+		if (!m_isProfiling)
+			return m_evaluate(node, state, mask);
+
+		double parentChildTime = m_childTime;
+		m_childTime = 0.0;
+
+		auto start = std::chrono::steady_clock::now();
+		bool ret = m_evaluate(node, state, mask);
+		double inclusive = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		NodeProfile& profile = state.Profile;
+		profile.Count++;
+		profile.InclusiveTime += inclusive;
+		profile.ExclusiveTime += inclusive - m_childTime;
+		for (int l = 0; l < m_laneCount; l++)
+			profile.ActiveLanes += mask[l] != 0;
+		profile.TotalLanes += m_laneCount;
+
+		m_childTime = parentChildTime + inclusive;
+		return ret;
+	}
+	bool BatchEvaluator::m_evaluateLogic(BinaryExpressionNode* bexpr, NodeState& state, const unsigned char* mask)
+	{
+		if (!m_visit(bexpr->Left, mask))
+			return false;
+		const Value* left = m_getLanes(bexpr->Left);
+
+		// the right side only runs for the lanes that the left side didn't decide
+		bool isAnd = bexpr->Operator == TokenType_LogicAnd;
+		for (int l = 0; l < m_laneCount; l++) {
+			Value cond;
+			bool isDecided = IsScalar(left[l].Type) && ConvertValue(left[l], ValueType::Bool, cond) && cond.Bool[0] != isAnd;
+			state.Mask[l] = mask[l] && !isDecided;
+		}
+
+		if (m_any(state.Mask.data())) {
+			if (!m_visit(bexpr->Right, state.Mask.data()))
+				return false;
+			const Value* right = m_getLanes(bexpr->Right);
+			for (int l = 0; l < m_laneCount; l++)
+				if (state.Mask[l] && !ApplyBinary(bexpr->Operator, left[l], right[l], state.Lanes[l]))
+					return m_fail("invalid operands to binary expression");
+		}
+
+		// the skipped right side still decides the shape of the result
+		Value right;
+		bool hasType = false;
+		for (int l = 0; l < m_laneCount; l++) {
+			if (!mask[l] || state.Mask[l])
+				continue;
+			if (!hasType && !m_getType(bexpr->Right, right.Type))
+				return m_fail("invalid operands to binary expression");
+			hasType = true;
+			if (!ApplyBinary(bexpr->Operator, left[l], right, state.Lanes[l]))
+				return m_fail("invalid operands to binary expression");
+		}
+		return true;
+	}
+	bool BatchEvaluator::m_evaluateTernary(TernaryExpressionNode* texpr, NodeState& state, const unsigned char* mask)
+	{
+		if (!m_visit(texpr->Condition, mask))
+			return false;
+		const Value* cond = m_getLanes(texpr->Condition);
+
+		// scalar conditions select a branch per lane, vector conditions need both
+		for (int branch = 0; branch < 2; branch++) {
+			for (int l = 0; l < m_laneCount; l++) {
+				bool isBranch = cond[l].Type != ValueType::Bool || cond[l].Bool[0] == (branch == 0);
+				state.Mask[l] = mask[l] && isBranch;
+			}
+			if (m_any(state.Mask.data()) && !m_visit(branch == 0 ? texpr->OnTrue : texpr->OnFalse, state.Mask.data()))
+				return false;
+		}
+
+		// a lane with a scalar condition only ran one branch, the other one contributes its type
+		const Value* onTrue = m_getLanes(texpr->OnTrue);
+		const Value* onFalse = m_getLanes(texpr->OnFalse);
+		Value skipped[2];
+		bool hasType[2] = { false, false };
+		for (int l = 0; l < m_laneCount; l++) {
+			if (!mask[l])
+				continue;
+
+			bool success = false;
+			if (cond[l].Type == ValueType::Bool) {
+				int other = cond[l].Bool[0] ? 1 : 0;
+				if (!hasType[other] && !m_getType(other == 0 ? texpr->OnTrue : texpr->OnFalse, skipped[other].Type))
+					return m_fail("invalid ternary expression");
+				hasType[other] = true;
+				success = ApplySelect(cond[l], other == 0 ? skipped[0] : onTrue[l], other == 1 ? skipped[1] : onFalse[l], state.Lanes[l]);
+			} else
+				success = ApplySelect(cond[l], onTrue[l], onFalse[l], state.Lanes[l]);
+
+			if (!success)
+				return m_fail("invalid ternary expression");
+		}
+		return true;
+	}
+	bool BatchEvaluator::m_evaluate(Node* node, NodeState& state, const unsigned char* mask)
+	{
+		Value* out = state.Lanes.data();
+
+		switch (node->GetNodeType()) {
+		case NodeType::FloatLiteral:
+		case NodeType::IntegerLiteral:
+		case NodeType::BooleanLiteral: {
+			Value val;
+			if (node->GetNodeType() == NodeType::FloatLiteral) val = MakeFloat(((FloatLiteralNode*)node)->Value);
+			else if (node->GetNodeType() == NodeType::IntegerLiteral) val = MakeInt(((IntegerLiteralNode*)node)->Value);
+			else val = MakeBool(((BooleanLiteralNode*)node)->Value);
+
+			for (int l = 0; l < m_laneCount; l++)
+				if (mask[l]) out[l] = val;
+			return true;
+		} break;
+		case NodeType::Identifier: {
+			auto it = m_vars.find(((IdentifierNode*)node)->Name);
+			if (it == m_vars.end())
+				return m_fail("unknown variable");
+
+			const Variable& var = it->second;
+			if (!var.IsUniform && var.Count < m_laneCount)
+				return m_fail("not enough values for every lane");
+			for (int l = 0; l < m_laneCount; l++)
+				if (mask[l]) out[l] = var.Data[var.IsUniform ? 0 : l];
+			return true;
+		} break;
+		case NodeType::BinaryExpression: {
+			BinaryExpressionNode* bexpr = (BinaryExpressionNode*)node;
+			if (bexpr->Operator == TokenType_LogicAnd || bexpr->Operator == TokenType_LogicOr)
+				return m_evaluateLogic(bexpr, state, mask);
+
+			if (!m_visit(bexpr->Left, mask) || !m_visit(bexpr->Right, mask))
+				return false;
+			const Value* left = m_getLanes(bexpr->Left);
+			const Value* right = m_getLanes(bexpr->Right);
+			for (int l = 0; l < m_laneCount; l++)
+				if (mask[l] && !ApplyBinary(bexpr->Operator, left[l], right[l], out[l]))
+					return m_fail("invalid operands to binary expression");
+			return true;
+		} break;
+		case NodeType::TernaryExpression:
+			return m_evaluateTernary((TernaryExpressionNode*)node, state, mask);
+		case NodeType::UnaryExpression: {
+			UnaryExpressionNode* uexpr = (UnaryExpressionNode*)node;
+			if (!m_visit(uexpr->Child, mask))
+				return false;
+			const Value* child = m_getLanes(uexpr->Child);
+			for (int l = 0; l < m_laneCount; l++)
+				if (mask[l] && !ApplyUnary(uexpr->Operator, uexpr->IsPost, child[l], out[l]))
+					return m_fail("invalid operand to unary expression");
+			return true;
+		} break;
+		case NodeType::Cast: {
+			CastNode* cast = (CastNode*)node;
+			ValueType type;
+			if (!GetTokenValueType(cast->Type, type))
+				return m_fail("invalid cast");
+			if (!m_visit(cast->Object, mask))
+				return false;
+			const Value* child = m_getLanes(cast->Object);
+			for (int l = 0; l < m_laneCount; l++)
+				if (mask[l] && !ApplyCast(type, child[l], out[l]))
+					return m_fail("invalid cast");
+			return true;
+		} break;
+		case NodeType::FunctionCall: {
+			FunctionCallNode* fcall = (FunctionCallNode*)node;
+			int argCount = (int)fcall->Arguments.size();
+			if (argCount > 16)
+				return m_fail("too many arguments");
+
+			ValueType type;
+			bool isConstructor = GetTokenValueType(fcall->TokenType, type);
+			NativeFunction func = isConstructor ? nullptr : GetNativeFunction((Builtin)fcall->BuiltinID, m_mathMode);
+			if (!isConstructor && func == nullptr)
+				return m_fail(FindBuiltin(fcall->Name) ? "wrong number of arguments passed to a builtin function" : "function can't be evaluated natively");
+
+			const Value* argLanes[16];
+			for (int i = 0; i < argCount; i++) {
+				if (!m_visit(fcall->Arguments[i], mask))
+					return false;
+				argLanes[i] = m_getLanes(fcall->Arguments[i]);
+			}
+
+			// fast math kernels run over the whole batch when every argument is a scalar float
+			ArrayFunction arrayFunc = isConstructor ? nullptr : GetArrayFunction((Builtin)fcall->BuiltinID, argCount, m_mathMode);
+			if (arrayFunc != nullptr && m_evaluateArray(arrayFunc, argLanes, argCount, out, mask))
+				return true;
+
+			Value args[16];
+			for (int l = 0; l < m_laneCount; l++) {
+				if (!mask[l])
+					continue;
+				for (int i = 0; i < argCount; i++)
+					args[i] = argLanes[i][l];
+
+				if (isConstructor) {
+					if (!ConstructValue(type, args, argCount, out[l]))
+						return m_fail("invalid constructor");
+				} else if (!func(args, argCount, out[l]))
+					return m_fail("invalid arguments");
+			}
+			return true;
+		} break;
+		case NodeType::MemberAccess: {
+			MemberAccessNode* maccess = (MemberAccessNode*)node;
+			if (!m_visit(maccess->Object, mask))
+				return false;
+			const Value* obj = m_getLanes(maccess->Object);
+			for (int l = 0; l < m_laneCount; l++)
+				if (mask[l] && !ApplySwizzle(obj[l], maccess->Swizzle, maccess->SwizzleCount, out[l]))
+					return m_fail("invalid swizzle");
+			return true;
+		} break;
+		case NodeType::ArrayAccess: {
+			ArrayAccessNode* aaccess = (ArrayAccessNode*)node;
+			if (!m_visit(aaccess->Object, mask))
+				return false;
+			for (Node* index : aaccess->Indices)
+				if (!m_visit(index, mask))
+					return false;
+
+			const Value* obj = m_getLanes(aaccess->Object);
+			for (int l = 0; l < m_laneCount; l++) {
+				if (!mask[l])
+					continue;
+				out[l] = obj[l];
+				for (Node* index : aaccess->Indices)
+					if (!ApplyIndex(out[l], m_getLanes(index)[l], out[l]))
+						return m_fail("invalid index");
+			}
+			return true;
+		} break;
+		default: break;
+		}
+
+		return m_fail("unsupported expression");
+	}
+}
\ No newline at end of file
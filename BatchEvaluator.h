@@ -0,0 +1,95 @@
+#pragma once
+#include "Evaluator.h"
+
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace expr
+{
+	// what BatchEvaluator measured for one node while profiling was enabled
+	struct NodeProfile
+	{
+		Node* Expression;
+		size_t SourceStart, SourceEnd; // see Node::SourceStart
+
+		size_t Count;			// number of batches the node ran in
+		double InclusiveTime;	// milliseconds, children included
+		double ExclusiveTime;	// milliseconds spent in the node itself
+		size_t ActiveLanes;		// summed up over all of the batches
+		size_t TotalLanes;
+
+		inline double GetOccupancy() const { return TotalLanes == 0 ? 0.0 : ActiveLanes / (double)TotalLanes; }
+	};
+
+	// evaluates the AST for a batch of invocations (lanes) at once, like a GPU runs a shader:
+	// each node runs once per batch for every lane that is still active. The branches of a
+	// ternary and the right side of && and || only run for the lanes that reach them.
+	class BatchEvaluator : public Evaluator
+	{
+	public:
+		BatchEvaluator(Node* root);
+
+		// the same value in every lane
+		virtual void SetVariable(const std::string& name, const Value& val);
+		// one value per lane, has to cover every lane that gets evaluated
+		void SetVariable(const std::string& name, const Value* values, int count);
+		// same as SetVariable() but values isn't copied, so it has to outlive the Evaluate() calls
+		void BindVariable(const std::string& name, const Value* values, int count);
+
+		// evaluates a single lane
+		virtual bool Evaluate(Value& out);
+		// out needs room for laneCount values - lanes with a 0 in mask are skipped and their out is left as is
+		bool Evaluate(int laneCount, Value* out, const unsigned char* mask = nullptr);
+
+		void SetProfiling(bool enable);
+		inline bool IsProfiling() { return m_isProfiling; }
+		void ResetProfile();
+		void GetProfile(std::vector<NodeProfile>& out); // hottest (inclusive time) first
+
+	private:
+		struct NodeState
+		{
+			std::vector<Value> Lanes;
+			std::vector<unsigned char> Mask;	// lanes that the children run for
+			std::vector<unsigned char> Pending;	// shared nodes: lanes that still need to be computed
+			std::vector<unsigned char> Done;
+			bool IsShared;
+			NodeProfile Profile;
+		};
+		struct Variable
+		{
+			std::vector<Value> Values;
+			const Value* Data; // Values or bound memory
+			int Count;
+			bool IsUniform;
+		};
+
+		void m_addNode(Node* node);
+		void m_setVariableType(const std::string& name, const Value* values, int count);
+		bool m_getType(Node* node, ValueType& out);
+		bool m_visit(Node* node, const unsigned char* mask);
+		bool m_evaluate(Node* node, NodeState& state, const unsigned char* mask);
+		bool m_evaluateLogic(BinaryExpressionNode* bexpr, NodeState& state, const unsigned char* mask);
+		bool m_evaluateTernary(TernaryExpressionNode* texpr, NodeState& state, const unsigned char* mask);
+		bool m_evaluateArray(ArrayFunction func, const Value* const* argLanes, int argCount, Value* out, const unsigned char* mask);
+		bool m_any(const unsigned char* mask);
+		const Value* m_getLanes(Node* node);
+		bool m_fail(const char* msg);
+
+		Node* m_root;
+		std::unordered_map<Node*, NodeState> m_states;
+		std::unordered_map<std::string, Variable> m_vars;
+
+		// types of the operands that were skipped for a lane, see Interpreter
+		std::unordered_map<std::string, ValueType> m_varTypes;
+		std::unordered_map<Node*, ValueType> m_types;
+
+		int m_laneCount;
+		std::vector<unsigned char> m_mask;
+		std::vector<float> m_arrayArgs[2], m_arrayOut; // active lanes packed for ArrayFunction
+
+		bool m_isProfiling;
+		double m_childTime;
+	};
+}
\ No newline at end of file
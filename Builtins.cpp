@@ -0,0 +1,67 @@
+#include "Builtins.h"
+#include <string.h>
+
+namespace expr
+{
+	constexpr int m_compare(const char* a, const char* b)
+	{
+		while (*a != 0 && *a == *b) {
+			a++;
+			b++;
+		}
+		return (unsigned char)*a - (unsigned char)*b;
+	}
+	constexpr bool m_isSorted()
+	{
+		for (int i = 1; i < sizeof(BuiltinTable) / sizeof(BuiltinTable[0]); i++)
+			if (m_compare(BuiltinTable[i - 1].Name, BuiltinTable[i].Name) >= 0)
+				return false;
+		return true;
+	}
+	static_assert(m_isSorted(), "BuiltinTable must be sorted by name");
+
+	// index of the first table entry for every builtin
+	struct m_BuiltinIndex
+	{
+		int Entry[BuiltinCount];
+
+		constexpr m_BuiltinIndex() : Entry()
+		{
+			for (int i = 0; i < BuiltinCount; i++)
+				Entry[i] = -1;
+			for (int i = sizeof(BuiltinTable) / sizeof(BuiltinTable[0]) - 1; i >= 0; i--)
+				Entry[BuiltinTable[i].ID] = i;
+		}
+		constexpr bool IsComplete() const
+		{
+			for (int i = Builtin_None + 1; i < BuiltinCount; i++)
+				if (Entry[i] < 0)
+					return false;
+			return true;
+		}
+	};
+	static constexpr m_BuiltinIndex m_index;
+	static_assert(m_index.IsComplete(), "every builtin needs an entry in BuiltinTable");
+
+	const BuiltinInfo* FindBuiltin(const char* name)
+	{
+		int low = 0, high = sizeof(BuiltinTable) / sizeof(BuiltinTable[0]) - 1;
+		while (low <= high) {
+			int mid = (low + high) / 2;
+			int cmp = strcmp(name, BuiltinTable[mid].Name);
+			if (cmp == 0)
+				return &BuiltinTable[mid];
+			else if (cmp < 0)
+				high = mid - 1;
+			else
+				low = mid + 1;
+		}
+		return nullptr;
+	}
+	const BuiltinInfo* GetBuiltinInfo(Builtin id)
+	{
+		if (id <= Builtin_None || id >= BuiltinCount)
+			return nullptr;
+		return &BuiltinTable[m_index.Entry[id]];
+	}
+}
\ No newline at end of file
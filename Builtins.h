@@ -0,0 +1,175 @@
+#pragma once
+#include <stddef.h>
+
+namespace expr
+{
+	enum Builtin
+	{
+		Builtin_None,
+
+		Builtin_Round,
+		Builtin_RoundEven,
+		Builtin_Trunc,
+		Builtin_Abs,
+		Builtin_Sign,
+		Builtin_Floor,
+		Builtin_Ceil,
+		Builtin_Fract,
+		Builtin_Radians,
+		Builtin_Degrees,
+		Builtin_Sin,
+		Builtin_Cos,
+		Builtin_Tan,
+		Builtin_Asin,
+		Builtin_Acos,
+		Builtin_Atan,
+		Builtin_Sinh,
+		Builtin_Cosh,
+		Builtin_Tanh,
+		Builtin_Asinh,
+		Builtin_Acosh,
+		Builtin_Atanh,
+		Builtin_Pow,
+		Builtin_Exp,
+		Builtin_Exp2,
+		Builtin_Log,
+		Builtin_Log2,
+		Builtin_Sqrt,
+		Builtin_InverseSqrt,
+		Builtin_Determinant,
+		Builtin_Inverse,
+		Builtin_Min,
+		Builtin_Max,
+		Builtin_Clamp,
+		Builtin_Mix,
+		Builtin_Step,
+		Builtin_SmoothStep,
+		Builtin_Fma,
+		Builtin_Cross,
+		Builtin_Dot,
+		Builtin_Length,
+		Builtin_Distance,
+		Builtin_Normalize,
+		Builtin_Any,
+		Builtin_All,
+		Builtin_Dfdx,
+		Builtin_Dfdy,
+		Builtin_Fwidth,
+		Builtin_DfdxFine,
+		Builtin_DfdyFine,
+		Builtin_FwidthFine,
+		Builtin_DfdxCoarse,
+		Builtin_DfdyCoarse,
+		Builtin_FwidthCoarse,
+		Builtin_Texture,
+
+		BuiltinCount
+	};
+
+	// what kind of arguments a builtin takes - backends use it to convert the arguments
+	enum class BuiltinSignature
+	{
+		Float,		// float scalars/vectors, other base types get converted to float
+		Numeric,	// float, int or uint scalars/vectors (abs, sign, min, max, clamp)
+		Matrix,		// a single square matrix
+		Vector,		// float vectors (cross, dot, length, ...)
+		BoolVector,	// any, all
+		Derivative,	// float scalars/vectors, only available in fragment shaders
+		Texture		// sampler followed by the coordinates
+	};
+
+	struct BuiltinInfo
+	{
+		const char* Name;
+		Builtin ID;
+		int MinArgs, MaxArgs;
+		BuiltinSignature Signature;
+	};
+
+	// sorted by name (checked at compile time) so names can be looked up with a binary search
+	constexpr BuiltinInfo BuiltinTable[] = {
+		{ "abs", Builtin_Abs, 1, 1, BuiltinSignature::Numeric },
+		{ "acos", Builtin_Acos, 1, 1, BuiltinSignature::Float },
+		{ "acosh", Builtin_Acosh, 1, 1, BuiltinSignature::Float },
+		{ "all", Builtin_All, 1, 1, BuiltinSignature::BoolVector },
+		{ "any", Builtin_Any, 1, 1, BuiltinSignature::BoolVector },
+		{ "asin", Builtin_Asin, 1, 1, BuiltinSignature::Float },
+		{ "asinh", Builtin_Asinh, 1, 1, BuiltinSignature::Float },
+		{ "atan", Builtin_Atan, 1, 2, BuiltinSignature::Float },
+		{ "atan2", Builtin_Atan, 2, 2, BuiltinSignature::Float },
+		{ "atanh", Builtin_Atanh, 1, 1, BuiltinSignature::Float },
+		{ "ceil", Builtin_Ceil, 1, 1, BuiltinSignature::Float },
+		{ "clamp", Builtin_Clamp, 3, 3, BuiltinSignature::Numeric },
+		{ "cos", Builtin_Cos, 1, 1, BuiltinSignature::Float },
+		{ "cosh", Builtin_Cosh, 1, 1, BuiltinSignature::Float },
+		{ "cross", Builtin_Cross, 2, 2, BuiltinSignature::Vector },
+		{ "dFdx", Builtin_Dfdx, 1, 1, BuiltinSignature::Derivative },
+		{ "dFdxCoarse", Builtin_DfdxCoarse, 1, 1, BuiltinSignature::Derivative },
+		{ "dFdxFine", Builtin_DfdxFine, 1, 1, BuiltinSignature::Derivative },
+		{ "dFdy", Builtin_Dfdy, 1, 1, BuiltinSignature::Derivative },
+		{ "dFdyCoarse", Builtin_DfdyCoarse, 1, 1, BuiltinSignature::Derivative },
+		{ "dFdyFine", Builtin_DfdyFine, 1, 1, BuiltinSignature::Derivative },
+		{ "ddx", Builtin_Dfdx, 1, 1, BuiltinSignature::Derivative },
+		{ "ddx_coarse", Builtin_DfdxCoarse, 1, 1, BuiltinSignature::Derivative },
+		{ "ddx_fine", Builtin_DfdxFine, 1, 1, BuiltinSignature::Derivative },
+		{ "ddy", Builtin_Dfdy, 1, 1, BuiltinSignature::Derivative },
+		{ "ddy_coarse", Builtin_DfdyCoarse, 1, 1, BuiltinSignature::Derivative },
+		{ "ddy_fine", Builtin_DfdyFine, 1, 1, BuiltinSignature::Derivative },
+		{ "degrees", Builtin_Degrees, 1, 1, BuiltinSignature::Float },
+		{ "determinant", Builtin_Determinant, 1, 1, BuiltinSignature::Matrix },
+		{ "distance", Builtin_Distance, 2, 2, BuiltinSignature::Vector },
+		{ "dot", Builtin_Dot, 2, 2, BuiltinSignature::Vector },
+		{ "exp", Builtin_Exp, 1, 1, BuiltinSignature::Float },
+		{ "exp2", Builtin_Exp2, 1, 1, BuiltinSignature::Float },
+		{ "floor", Builtin_Floor, 1, 1, BuiltinSignature::Float },
+		{ "fma", Builtin_Fma, 3, 3, BuiltinSignature::Float },
+		{ "frac", Builtin_Fract, 1, 1, BuiltinSignature::Float },
+		{ "fract", Builtin_Fract, 1, 1, BuiltinSignature::Float },
+		{ "fwidth", Builtin_Fwidth, 1, 1, BuiltinSignature::Derivative },
+		{ "fwidthCoarse", Builtin_FwidthCoarse, 1, 1, BuiltinSignature::Derivative },
+		{ "fwidthFine", Builtin_FwidthFine, 1, 1, BuiltinSignature::Derivative },
+		{ "inverse", Builtin_Inverse, 1, 1, BuiltinSignature::Matrix },
+		{ "inversesqrt", Builtin_InverseSqrt, 1, 1, BuiltinSignature::Float },
+		{ "length", Builtin_Length, 1, 1, BuiltinSignature::Vector },
+		{ "log", Builtin_Log, 1, 1, BuiltinSignature::Float },
+		{ "log2", Builtin_Log2, 1, 1, BuiltinSignature::Float },
+		{ "max", Builtin_Max, 2, 2, BuiltinSignature::Numeric },
+		{ "min", Builtin_Min, 2, 2, BuiltinSignature::Numeric },
+		{ "mix", Builtin_Mix, 3, 3, BuiltinSignature::Float },
+		{ "normalize", Builtin_Normalize, 1, 1, BuiltinSignature::Vector },
+		{ "pow", Builtin_Pow, 2, 2, BuiltinSignature::Float },
+		{ "radians", Builtin_Radians, 1, 1, BuiltinSignature::Float },
+		{ "round", Builtin_Round, 1, 1, BuiltinSignature::Float },
+		{ "roundEven", Builtin_RoundEven, 1, 1, BuiltinSignature::Float },
+		{ "rsqrt", Builtin_InverseSqrt, 1, 1, BuiltinSignature::Float },
+		{ "sign", Builtin_Sign, 1, 1, BuiltinSignature::Numeric },
+		{ "sin", Builtin_Sin, 1, 1, BuiltinSignature::Float },
+		{ "sinh", Builtin_Sinh, 1, 1, BuiltinSignature::Float },
+		{ "smoothstep", Builtin_SmoothStep, 3, 3, BuiltinSignature::Float },
+		{ "sqrt", Builtin_Sqrt, 1, 1, BuiltinSignature::Float },
+		{ "step", Builtin_Step, 2, 2, BuiltinSignature::Float },
+		{ "tan", Builtin_Tan, 1, 1, BuiltinSignature::Float },
+		{ "tanh", Builtin_Tanh, 1, 1, BuiltinSignature::Float },
+		{ "texture", Builtin_Texture, 2, 2, BuiltinSignature::Texture },
+		{ "trunc", Builtin_Trunc, 1, 1, BuiltinSignature::Float },
+	};
+
+	// table entry for the name (aliases have their own entries), nullptr for other names
+	const BuiltinInfo* FindBuiltin(const char* name);
+
+	// same as above for names that aren't null terminated, usable at compile time
+	constexpr const BuiltinInfo* FindBuiltin(const char* name, size_t length)
+	{
+		for (const BuiltinInfo& info : BuiltinTable) {
+			size_t i = 0;
+			while (i < length && info.Name[i] == name[i])
+				i++;
+			if (i == length && info.Name[i] == 0)
+				return &info;
+		}
+		return nullptr;
+	}
+
+	// info for the canonical name of the builtin, nullptr for Builtin_None
+	const BuiltinInfo* GetBuiltinInfo(Builtin id);
+}
\ No newline at end of file
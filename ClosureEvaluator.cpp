@@ -0,0 +1,659 @@
+#include "ClosureEvaluator.h"
+#include "Operations.h"
+#include "Analysis.h"
+#include "VectorMath.h"
+
+namespace expr
+{
+	typedef ClosureEvaluator::Closure Closure;
+
+	static void m_load(const Closure* self, Value& out)
+	{
+		out = *self->Source;
+	}
+	static void m_cached(const Closure* self, Value& out)
+	{
+		if (self->CachedEpoch != *self->Epoch) {
+			self->Args[0]->Call(self->Args[0], self->Cache);
+			self->CachedEpoch = *self->Epoch;
+		}
+		out = self->Cache;
+	}
+	template<typename From, typename To>
+	static void m_convertKernel(const Closure* self, Value& out)
+	{
+		Value val;
+		self->Args[0]->Call(self->Args[0], val);
+		ConvertKernel<From, To>(GetData<From>(val), GetData<To>(out), self->Count);
+		out.Type = self->Type;
+	}
+	template<int Op, typename T>
+	static void m_binaryKernel(const Closure* self, Value& out)
+	{
+		Value a, b;
+		self->Args[0]->Call(self->Args[0], a);
+		self->Args[1]->Call(self->Args[1], b);
+		ApplyBinaryKernel<Op, T>(GetData<T>(a), self->Steps[0], GetData<T>(b), self->Steps[1],
+			GetData<typename BinaryOperation<Op>::template Result<T>>(out), self->Count);
+		out.Type = self->Type;
+	}
+	// && and || with a scalar left side - the right side only runs if the left one doesn't decide
+	template<bool IsAnd>
+	static void m_logicKernel(const Closure* self, Value& out)
+	{
+		Value a, b;
+		self->Args[0]->Call(self->Args[0], a);
+		if (a.Bool[0] != IsAnd) {
+			for (int i = 0; i < self->Count; i++)
+				out.Bool[i] = a.Bool[0];
+		} else {
+			self->Args[1]->Call(self->Args[1], b);
+			for (int i = 0; i < self->Count; i++)
+				out.Bool[i] = b.Bool[i * self->Steps[1]];
+		}
+		out.Type = self->Type;
+	}
+	template<int Op, typename T>
+	static void m_unaryKernel(const Closure* self, Value& out)
+	{
+		Value a;
+		self->Args[0]->Call(self->Args[0], a);
+		ApplyUnaryKernel<Op, T>(GetData<T>(a), GetData<T>(out), self->Count);
+		out.Type = self->Type;
+	}
+	// matrix products are specialized for every shape, see VectorMath.h
+	template<int C, int R>
+	static void m_matrixTimesVector(const Closure* self, Value& out)
+	{
+		Value m, v;
+		self->Args[0]->Call(self->Args[0], m);
+		self->Args[1]->Call(self->Args[1], v);
+		(Matrix<C, R>::Load(m.Float) * Vector<float, C>::Load(v.Float)).Store(out.Float);
+		out.Type = self->Type;
+	}
+	template<int C, int R>
+	static void m_vectorTimesMatrix(const Closure* self, Value& out)
+	{
+		Value v, m;
+		self->Args[0]->Call(self->Args[0], v);
+		self->Args[1]->Call(self->Args[1], m);
+		(Vector<float, R>::Load(v.Float) * Matrix<C, R>::Load(m.Float)).Store(out.Float);
+		out.Type = self->Type;
+	}
+	template<int K, int R, int C>
+	static void m_matrixTimesMatrix(const Closure* self, Value& out)
+	{
+		Value a, b;
+		self->Args[0]->Call(self->Args[0], a);
+		self->Args[1]->Call(self->Args[1], b);
+		(Matrix<K, R>::Load(a.Float) * Matrix<C, K>::Load(b.Float)).Store(out.Float);
+		out.Type = self->Type;
+	}
+	// the operand types were already checked by ResolveBinaryType
+	static Closure::Function m_getMatrixProduct(ValueType left, ValueType right)
+	{
+		if (IsMatrix(left) && IsMatrix(right)) {
+			switch (left) {
+			case ValueType::Float2x2:
+				if (right == ValueType::Float2x2) return m_matrixTimesMatrix<2, 2, 2>;
+				return m_matrixTimesMatrix<2, 2, 4>;
+			case ValueType::Float3x3:
+				if (right == ValueType::Float3x3) return m_matrixTimesMatrix<3, 3, 3>;
+				return m_matrixTimesMatrix<3, 3, 4>;
+			case ValueType::Float4x4: return m_matrixTimesMatrix<4, 4, 4>;
+			case ValueType::Float4x3: return m_matrixTimesMatrix<4, 3, 4>;
+			case ValueType::Float4x2: return m_matrixTimesMatrix<4, 2, 4>;
+			default: break;
+			}
+		} else if (IsMatrix(left)) {
+			switch (left) {
+			case ValueType::Float2x2: return m_matrixTimesVector<2, 2>;
+			case ValueType::Float3x3: return m_matrixTimesVector<3, 3>;
+			case ValueType::Float4x4: return m_matrixTimesVector<4, 4>;
+			case ValueType::Float4x3: return m_matrixTimesVector<4, 3>;
+			case ValueType::Float4x2: return m_matrixTimesVector<4, 2>;
+			default: break;
+			}
+		} else {
+			switch (right) {
+			case ValueType::Float2x2: return m_vectorTimesMatrix<2, 2>;
+			case ValueType::Float3x3: return m_vectorTimesMatrix<3, 3>;
+			case ValueType::Float4x4: return m_vectorTimesMatrix<4, 4>;
+			case ValueType::Float4x3: return m_vectorTimesMatrix<4, 3>;
+			case ValueType::Float4x2: return m_vectorTimesMatrix<4, 2>;
+			default: break;
+			}
+		}
+		return nullptr;
+	}
+	static void m_select(const Closure* self, Value& out)
+	{
+		Value cond;
+		self->Args[0]->Call(self->Args[0], cond);
+		const Closure* branch = self->Args[cond.Bool[0] ? 1 : 2];
+		branch->Call(branch, out);
+	}
+	template<typename T>
+	static void m_selectVector(const Closure* self, Value& out)
+	{
+		Value cond, a, b;
+		self->Args[0]->Call(self->Args[0], cond);
+		self->Args[1]->Call(self->Args[1], a);
+		self->Args[2]->Call(self->Args[2], b);
+		for (int i = 0; i < self->Count; i++)
+			GetData<T>(out)[i] = cond.Bool[i] ? GetData<T>(a)[i] : GetData<T>(b)[i];
+		out.Type = self->Type;
+	}
+	template<typename T>
+	static void m_swizzle(const Closure* self, Value& out)
+	{
+		Value a;
+		self->Args[0]->Call(self->Args[0], a);
+		for (int i = 0; i < self->Count; i++)
+			GetData<T>(out)[i] = GetData<T>(a)[self->Indices[i]];
+		out.Type = self->Type;
+	}
+	template<typename T>
+	static void m_index(const Closure* self, Value& out)
+	{
+		Value a, index;
+		self->Args[0]->Call(self->Args[0], a);
+		self->Args[1]->Call(self->Args[1], index);
+
+		// out of range reads return 0 just like robust buffer access
+		unsigned int i = index.Uint[0];
+		GetData<T>(out)[0] = (i < (unsigned int)self->Indices[0]) ? GetData<T>(a)[i] : T(0);
+		out.Type = self->Type;
+	}
+	static void m_columnIndex(const Closure* self, Value& out)
+	{
+		Value m, index;
+		self->Args[0]->Call(self->Args[0], m);
+		self->Args[1]->Call(self->Args[1], index);
+
+		unsigned int i = index.Uint[0];
+		for (int r = 0; r < self->Count; r++)
+			out.Float[r] = (i < (unsigned int)self->Indices[0]) ? m.Float[i * self->Count + r] : 0.0f;
+		out.Type = self->Type;
+	}
+	template<typename T>
+	static void m_construct(const Closure* self, Value& out)
+	{
+		Value a;
+		int cur = 0;
+		for (const Closure* arg : self->Args) {
+			arg->Call(arg, a);
+			for (int j = 0; j < arg->Count && cur < self->Count; j++)
+				GetData<T>(out)[cur++] = GetData<T>(a)[j];
+		}
+		for (; cur < self->Count; cur++)
+			GetData<T>(out)[cur] = GetData<T>(out)[cur - 1];
+		out.Type = self->Type;
+	}
+	static void m_constructMatrix(const Closure* self, Value& out)
+	{
+		Value a;
+		self->Args[0]->Call(self->Args[0], a);
+		ConstructValue(self->Type, &a, 1, out);
+	}
+	// MathMode::Fast builtins call the vectorized kernels directly, broadcasted scalars are expanded first
+	template<int ArgCount>
+	static void m_arrayKernel(const Closure* self, Value& out)
+	{
+		Value args[ArgCount];
+		const float* data[ArgCount];
+		for (int i = 0; i < ArgCount; i++) {
+			self->Args[i]->Call(self->Args[i], args[i]);
+			if (self->Steps[i] == 0)
+				for (int j = 1; j < self->Count; j++)
+					args[i].Float[j] = args[i].Float[0];
+			data[i] = args[i].Float;
+		}
+		self->Array(data, out.Float, self->Count);
+		out.Type = self->Type;
+	}
+	static void m_native(const Closure* self, Value& out)
+	{
+		Value args[3];
+		int argCount = (int)self->Args.size();
+		for (int i = 0; i < argCount; i++)
+			self->Args[i]->Call(self->Args[i], args[i]);
+		self->Native(args, argCount, out);
+	}
+
+	template<typename T>
+	static Closure::Function m_getBinary(int op)
+	{
+		switch (op) {
+		case '+': return m_binaryKernel<'+', T>;
+		case '-': return m_binaryKernel<'-', T>;
+		case '*': return m_binaryKernel<'*', T>;
+		case '/': return m_binaryKernel<'/', T>;
+		case '%': return m_binaryKernel<'%', T>;
+		case '&': return m_binaryKernel<'&', T>;
+		case '|': return m_binaryKernel<'|', T>;
+		case '^': return m_binaryKernel<'^', T>;
+		case '<': return m_binaryKernel<'<', T>;
+		case '>': return m_binaryKernel<'>', T>;
+		case TokenType_BitshiftLeft: return m_binaryKernel<TokenType_BitshiftLeft, T>;
+		case TokenType_BitshiftRight: return m_binaryKernel<TokenType_BitshiftRight, T>;
+		case TokenType_LogicAnd: return m_binaryKernel<TokenType_LogicAnd, T>;
+		case TokenType_LogicOr: return m_binaryKernel<TokenType_LogicOr, T>;
+		case TokenType_LessThanEqual: return m_binaryKernel<TokenType_LessThanEqual, T>;
+		case TokenType_GreaterThanEqual: return m_binaryKernel<TokenType_GreaterThanEqual, T>;
+		case TokenType_Equal: return m_binaryKernel<TokenType_Equal, T>;
+		case TokenType_NotEqual: return m_binaryKernel<TokenType_NotEqual, T>;
+		}
+		return nullptr;
+	}
+	template<typename T>
+	static Closure::Function m_getUnary(int op)
+	{
+		switch (op) {
+		case '+': return m_unaryKernel<'+', T>;
+		case '-': return m_unaryKernel<'-', T>;
+		case '!': return m_unaryKernel<'!', T>;
+		case '~': return m_unaryKernel<'~', T>;
+		case TokenType_Increment: return m_unaryKernel<TokenType_Increment, T>;
+		case TokenType_Decrement: return m_unaryKernel<TokenType_Decrement, T>;
+		}
+		return nullptr;
+	}
+	template<typename From>
+	static Closure::Function m_getConvert(ValueType to)
+	{
+		switch (to) {
+		case ValueType::Float: return m_convertKernel<From, float>;
+		case ValueType::Int: return m_convertKernel<From, int>;
+		case ValueType::Uint: return m_convertKernel<From, unsigned int>;
+		case ValueType::Bool: return m_convertKernel<From, bool>;
+		default: break;
+		}
+		return nullptr;
+	}
+	// picks the instantiation of Kernel<T> that matches the base type
+	template<template<typename> class Getter, typename... Args>
+	static Closure::Function m_byBaseType(ValueType base, Args... args)
+	{
+		switch (base) {
+		case ValueType::Float: return Getter<float>::Get(args...);
+		case ValueType::Int: return Getter<int>::Get(args...);
+		case ValueType::Uint: return Getter<unsigned int>::Get(args...);
+		case ValueType::Bool: return Getter<bool>::Get(args...);
+		default: break;
+		}
+		return nullptr;
+	}
+	template<typename T> struct BinaryGetter { static Closure::Function Get(int op) { return m_getBinary<T>(op); } };
+	template<typename T> struct UnaryGetter { static Closure::Function Get(int op) { return m_getUnary<T>(op); } };
+	template<typename T> struct ConvertGetter { static Closure::Function Get(ValueType to) { return m_getConvert<T>(to); } };
+	template<typename T> struct SelectGetter { static Closure::Function Get() { return m_selectVector<T>; } };
+	template<typename T> struct SwizzleGetter { static Closure::Function Get() { return m_swizzle<T>; } };
+	template<typename T> struct IndexGetter { static Closure::Function Get() { return m_index<T>; } };
+	template<typename T> struct ConstructGetter { static Closure::Function Get() { return m_construct<T>; } };
+
+	ClosureEvaluator::ClosureEvaluator(Node* root)
+	{
+		m_root = root;
+		m_closure = nullptr;
+		m_isCompiled = false;
+		m_epoch = 1;
+		GetSharedNodes(root, m_shared);
+	}
+	ClosureEvaluator::~ClosureEvaluator()
+	{
+		m_clear();
+	}
+	void ClosureEvaluator::SetVariable(const std::string& name, const Value& val)
+	{
+		auto it = m_vars.find(name);
+		if (it == m_vars.end() || it->second.Type != val.Type)
+			m_isCompiled = false;
+		m_vars[name] = val;
+	}
+	void ClosureEvaluator::SetMathMode(MathMode mode)
+	{
+		if (mode != m_mathMode)
+			m_isCompiled = false;
+		m_mathMode = mode;
+	}
+	bool ClosureEvaluator::Evaluate(Value& out)
+	{
+		if (!m_isCompiled && !Compile())
+			return false;
+
+		if (++m_epoch == 0)
+			m_epoch = 1;
+		m_closure->Call(m_closure, out);
+		return true;
+	}
+	bool ClosureEvaluator::Compile()
+	{
+		m_clear();
+		m_hasError = false;
+		m_error = "";
+
+		if (m_root == nullptr) {
+			m_fail("empty expression");
+			return false;
+		}
+
+		m_closure = m_compile(m_root);
+		m_isCompiled = (m_closure != nullptr);
+
+		return m_isCompiled;
+	}
+	void ClosureEvaluator::m_clear()
+	{
+		for (auto& closure : m_closures)
+			delete closure;
+		m_closures.clear();
+		m_compiled.clear();
+		m_closure = nullptr;
+		m_isCompiled = false;
+	}
+	Closure* ClosureEvaluator::m_fail(const char* msg)
+	{
+		if (!m_hasError)
+			m_error = msg;
+		m_hasError = true;
+		return nullptr;
+	}
+	Closure* ClosureEvaluator::m_allocate(Closure::Function func, ValueType type)
+	{
+		Closure* ret = new Closure();
+		ret->Call = func;
+		ret->Type = type;
+		ret->Count = GetComponentCount(type);
+		ret->Steps[0] = ret->Steps[1] = 1;
+		ret->Source = nullptr;
+		ret->Native = nullptr;
+		ret->Array = nullptr;
+		ret->Epoch = nullptr;
+		ret->CachedEpoch = 0;
+		m_closures.push_back(ret);
+		return ret;
+	}
+	Closure* ClosureEvaluator::m_convert(Closure* child, ValueType baseType)
+	{
+		ValueType childBase = GetBaseType(child->Type);
+		if (childBase == baseType)
+			return child;
+		if (IsMatrix(child->Type) && baseType != ValueType::Float)
+			return m_fail("invalid matrix conversion");
+
+		Closure* ret = m_allocate(m_byBaseType<ConvertGetter>(childBase, baseType), GetSameShape(child->Type, baseType));
+		ret->Args.push_back(child);
+		return ret;
+	}
+	Closure* ClosureEvaluator::m_compileConstruct(ValueType type, std::vector<Closure*>& args)
+	{
+		if (args.empty())
+			return m_fail("invalid constructor");
+
+		if (IsMatrix(type) && args.size() == 1 && !IsVector(args[0]->Type)) {
+			Closure* ret = m_allocate(m_constructMatrix, type);
+			ret->Args.push_back(args[0]);
+			return ret;
+		}
+
+		ValueType base = GetBaseType(type);
+		Closure* ret = m_allocate(m_byBaseType<ConstructGetter>(base), type);
+		for (Closure* arg : args) {
+			Closure* conv = m_convert(arg, base);
+			if (conv == nullptr)
+				return nullptr;
+			ret->Args.push_back(conv);
+		}
+		return ret;
+	}
+	Closure* ClosureEvaluator::m_compile(Node* node)
+	{
+		if (m_shared.empty() || m_shared.count(node) == 0)
+			return m_compileNode(node);
+
+		auto compiled = m_compiled.find(node);
+		if (compiled != m_compiled.end())
+			return compiled->second;
+
+		Closure* child = m_compileNode(node);
+		if (child == nullptr)
+			return nullptr;
+
+		// loads are as cheap as reading the cache
+		Closure* ret = child;
+		if (child->Call != m_load) {
+			ret = m_allocate(m_cached, child->Type);
+			ret->Args.push_back(child);
+			ret->Epoch = &m_epoch;
+		}
+
+		m_compiled[node] = ret;
+		return ret;
+	}
+	Closure* ClosureEvaluator::m_compileNode(Node* node)
+	{
+		switch (node->GetNodeType()) {
+		case NodeType::FloatLiteral:
+		case NodeType::IntegerLiteral:
+		case NodeType::BooleanLiteral: {
+			Value val;
+			if (node->GetNodeType() == NodeType::FloatLiteral) val = MakeFloat(((FloatLiteralNode*)node)->Value);
+			else if (node->GetNodeType() == NodeType::IntegerLiteral) val = MakeInt(((IntegerLiteralNode*)node)->Value);
+			else val = MakeBool(((BooleanLiteralNode*)node)->Value);
+
+			Closure* ret = m_allocate(m_load, val.Type);
+			ret->Constant = val;
+			ret->Source = &ret->Constant;
+			return ret;
+		} break;
+		case NodeType::Identifier: {
+			auto it = m_vars.find(((IdentifierNode*)node)->Name);
+			if (it == m_vars.end())
+				return m_fail("unknown variable");
+
+			Closure* ret = m_allocate(m_load, it->second.Type);
+			ret->Source = &it->second;
+			return ret;
+		} break;
+		case NodeType::BinaryExpression: {
+			BinaryExpressionNode* bexpr = (BinaryExpressionNode*)node;
+			Closure* left = m_compile(bexpr->Left);
+			Closure* right = left ? m_compile(bexpr->Right) : nullptr;
+			if (right == nullptr)
+				return nullptr;
+
+			ValueType opBase, resType;
+			if (!ResolveBinaryType(bexpr->Operator, left->Type, right->Type, opBase, resType))
+				return m_fail("invalid operands to binary expression");
+
+			left = m_convert(left, opBase);
+			right = m_convert(right, opBase);
+			if (left == nullptr || right == nullptr)
+				return nullptr;
+
+			Closure* ret = nullptr;
+			bool isLogic = bexpr->Operator == TokenType_LogicAnd || bexpr->Operator == TokenType_LogicOr;
+			if (bexpr->Operator == '*' && (IsMatrix(left->Type) || IsMatrix(right->Type)) && !IsScalar(left->Type) && !IsScalar(right->Type))
+				ret = m_allocate(m_getMatrixProduct(left->Type, right->Type), resType);
+			else if (isLogic && IsScalar(left->Type)) {
+				ret = m_allocate(bexpr->Operator == TokenType_LogicAnd ? m_logicKernel<true> : m_logicKernel<false>, resType);
+				ret->Steps[1] = IsScalar(right->Type) ? 0 : 1;
+			} else {
+				ret = m_allocate(m_byBaseType<BinaryGetter>(opBase, bexpr->Operator), resType);
+				ret->Steps[0] = IsScalar(left->Type) ? 0 : 1;
+				ret->Steps[1] = IsScalar(right->Type) ? 0 : 1;
+			}
+
+			ret->Args.push_back(left);
+			ret->Args.push_back(right);
+			return ret;
+		} break;
+		case NodeType::UnaryExpression: {
+			UnaryExpressionNode* uexpr = (UnaryExpressionNode*)node;
+			Closure* child = m_compile(uexpr->Child);
+			if (child == nullptr)
+				return nullptr;
+
+			ValueType resType;
+			if (!ResolveUnaryType(uexpr->Operator, child->Type, resType))
+				return m_fail("invalid operand to unary expression");
+
+			child = m_convert(child, GetBaseType(resType));
+			if (child == nullptr)
+				return nullptr;
+
+			// post increment/decrement evaluate to the old value
+			if (uexpr->IsPost && (uexpr->Operator == TokenType_Increment || uexpr->Operator == TokenType_Decrement))
+				return child;
+
+			Closure* ret = m_allocate(m_byBaseType<UnaryGetter>(GetBaseType(resType), uexpr->Operator), resType);
+			ret->Args.push_back(child);
+			return ret;
+		} break;
+		case NodeType::TernaryExpression: {
+			TernaryExpressionNode* texpr = (TernaryExpressionNode*)node;
+			Closure* cond = m_compile(texpr->Condition);
+			Closure* onTrue = cond ? m_compile(texpr->OnTrue) : nullptr;
+			Closure* onFalse = onTrue ? m_compile(texpr->OnFalse) : nullptr;
+			if (onFalse == nullptr)
+				return nullptr;
+
+			if (GetBaseType(cond->Type) != ValueType::Bool || IsMatrix(cond->Type))
+				return m_fail("invalid ternary expression");
+
+			if (onTrue->Type != onFalse->Type) {
+				ValueType opBase, resType;
+				if (!ResolveBinaryType('+', onTrue->Type, onFalse->Type, opBase, resType) || IsScalar(onTrue->Type) != IsScalar(onFalse->Type))
+					return m_fail("invalid ternary expression");
+				onTrue = m_convert(onTrue, opBase);
+				onFalse = m_convert(onFalse, opBase);
+				if (onTrue == nullptr || onFalse == nullptr || onTrue->Type != onFalse->Type)
+					return m_fail("invalid ternary expression");
+			}
+
+			Closure* ret = nullptr;
+			if (IsScalar(cond->Type))
+				ret = m_allocate(m_select, onTrue->Type);
+			else {
+				if (IsMatrix(onTrue->Type) || cond->Count != onTrue->Count)
+					return m_fail("invalid ternary expression");
+				ret = m_allocate(m_byBaseType<SelectGetter>(GetBaseType(onTrue->Type)), onTrue->Type);
+			}
+
+			ret->Args.push_back(cond);
+			ret->Args.push_back(onTrue);
+			ret->Args.push_back(onFalse);
+			return ret;
+		} break;
+		case NodeType::Cast: {
+			CastNode* cast = (CastNode*)node;
+			ValueType type;
+			Closure* child = m_compile(cast->Object);
+			if (child == nullptr)
+				return nullptr;
+			if (!GetTokenValueType(cast->Type, type))
+				return m_fail("invalid cast");
+
+			// scalar casts only change the base type, see ApplyCast()
+			if (IsScalar(type))
+				return m_convert(child, type);
+
+			std::vector<Closure*> args(1, child);
+			return m_compileConstruct(type, args);
+		} break;
+		case NodeType::FunctionCall: {
+			FunctionCallNode* fcall = (FunctionCallNode*)node;
+			std::vector<Closure*> args(fcall->Arguments.size(), nullptr);
+			ValueType argTypes[16];
+			if (args.size() > 16)
+				return m_fail("too many arguments");
+
+			for (int i = 0; i < args.size(); i++) {
+				args[i] = m_compile(fcall->Arguments[i]);
+				if (args[i] == nullptr)
+					return nullptr;
+				argTypes[i] = args[i]->Type;
+			}
+
+			ValueType type;
+			if (GetTokenValueType(fcall->TokenType, type))
+				return m_compileConstruct(type, args);
+
+			NativeFunction func = GetNativeFunction((Builtin)fcall->BuiltinID, m_mathMode);
+			if (func == nullptr)
+				return m_fail(FindBuiltin(fcall->Name) ? "wrong number of arguments passed to a builtin function" : "function can't be evaluated natively");
+			if (args.size() > 3 || !ResolveFunctionType(func, argTypes, (int)args.size(), type))
+				return m_fail("invalid arguments");
+
+			ArrayFunction array = GetArrayFunction((Builtin)fcall->BuiltinID, (int)args.size(), m_mathMode);
+			bool isArray = array != nullptr && GetBaseType(type) == ValueType::Float;
+			for (Closure* arg : args)
+				isArray = isArray && GetBaseType(arg->Type) == ValueType::Float && (arg->Type == type || IsScalar(arg->Type));
+
+			Closure* ret = m_allocate(isArray ? (args.size() == 1 ? m_arrayKernel<1> : m_arrayKernel<2>) : m_native, type);
+			ret->Native = func;
+			ret->Array = array;
+			ret->Args = args;
+			for (int i = 0; i < args.size() && i < 2; i++)
+				ret->Steps[i] = IsScalar(args[i]->Type) ? 0 : 1;
+			return ret;
+		} break;
+		case NodeType::MemberAccess: {
+			MemberAccessNode* maccess = (MemberAccessNode*)node;
+			Closure* obj = m_compile(maccess->Object);
+			if (obj == nullptr)
+				return nullptr;
+
+			const int* indices = maccess->Swizzle;
+			int count = IsMatrix(obj->Type) ? 0 : maccess->SwizzleCount;
+			if (count == 0)
+				return m_fail("invalid swizzle");
+
+			Closure* ret = m_allocate(m_byBaseType<SwizzleGetter>(GetBaseType(obj->Type)), GetVectorType(GetBaseType(obj->Type), count));
+			for (int i = 0; i < count; i++) {
+				if (indices[i] >= obj->Count)
+					return m_fail("invalid swizzle");
+				ret->Indices[i] = indices[i];
+			}
+
+			ret->Args.push_back(obj);
+			return ret;
+		} break;
+		case NodeType::ArrayAccess: {
+			ArrayAccessNode* aaccess = (ArrayAccessNode*)node;
+			Closure* obj = m_compile(aaccess->Object);
+			if (obj == nullptr)
+				return nullptr;
+
+			for (Node* indexNode : aaccess->Indices) {
+				Closure* index = m_compile(indexNode);
+				if (index == nullptr)
+					return nullptr;
+
+				ValueType indexBase = GetBaseType(index->Type);
+				if (!IsScalar(index->Type) || (indexBase != ValueType::Int && indexBase != ValueType::Uint) || IsScalar(obj->Type))
+					return m_fail("invalid index");
+
+				Closure* ret = nullptr;
+				if (IsMatrix(obj->Type)) {
+					ret = m_allocate(m_columnIndex, GetVectorType(ValueType::Float, GetRowCount(obj->Type)));
+					ret->Indices[0] = GetColumnCount(obj->Type);
+				} else {
+					ret = m_allocate(m_byBaseType<IndexGetter>(GetBaseType(obj->Type)), GetBaseType(obj->Type));
+					ret->Indices[0] = obj->Count;
+				}
+
+				ret->Args.push_back(obj);
+				ret->Args.push_back(index);
+				obj = ret;
+			}
+
+			return obj;
+		} break;
+		default: break;
+		}
+
+		return m_fail("unsupported expression");
+	}
+}
\ No newline at end of file
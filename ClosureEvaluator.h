@@ -0,0 +1,67 @@
+#pragma once
+#include "Evaluator.h"
+#include "Functions.h"
+
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace expr
+{
+	// compiles the AST once into a tree of type specialized callables - operand types
+	// are resolved ahead of time so evaluating is just a chain of direct calls
+	class ClosureEvaluator : public Evaluator
+	{
+	public:
+		struct Closure
+		{
+			typedef void (*Function)(const Closure* self, Value& out);
+
+			Function Call;
+			ValueType Type;
+			int Count; // number of components in the result
+
+			std::vector<Closure*> Args;
+			int Steps[2]; // 0 for broadcasted scalars
+			int Indices[4];
+			const Value* Source;
+			NativeFunction Native;
+			ArrayFunction Array;
+			Value Constant;
+
+			// shared nodes are computed once per Evaluate() and then reused
+			const unsigned int* Epoch;
+			mutable unsigned int CachedEpoch;
+			mutable Value Cache;
+		};
+
+		ClosureEvaluator(Node* root);
+		~ClosureEvaluator();
+
+		// changing the type of a variable triggers a recompile on the next Evaluate()
+		virtual void SetVariable(const std::string& name, const Value& val);
+		virtual bool Evaluate(Value& out);
+		virtual void SetMathMode(MathMode mode); // recompiles on the next Evaluate()
+
+		bool Compile();
+
+	private:
+		Closure* m_compile(Node* node);
+		Closure* m_compileNode(Node* node);
+		Closure* m_compileConstruct(ValueType type, std::vector<Closure*>& args);
+		Closure* m_convert(Closure* child, ValueType baseType);
+		Closure* m_allocate(Closure::Function func, ValueType type);
+		Closure* m_fail(const char* msg);
+		void m_clear();
+
+		Node* m_root;
+		Closure* m_closure;
+		bool m_isCompiled;
+
+		std::vector<Closure*> m_closures;
+		std::unordered_set<Node*> m_shared;
+		std::unordered_map<Node*, Closure*> m_compiled;
+		unsigned int m_epoch;
+		std::unordered_map<std::string, Value> m_vars;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+#include "Value.h"
+#include "Functions.h"
+#include <string>
+
+namespace expr
+{
+	// common interface of the native (CPU) evaluators
+	class Evaluator
+	{
+	public:
+		Evaluator() : m_hasError(false), m_mathMode(MathMode::Precise) { }
+		virtual ~Evaluator() { }
+
+		virtual void SetVariable(const std::string& name, const Value& val) = 0;
+		virtual bool Evaluate(Value& out) = 0;
+
+		// picks between the libm and the polynomial (FastMath.h) implementations of the builtins
+		virtual void SetMathMode(MathMode mode) { m_mathMode = mode; }
+		inline MathMode GetMathMode() { return m_mathMode; }
+
+		inline bool Error() { return m_hasError; }
+		inline const std::string& ErrorMessage() { return m_error; }
+
+	protected:
+		bool m_hasError;
+		std::string m_error;
+		MathMode m_mathMode;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,276 @@
+#include "FastMath.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EXPR_FASTMATH_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace expr
+{
+#ifdef EXPR_FASTMATH_SSE2
+	// SSE2 ports of the kernels in FastMath.h - they have to give the same results, so keep them in sync.
+	// SSE2 has no blend instruction, selects are and/andnot/or.
+	static inline __m128 m_select4(__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+	static inline __m128 m_const4(float x) { return _mm_set1_ps(x); }
+	static inline __m128 m_bits4(uint32_t x) { return _mm_castsi128_ps(_mm_set1_epi32((int)x)); }
+	static inline __m128 m_madd4(__m128 a, __m128 b, float c) { return _mm_add_ps(_mm_mul_ps(a, b), m_const4(c)); }
+
+	static inline __m128 m_roundFast4(__m128 x)
+	{
+		__m128 magic = m_const4(12582912.0f);
+		return _mm_sub_ps(_mm_add_ps(x, magic), magic);
+	}
+	static inline __m128 m_pow2i4(__m128i n)
+	{
+		return _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23));
+	}
+	static inline __m128 m_scale4(__m128 p, __m128 n)
+	{
+		__m128i e = _mm_cvtps_epi32(n);
+		__m128i half = _mm_srai_epi32(e, 1);
+		return _mm_mul_ps(_mm_mul_ps(p, m_pow2i4(half)), m_pow2i4(_mm_sub_epi32(e, half)));
+	}
+
+	static inline __m128 m_sinPoly4(__m128 r)
+	{
+		__m128 z = _mm_mul_ps(r, r);
+		__m128 p = m_madd4(_mm_add_ps(_mm_mul_ps(m_const4(-1.9515295891e-4f), z), m_const4(8.3321608736e-3f)), z, -1.6666654611e-1f);
+		return _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, z), p));
+	}
+	static inline __m128 m_cosPoly4(__m128 r)
+	{
+		__m128 z = _mm_mul_ps(r, r);
+		__m128 p = m_madd4(_mm_add_ps(_mm_mul_ps(m_const4(2.443315711809948e-5f), z), m_const4(-1.388731625493765e-3f)), z, 4.166664568298827e-2f);
+		return _mm_add_ps(_mm_sub_ps(m_const4(1.0f), _mm_mul_ps(m_const4(0.5f), z)), _mm_mul_ps(_mm_mul_ps(z, z), p));
+	}
+	static inline __m128 m_reduceHalfPi4(__m128 x, __m128i& quadrant)
+	{
+		__m128 q = m_roundFast4(_mm_mul_ps(x, m_const4(0.63661977236758134f)));
+		quadrant = _mm_cvtps_epi32(q);
+		__m128 r = _mm_sub_ps(x, _mm_mul_ps(q, m_const4(1.5703125f)));
+		r = _mm_sub_ps(r, _mm_mul_ps(q, m_const4(4.837512969970703125e-4f)));
+		return _mm_sub_ps(r, _mm_mul_ps(q, m_const4(7.549790126404332e-8f)));
+	}
+	// picks the polynomial and the sign from the quadrant
+	static inline __m128 m_sinCos4(__m128 x, int offset)
+	{
+		__m128i q;
+		__m128 r = m_reduceHalfPi4(x, q);
+		q = _mm_add_epi32(q, _mm_set1_epi32(offset));
+
+		__m128 s = m_sinPoly4(r), c = m_cosPoly4(r);
+		__m128 isOdd = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+		__m128 ret = m_select4(isOdd, c, s);
+		__m128 sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, _mm_set1_epi32(2)), 30));
+		return _mm_xor_ps(ret, sign);
+	}
+	// lanes that m_isReducible() rejects are recomputed with the scalar version, which uses libm for them
+	template<float(*Scalar)(float)>
+	static inline __m128 m_fixLarge4(__m128 x, __m128 ret)
+	{
+		__m128 isReducible = _mm_and_ps(_mm_cmpgt_ps(x, m_const4(-65536.0f)), _mm_cmplt_ps(x, m_const4(65536.0f)));
+		int mask = _mm_movemask_ps(isReducible);
+		if (mask == 0xF)
+			return ret;
+
+		alignas(16) float xs[4], rs[4];
+		_mm_store_ps(xs, x);
+		_mm_store_ps(rs, ret);
+		for (int i = 0; i < 4; i++)
+			if (!(mask & (1 << i)))
+				rs[i] = Scalar(xs[i]);
+		return _mm_load_ps(rs);
+	}
+	static inline __m128 m_sin4(__m128 x) { return m_fixLarge4<FastSin>(x, m_sinCos4(x, 0)); }
+	static inline __m128 m_cos4(__m128 x) { return m_fixLarge4<FastCos>(x, m_sinCos4(x, 1)); } // cos(x) = sin(x + pi/2)
+
+	static inline __m128 m_expSpecial4(__m128 x, __m128 ret, float low, float high)
+	{
+		ret = _mm_andnot_ps(_mm_cmplt_ps(x, m_const4(low)), ret);
+		ret = m_select4(_mm_cmpgt_ps(x, m_const4(high)), m_bits4(0x7F800000), ret);
+		return m_select4(_mm_cmpunord_ps(x, x), x, ret);
+	}
+	static inline __m128 m_exp4(__m128 x)
+	{
+		__m128 t = _mm_max_ps(x, m_const4(-87.33654f)); // NaN is replaced by the second operand
+		t = _mm_min_ps(t, m_const4(88.72283f));
+
+		__m128 n = m_roundFast4(_mm_mul_ps(t, m_const4(1.44269504088896341f)));
+		__m128 r = _mm_add_ps(_mm_sub_ps(t, _mm_mul_ps(n, m_const4(0.693359375f))), _mm_mul_ps(n, m_const4(2.12194440e-4f)));
+
+		__m128 z = _mm_mul_ps(r, r);
+		__m128 p = m_const4(1.9875691500e-4f);
+		p = m_madd4(p, r, 1.3981999507e-3f);
+		p = m_madd4(p, r, 8.3334519073e-3f);
+		p = m_madd4(p, r, 4.1665795894e-2f);
+		p = m_madd4(p, r, 1.6666665459e-1f);
+		p = m_madd4(p, r, 5.0000001201e-1f);
+		p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p, z), r), m_const4(1.0f));
+
+		return m_expSpecial4(x, m_scale4(p, n), -87.33654f, 88.72283f);
+	}
+	static inline __m128 m_exp2_4(__m128 x)
+	{
+		__m128 t = _mm_max_ps(x, m_const4(-126.0f));
+		t = _mm_min_ps(t, m_const4(128.0f));
+
+		__m128 n = m_roundFast4(t);
+		__m128 r = _mm_sub_ps(t, n);
+
+		__m128 p = m_const4(1.535336188319500e-4f);
+		p = m_madd4(p, r, 1.339887440266574e-3f);
+		p = m_madd4(p, r, 9.618437357674640e-3f);
+		p = m_madd4(p, r, 5.550332471162809e-2f);
+		p = m_madd4(p, r, 2.402264791363012e-1f);
+		p = m_madd4(p, r, 6.931472028550421e-1f);
+		p = m_madd4(p, r, 1.0f);
+
+		return m_expSpecial4(x, m_scale4(p, n), -126.0f, 128.0f);
+	}
+
+	static inline __m128 m_logMantissa4(__m128 x, __m128& e)
+	{
+		__m128i bits = _mm_castps_si128(x);
+		__m128i exponent = _mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(bits, 23), _mm_set1_epi32(0xFF)), _mm_set1_epi32(127));
+		__m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000)));
+
+		__m128 isLarge = _mm_cmpgt_ps(m, m_const4(1.41421356237f));
+		m = m_select4(isLarge, _mm_mul_ps(m, m_const4(0.5f)), m);
+		e = _mm_add_ps(_mm_cvtepi32_ps(exponent), _mm_and_ps(isLarge, m_const4(1.0f)));
+
+		__m128 y = _mm_sub_ps(m, m_const4(1.0f));
+		__m128 z = _mm_mul_ps(y, y);
+		__m128 p = m_const4(7.0376836292e-2f);
+		p = m_madd4(p, y, -1.1514610310e-1f);
+		p = m_madd4(p, y, 1.1676998740e-1f);
+		p = m_madd4(p, y, -1.2420140846e-1f);
+		p = m_madd4(p, y, 1.4249322787e-1f);
+		p = m_madd4(p, y, -1.6668057665e-1f);
+		p = m_madd4(p, y, 2.0000714765e-1f);
+		p = m_madd4(p, y, -2.4999993993e-1f);
+		p = m_madd4(p, y, 3.3333331174e-1f);
+		return _mm_add_ps(y, _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(y, z), p), _mm_mul_ps(m_const4(0.5f), z)));
+	}
+	static inline __m128 m_logSpecial4(__m128 x, __m128 ret)
+	{
+		__m128 inf = m_bits4(0x7F800000), nan = m_bits4(0x7FC00000);
+		ret = m_select4(_mm_cmpeq_ps(x, inf), inf, ret);
+		ret = m_select4(_mm_cmplt_ps(x, m_const4(1.17549435e-38f)), m_bits4(0xFF800000), ret);
+		ret = m_select4(_mm_or_ps(_mm_cmplt_ps(x, _mm_setzero_ps()), _mm_cmpunord_ps(x, x)), nan, ret);
+		return ret;
+	}
+	static inline __m128 m_log4(__m128 x)
+	{
+		__m128 e;
+		__m128 y = m_logMantissa4(x, e);
+		__m128 ret = _mm_add_ps(_mm_add_ps(y, _mm_mul_ps(e, m_const4(-2.12194440e-4f))), _mm_mul_ps(e, m_const4(0.693359375f)));
+		return m_logSpecial4(x, ret);
+	}
+	static inline __m128 m_log2_4(__m128 x)
+	{
+		__m128 e;
+		__m128 y = m_logMantissa4(x, e);
+		__m128 ret = _mm_add_ps(_mm_mul_ps(y, m_const4(1.44269504088896341f)), e);
+		return m_logSpecial4(x, ret);
+	}
+
+	static inline __m128 m_pow4(__m128 x, __m128 y)
+	{
+		__m128 ret = m_exp2_4(_mm_mul_ps(y, m_log2_4(x)));
+		ret = m_select4(_mm_cmpeq_ps(y, _mm_setzero_ps()), m_const4(1.0f), ret);
+		ret = m_select4(_mm_and_ps(_mm_cmpeq_ps(x, _mm_setzero_ps()), _mm_cmpgt_ps(y, _mm_setzero_ps())), _mm_setzero_ps(), ret);
+		return ret;
+	}
+
+	static inline __m128 m_inverseSqrt4(__m128 x)
+	{
+		__m128 y = _mm_castsi128_ps(_mm_sub_epi32(_mm_set1_epi32(0x5F375A86), _mm_srli_epi32(_mm_castps_si128(x), 1)));
+		__m128 halfX = _mm_mul_ps(m_const4(0.5f), x);
+		for (int i = 0; i < 3; i++)
+			y = _mm_mul_ps(y, _mm_sub_ps(m_const4(1.5f), _mm_mul_ps(_mm_mul_ps(halfX, y), y)));
+
+		__m128 inf = m_bits4(0x7F800000);
+		y = m_select4(_mm_cmpeq_ps(x, inf), _mm_setzero_ps(), y);
+		y = m_select4(_mm_cmplt_ps(x, m_const4(1.17549435e-38f)), inf, y);
+		y = m_select4(_mm_or_ps(_mm_cmplt_ps(x, _mm_setzero_ps()), _mm_cmpunord_ps(x, x)), m_bits4(0x7FC00000), y);
+		return y;
+	}
+
+	static inline __m128 m_atan2_4(__m128 y, __m128 x)
+	{
+		__m128 signMask = m_bits4(0x80000000);
+		__m128 ax = _mm_andnot_ps(signMask, x);
+		__m128 ay = _mm_andnot_ps(signMask, y);
+		__m128 isSteep = _mm_cmpgt_ps(ay, ax);
+		__m128 mx = m_select4(isSteep, ay, ax);
+		__m128 mn = m_select4(isSteep, ax, ay);
+		__m128 a = _mm_andnot_ps(_mm_cmpeq_ps(mx, _mm_setzero_ps()), _mm_div_ps(mn, mx));
+
+		__m128 isUpper = _mm_cmpgt_ps(a, m_const4(0.4142135623730950f));
+		__m128 t = m_select4(isUpper, _mm_div_ps(_mm_sub_ps(a, m_const4(1.0f)), _mm_add_ps(a, m_const4(1.0f))), a);
+		__m128 z = _mm_mul_ps(t, t);
+		__m128 p = m_madd4(m_const4(8.05374449538e-2f), z, -1.38776856032e-1f);
+		p = m_madd4(p, z, 1.99777106478e-1f);
+		p = m_madd4(p, z, -3.33329491539e-1f);
+		__m128 r = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, z), t), t);
+		r = m_select4(isUpper, _mm_add_ps(r, m_const4(0.785398163397448309616f)), r);
+
+		r = m_select4(isSteep, _mm_sub_ps(m_const4(1.57079632679489661923f), r), r);
+		__m128 isNegativeX = _mm_castsi128_ps(_mm_srai_epi32(_mm_castps_si128(x), 31));
+		r = m_select4(isNegativeX, _mm_sub_ps(m_const4(3.14159265358979323846f), r), r);
+		return _mm_xor_ps(r, _mm_and_ps(y, signMask));
+	}
+
+	template<float(*Scalar)(float), __m128(*Vector)(__m128)>
+	static void m_apply(const float* x, float* out, int count)
+	{
+		int i = 0;
+		for (; i + 4 <= count; i += 4)
+			_mm_storeu_ps(out + i, Vector(_mm_loadu_ps(x + i)));
+		for (; i < count; i++)
+			out[i] = Scalar(x[i]);
+	}
+	template<float(*Scalar)(float, float), __m128(*Vector)(__m128, __m128)>
+	static void m_apply(const float* x, const float* y, float* out, int count)
+	{
+		int i = 0;
+		for (; i + 4 <= count; i += 4)
+			_mm_storeu_ps(out + i, Vector(_mm_loadu_ps(x + i), _mm_loadu_ps(y + i)));
+		for (; i < count; i++)
+			out[i] = Scalar(x[i], y[i]);
+	}
+
+	void FastSin(const float* x, float* out, int count) { m_apply<FastSin, m_sin4>(x, out, count); }
+	void FastCos(const float* x, float* out, int count) { m_apply<FastCos, m_cos4>(x, out, count); }
+	void FastExp(const float* x, float* out, int count) { m_apply<FastExp, m_exp4>(x, out, count); }
+	void FastExp2(const float* x, float* out, int count) { m_apply<FastExp2, m_exp2_4>(x, out, count); }
+	void FastLog(const float* x, float* out, int count) { m_apply<FastLog, m_log4>(x, out, count); }
+	void FastLog2(const float* x, float* out, int count) { m_apply<FastLog2, m_log2_4>(x, out, count); }
+	void FastPow(const float* x, const float* y, float* out, int count) { m_apply<FastPow, m_pow4>(x, y, out, count); }
+	void FastInverseSqrt(const float* x, float* out, int count) { m_apply<FastInverseSqrt, m_inverseSqrt4>(x, out, count); }
+	void FastAtan2(const float* y, const float* x, float* out, int count) { m_apply<FastAtan2, m_atan2_4>(y, x, out, count); }
+#else
+	template<float(*Scalar)(float)>
+	static void m_apply(const float* x, float* out, int count)
+	{
+		for (int i = 0; i < count; i++)
+			out[i] = Scalar(x[i]);
+	}
+	template<float(*Scalar)(float, float)>
+	static void m_apply(const float* x, const float* y, float* out, int count)
+	{
+		for (int i = 0; i < count; i++)
+			out[i] = Scalar(x[i], y[i]);
+	}
+
+	void FastSin(const float* x, float* out, int count) { m_apply<FastSin>(x, out, count); }
+	void FastCos(const float* x, float* out, int count) { m_apply<FastCos>(x, out, count); }
+	void FastExp(const float* x, float* out, int count) { m_apply<FastExp>(x, out, count); }
+	void FastExp2(const float* x, float* out, int count) { m_apply<FastExp2>(x, out, count); }
+	void FastLog(const float* x, float* out, int count) { m_apply<FastLog>(x, out, count); }
+	void FastLog2(const float* x, float* out, int count) { m_apply<FastLog2>(x, out, count); }
+	void FastPow(const float* x, const float* y, float* out, int count) { m_apply<FastPow>(x, y, out, count); }
+	void FastInverseSqrt(const float* x, float* out, int count) { m_apply<FastInverseSqrt>(x, out, count); }
+	void FastAtan2(const float* y, const float* x, float* out, int count) { m_apply<FastAtan2>(y, x, out, count); }
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,237 @@
+#pragma once
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+namespace expr
+{
+	// polynomial approximations of the transcendental builtins, used by the evaluators in MathMode::Fast.
+	// Everything is branch free (conditions are selects) so that loops over components or lanes can be
+	// vectorized by the compiler - the one exception are sin and cos of inputs outside |x| < 65536 (and
+	// inf/NaN), which the reduction can't handle and which go to libm instead.
+	// Coefficients are the single precision minimax polynomials from Cephes.
+	//
+	// max error, measured against the double precision libm functions:
+	//		FastSin, FastCos		2 ulp for |x| <= pi, absolute error below 1e-7 for |x| < 6000 and below 1e-6 up to 65536
+	//		FastExp, FastLog		1 ulp
+	//		FastExp2, FastLog2		2 ulp
+	//		FastPow					exp2(y * log2(x)) like the GPU implementations, the error grows with |y * log2(x)|:
+	//								2 ulp + ~1.2 ulp per unit of it, x < 0 gives NaN
+	//		FastInverseSqrt			3 ulp
+	//		FastAtan2				4 ulp, atan2(0, 0) = 0 and atan2(inf, inf) is NaN
+	// denormal results are flushed to zero, which GPUs do as well, and NaN inputs give NaN
+	//
+	// the array versions (FastMath.cpp) compute 4 values at once with SSE2 where it's available
+	void FastSin(const float* x, float* out, int count);
+	void FastCos(const float* x, float* out, int count);
+	void FastExp(const float* x, float* out, int count);
+	void FastExp2(const float* x, float* out, int count);
+	void FastLog(const float* x, float* out, int count);
+	void FastLog2(const float* x, float* out, int count);
+	void FastPow(const float* x, const float* y, float* out, int count);
+	void FastInverseSqrt(const float* x, float* out, int count);
+	void FastAtan2(const float* y, const float* x, float* out, int count);
+
+	inline float m_asFloat(uint32_t bits) { float ret; memcpy(&ret, &bits, 4); return ret; }
+	inline uint32_t m_asUint(float val) { uint32_t ret; memcpy(&ret, &val, 4); return ret; }
+
+	// rounds to the nearest integer (ties to even) for |x| < 2^22
+	inline float m_roundFast(float x)
+	{
+		const float magic = 12582912.0f; // 1.5 * 2^23
+		return (x + magic) - magic;
+	}
+	// 2^n for integer n in [-126, 127]
+	inline float m_pow2i(int n)
+	{
+		return m_asFloat((uint32_t)(n + 127) << 23);
+	}
+
+	// sin(r) and cos(r) for r in [-pi/4, pi/4]
+	inline float m_sinPoly(float r)
+	{
+		float z = r * r;
+		return r + r * z * ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z - 1.6666654611e-1f);
+	}
+	inline float m_cosPoly(float r)
+	{
+		float z = r * r;
+		return 1.0f - 0.5f * z + z * z * ((2.443315711809948e-5f * z - 1.388731625493765e-3f) * z + 4.166664568298827e-2f);
+	}
+	// x = q * pi/2 + r, pi/2 is split into three parts so that the subtraction stays exact
+	inline float m_reduceHalfPi(float x, int& quadrant)
+	{
+		float q = m_roundFast(x * 0.63661977236758134f);
+		quadrant = (int)q;
+		return ((x - q * 1.5703125f) - q * 4.837512969970703125e-4f) - q * 7.549790126404332e-8f;
+	}
+	// inputs the reduction above handles, the quadrant would overflow long before 2^31
+	inline bool m_isReducible(float x)
+	{
+		return x > -65536.0f && x < 65536.0f; // false for NaN
+	}
+	inline float FastSin(float x)
+	{
+		if (!m_isReducible(x))
+			return sinf(x);
+
+		int q;
+		float r = m_reduceHalfPi(x, q);
+		float s = m_sinPoly(r), c = m_cosPoly(r);
+		float ret = (q & 1) ? c : s;
+		return (q & 2) ? -ret : ret;
+	}
+	inline float FastCos(float x)
+	{
+		if (!m_isReducible(x))
+			return cosf(x);
+
+		int q;
+		float r = m_reduceHalfPi(x, q);
+		float s = m_sinPoly(r), c = m_cosPoly(r);
+		float ret = (q & 1) ? s : c;
+		return ((q + 1) & 2) ? -ret : ret;
+	}
+
+	// results below the normal range are flushed to zero, above it they are inf
+	inline float m_expSpecial(float x, float ret, float low, float high)
+	{
+		const float inf = m_asFloat(0x7F800000);
+		ret = x < low ? 0.0f : ret;
+		ret = x > high ? inf : ret;
+		return x != x ? x : ret;
+	}
+	inline float FastExp(float x)
+	{
+		// NaN is replaced by the lower bound here, m_expSpecial() puts it back
+		float t = x > -87.33654f ? x : -87.33654f;
+		t = t < 88.72283f ? t : 88.72283f;
+
+		// t = n * ln2 + r, |r| <= ln2 / 2
+		float n = m_roundFast(t * 1.44269504088896341f);
+		float r = (t - n * 0.693359375f) + n * 2.12194440e-4f;
+
+		float z = r * r;
+		float p = 1.9875691500e-4f;
+		p = p * r + 1.3981999507e-3f;
+		p = p * r + 8.3334519073e-3f;
+		p = p * r + 4.1665795894e-2f;
+		p = p * r + 1.6666665459e-1f;
+		p = p * r + 5.0000001201e-1f;
+		p = p * z + r + 1.0f;
+
+		// n can reach 128 here, so scale in two steps
+		int e = (int)n;
+		return m_expSpecial(x, p * m_pow2i(e >> 1) * m_pow2i(e - (e >> 1)), -87.33654f, 88.72283f);
+	}
+	inline float FastExp2(float x)
+	{
+		float t = x > -126.0f ? x : -126.0f;
+		t = t < 128.0f ? t : 128.0f;
+
+		float n = m_roundFast(t);
+		float r = t - n;
+
+		float p = 1.535336188319500e-4f;
+		p = p * r + 1.339887440266574e-3f;
+		p = p * r + 9.618437357674640e-3f;
+		p = p * r + 5.550332471162809e-2f;
+		p = p * r + 2.402264791363012e-1f;
+		p = p * r + 6.931472028550421e-1f;
+		p = p * r + 1.0f;
+
+		int e = (int)n;
+		return m_expSpecial(x, p * m_pow2i(e >> 1) * m_pow2i(e - (e >> 1)), -126.0f, 128.0f);
+	}
+
+	// natural log of m, where x = m * 2^e and m is in [sqrt(0.5), sqrt(2))
+	inline float m_logMantissa(float x, float& e)
+	{
+		uint32_t bits = m_asUint(x);
+		int exponent = (int)((bits >> 23) & 0xFF) - 127;
+		float m = m_asFloat((bits & 0x007FFFFF) | 0x3F800000);	// [1, 2)
+
+		bool isLarge = m > 1.41421356237f;
+		m = isLarge ? m * 0.5f : m;
+		e = (float)(exponent + (isLarge ? 1 : 0));
+
+		float y = m - 1.0f;
+		float z = y * y;
+		float p = 7.0376836292e-2f;
+		p = p * y - 1.1514610310e-1f;
+		p = p * y + 1.1676998740e-1f;
+		p = p * y - 1.2420140846e-1f;
+		p = p * y + 1.4249322787e-1f;
+		p = p * y - 1.6668057665e-1f;
+		p = p * y + 2.0000714765e-1f;
+		p = p * y - 2.4999993993e-1f;
+		p = p * y + 3.3333331174e-1f;
+		return y + (y * z * p - 0.5f * z);
+	}
+	inline float m_logSpecial(float x, float ret)
+	{
+		const float inf = m_asFloat(0x7F800000), nan = m_asFloat(0x7FC00000);
+		ret = x == inf ? inf : ret;
+		ret = x < 1.17549435e-38f ? -inf : ret;	// zero and denormals (flushed)
+		ret = x < 0.0f || x != x ? nan : ret;
+		return ret;
+	}
+	inline float FastLog(float x)
+	{
+		float e;
+		float y = m_logMantissa(x, e);
+		float ret = (y + e * -2.12194440e-4f) + e * 0.693359375f;
+		return m_logSpecial(x, ret);
+	}
+	inline float FastLog2(float x)
+	{
+		float e;
+		float y = m_logMantissa(x, e);
+		float ret = y * 1.44269504088896341f + e;
+		return m_logSpecial(x, ret);
+	}
+
+	inline float FastPow(float x, float y)
+	{
+		float ret = FastExp2(y * FastLog2(x));
+		ret = y == 0.0f ? 1.0f : ret;
+		ret = (x == 0.0f && y > 0.0f) ? 0.0f : ret;
+		return ret;
+	}
+
+	inline float FastInverseSqrt(float x)
+	{
+		// initial guess from the exponent (3.4% error), then newton steps
+		float y = m_asFloat(0x5F375A86 - (m_asUint(x) >> 1));
+		float halfX = 0.5f * x;
+		y = y * (1.5f - halfX * y * y);
+		y = y * (1.5f - halfX * y * y);
+		y = y * (1.5f - halfX * y * y);
+
+		const float inf = m_asFloat(0x7F800000), nan = m_asFloat(0x7FC00000);
+		y = x == inf ? 0.0f : y;
+		y = x < 1.17549435e-38f ? inf : y;
+		y = x < 0.0f || x != x ? nan : y;
+		return y;
+	}
+
+	inline float FastAtan2(float y, float x)
+	{
+		float ax = x < 0.0f ? -x : x;
+		float ay = y < 0.0f ? -y : y;
+		float mx = ax > ay ? ax : ay;
+		float mn = ax > ay ? ay : ax;
+		float a = mx == 0.0f ? 0.0f : mn / mx; // [0, 1]
+
+		// atan(a) = pi/4 + atan((a - 1) / (a + 1)) above tan(pi/8)
+		bool isUpper = a > 0.4142135623730950f;
+		float t = isUpper ? (a - 1.0f) / (a + 1.0f) : a;
+		float z = t * t;
+		float r = (((8.05374449538e-2f * z - 1.38776856032e-1f) * z + 1.99777106478e-1f) * z - 3.33329491539e-1f) * z * t + t;
+		r = isUpper ? r + 0.785398163397448309616f : r;
+
+		r = ay > ax ? 1.57079632679489661923f - r : r;
+		r = (m_asUint(x) >> 31) ? 3.14159265358979323846f - r : r;
+		return (m_asUint(y) >> 31) ? -r : r;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,377 @@
+#include "Functions.h"
+#include "FastMath.h"
+#include "Operations.h"
+#include <string.h>
+#include <math.h>
+
+namespace expr
+{
+	// bool arguments are treated as int
+	static ValueType m_commonBase(const Value* args, int argCount)
+	{
+		ValueType ret = ValueType::Int;
+		for (int i = 0; i < argCount; i++) {
+			ValueType base = GetBaseType(args[i].Type);
+			if (base == ValueType::Float)
+				return ValueType::Float;
+			if (base == ValueType::Uint)
+				ret = ValueType::Uint;
+		}
+		return ret;
+	}
+	// converts every argument to baseType - arguments either share the same shape or are scalars
+	static bool m_prepare(const Value* args, int argCount, ValueType baseType, Value* conv, ValueType& shape)
+	{
+		shape = baseType;
+		for (int i = 0; i < argCount; i++) {
+			if (!ConvertValue(args[i], baseType, conv[i]))
+				return false;
+			if (!IsScalar(conv[i].Type)) {
+				if (!IsScalar(shape) && shape != conv[i].Type)
+					return false;
+				shape = conv[i].Type;
+			}
+		}
+		return true;
+	}
+	template<typename T, typename F, int N>
+	static void m_applyTyped(const Value* conv, const int* steps, T* out, int count)
+	{
+		const T* a = GetData<T>(conv[0]);
+		const T* b = GetData<T>(conv[N > 1 ? 1 : 0]);
+		const T* c = GetData<T>(conv[N > 2 ? 2 : 0]);
+
+		for (int i = 0; i < count; i++) {
+			if constexpr (N == 1)
+				out[i] = F::Apply(a[i * steps[0]]);
+			else if constexpr (N == 2)
+				out[i] = F::Apply(a[i * steps[0]], b[i * steps[1]]);
+			else
+				out[i] = F::Apply(a[i * steps[0]], b[i * steps[1]], c[i * steps[2]]);
+		}
+	}
+	template<typename F, int N, bool FloatOnly>
+	static bool m_componentWise(const Value* args, int argCount, Value& out)
+	{
+		if (argCount != N)
+			return false;
+
+		ValueType base = FloatOnly ? ValueType::Float : m_commonBase(args, N);
+		Value conv[N], ret;
+		ValueType shape;
+		if (!m_prepare(args, N, base, conv, shape))
+			return false;
+
+		int steps[N];
+		for (int i = 0; i < N; i++)
+			steps[i] = IsScalar(conv[i].Type) ? 0 : 1;
+
+		int count = GetComponentCount(shape);
+		ret.Type = shape;
+		if constexpr (FloatOnly)
+			m_applyTyped<float, F, N>(conv, steps, ret.Float, count);
+		else {
+			switch (base) {
+			case ValueType::Float: m_applyTyped<float, F, N>(conv, steps, ret.Float, count); break;
+			case ValueType::Int: m_applyTyped<int, F, N>(conv, steps, ret.Int, count); break;
+			case ValueType::Uint: m_applyTyped<unsigned int, F, N>(conv, steps, ret.Uint, count); break;
+			default: return false;
+			}
+		}
+
+		out = ret;
+		return true;
+	}
+
+	static bool m_atan(const Value* args, int argCount, Value& out)
+	{
+		if (argCount == 1)
+			return m_componentWise<FunctionOperation<Builtin_Atan>, 1, true>(args, argCount, out);
+		return m_componentWise<FunctionOperation<Builtin_Atan>, 2, true>(args, argCount, out);
+	}
+	static bool m_fastAtan(const Value* args, int argCount, Value& out)
+	{
+		if (argCount == 1)
+			return m_componentWise<FunctionOperation<Builtin_Atan>, 1, true>(args, argCount, out);
+		return m_componentWise<Float2<FastAtan2>, 2, true>(args, argCount, out);
+	}
+	static bool m_dot(const Value* args, int argCount, Value& out)
+	{
+		Value a, b;
+		if (argCount != 2 || IsMatrix(args[0].Type) || args[0].Type != args[1].Type ||
+			!ConvertValue(args[0], ValueType::Float, a) || !ConvertValue(args[1], ValueType::Float, b))
+			return false;
+
+		float sum = 0.0f;
+		for (int i = 0; i < GetRowCount(a.Type); i++)
+			sum += a.Float[i] * b.Float[i];
+
+		out = MakeFloat(sum);
+		return true;
+	}
+	static bool m_length(const Value* args, int argCount, Value& out)
+	{
+		if (argCount != 1)
+			return false;
+
+		Value pair[2] = { args[0], args[0] };
+		if (!m_dot(pair, 2, out))
+			return false;
+		out.Float[0] = sqrtf(out.Float[0]);
+		return true;
+	}
+	static bool m_distance(const Value* args, int argCount, Value& out)
+	{
+		Value diff;
+		if (argCount != 2 || !ApplyBinary('-', args[0], args[1], diff))
+			return false;
+		return m_length(&diff, 1, out);
+	}
+	static bool m_normalize(const Value* args, int argCount, Value& out)
+	{
+		Value len;
+		if (argCount != 1 || !m_length(args, 1, len))
+			return false;
+		return ApplyBinary('/', args[0], len, out);
+	}
+	static bool m_cross(const Value* args, int argCount, Value& out)
+	{
+		Value a, b, ret;
+		if (argCount != 2 || GetRowCount(args[0].Type) != 3 || args[0].Type != args[1].Type ||
+			!ConvertValue(args[0], ValueType::Float, a) || !ConvertValue(args[1], ValueType::Float, b))
+			return false;
+
+		ret.Type = ValueType::Float3;
+		ret.Float[0] = a.Float[1] * b.Float[2] - a.Float[2] * b.Float[1];
+		ret.Float[1] = a.Float[2] * b.Float[0] - a.Float[0] * b.Float[2];
+		ret.Float[2] = a.Float[0] * b.Float[1] - a.Float[1] * b.Float[0];
+
+		out = ret;
+		return true;
+	}
+	static bool m_any(const Value* args, int argCount, Value& out)
+	{
+		Value val;
+		if (argCount != 1 || IsMatrix(args[0].Type) || !ConvertValue(args[0], ValueType::Bool, val))
+			return false;
+
+		bool ret = false;
+		for (int i = 0; i < GetRowCount(val.Type); i++)
+			ret = ret || val.Bool[i];
+
+		out = MakeBool(ret);
+		return true;
+	}
+	static bool m_all(const Value* args, int argCount, Value& out)
+	{
+		Value val;
+		if (argCount != 1 || IsMatrix(args[0].Type) || !ConvertValue(args[0], ValueType::Bool, val))
+			return false;
+
+		bool ret = true;
+		for (int i = 0; i < GetRowCount(val.Type); i++)
+			ret = ret && val.Bool[i];
+
+		out = MakeBool(ret);
+		return true;
+	}
+	// gauss-jordan elimination on a column major n*n matrix, returns the determinant
+	static float m_invert(const float* m, int n, float* inv)
+	{
+		float tmp[16];
+		float det = 1.0f;
+		for (int i = 0; i < n * n; i++) {
+			tmp[i] = m[i];
+			inv[i] = (i / n == i % n) ? 1.0f : 0.0f;
+		}
+
+		for (int c = 0; c < n; c++) {
+			int pivot = c;
+			for (int r = c + 1; r < n; r++)
+				if (fabsf(tmp[c * n + r]) > fabsf(tmp[c * n + pivot]))
+					pivot = r;
+
+			if (tmp[c * n + pivot] == 0.0f)
+				return 0.0f;
+
+			if (pivot != c) {
+				for (int k = 0; k < n; k++) {
+					float t = tmp[k * n + c]; tmp[k * n + c] = tmp[k * n + pivot]; tmp[k * n + pivot] = t;
+					t = inv[k * n + c]; inv[k * n + c] = inv[k * n + pivot]; inv[k * n + pivot] = t;
+				}
+				det = -det;
+			}
+
+			float p = tmp[c * n + c];
+			det *= p;
+			for (int k = 0; k < n; k++) {
+				tmp[k * n + c] /= p;
+				inv[k * n + c] /= p;
+			}
+
+			for (int r = 0; r < n; r++) {
+				if (r == c) continue;
+				float f = tmp[c * n + r];
+				for (int k = 0; k < n; k++) {
+					tmp[k * n + r] -= f * tmp[k * n + c];
+					inv[k * n + r] -= f * inv[k * n + c];
+				}
+			}
+		}
+
+		return det;
+	}
+	static bool m_determinant(const Value* args, int argCount, Value& out)
+	{
+		if (argCount != 1 || !IsMatrix(args[0].Type) || GetColumnCount(args[0].Type) != GetRowCount(args[0].Type))
+			return false;
+
+		float inv[16];
+		out = MakeFloat(m_invert(args[0].Float, GetRowCount(args[0].Type), inv));
+		return true;
+	}
+	static bool m_inverse(const Value* args, int argCount, Value& out)
+	{
+		if (argCount != 1 || !IsMatrix(args[0].Type) || GetColumnCount(args[0].Type) != GetRowCount(args[0].Type))
+			return false;
+
+		Value ret;
+		ret.Type = args[0].Type;
+		m_invert(args[0].Float, GetRowCount(args[0].Type), ret.Float); // singular matrices are undefined anyway
+
+		out = ret;
+		return true;
+	}
+
+	static const struct {
+		Builtin ID;
+		NativeFunction Function;
+	} m_functions[] = {
+		{ Builtin_Round, m_componentWise<FunctionOperation<Builtin_Round>, 1, true> },
+		{ Builtin_RoundEven, m_componentWise<FunctionOperation<Builtin_RoundEven>, 1, true> },
+		{ Builtin_Trunc, m_componentWise<FunctionOperation<Builtin_Trunc>, 1, true> },
+		{ Builtin_Abs, m_componentWise<FunctionOperation<Builtin_Abs>, 1, false> },
+		{ Builtin_Sign, m_componentWise<FunctionOperation<Builtin_Sign>, 1, false> },
+		{ Builtin_Floor, m_componentWise<FunctionOperation<Builtin_Floor>, 1, true> },
+		{ Builtin_Ceil, m_componentWise<FunctionOperation<Builtin_Ceil>, 1, true> },
+		{ Builtin_Fract, m_componentWise<FunctionOperation<Builtin_Fract>, 1, true> },
+		{ Builtin_Radians, m_componentWise<FunctionOperation<Builtin_Radians>, 1, true> },
+		{ Builtin_Degrees, m_componentWise<FunctionOperation<Builtin_Degrees>, 1, true> },
+		{ Builtin_Sin, m_componentWise<FunctionOperation<Builtin_Sin>, 1, true> },
+		{ Builtin_Cos, m_componentWise<FunctionOperation<Builtin_Cos>, 1, true> },
+		{ Builtin_Tan, m_componentWise<FunctionOperation<Builtin_Tan>, 1, true> },
+		{ Builtin_Asin, m_componentWise<FunctionOperation<Builtin_Asin>, 1, true> },
+		{ Builtin_Acos, m_componentWise<FunctionOperation<Builtin_Acos>, 1, true> },
+		{ Builtin_Atan, m_atan },
+		{ Builtin_Sinh, m_componentWise<FunctionOperation<Builtin_Sinh>, 1, true> },
+		{ Builtin_Cosh, m_componentWise<FunctionOperation<Builtin_Cosh>, 1, true> },
+		{ Builtin_Tanh, m_componentWise<FunctionOperation<Builtin_Tanh>, 1, true> },
+		{ Builtin_Asinh, m_componentWise<FunctionOperation<Builtin_Asinh>, 1, true> },
+		{ Builtin_Acosh, m_componentWise<FunctionOperation<Builtin_Acosh>, 1, true> },
+		{ Builtin_Atanh, m_componentWise<FunctionOperation<Builtin_Atanh>, 1, true> },
+		{ Builtin_Pow, m_componentWise<FunctionOperation<Builtin_Pow>, 2, true> },
+		{ Builtin_Exp, m_componentWise<FunctionOperation<Builtin_Exp>, 1, true> },
+		{ Builtin_Exp2, m_componentWise<FunctionOperation<Builtin_Exp2>, 1, true> },
+		{ Builtin_Log, m_componentWise<FunctionOperation<Builtin_Log>, 1, true> },
+		{ Builtin_Log2, m_componentWise<FunctionOperation<Builtin_Log2>, 1, true> },
+		{ Builtin_Sqrt, m_componentWise<FunctionOperation<Builtin_Sqrt>, 1, true> },
+		{ Builtin_InverseSqrt, m_componentWise<FunctionOperation<Builtin_InverseSqrt>, 1, true> },
+		{ Builtin_Determinant, m_determinant },
+		{ Builtin_Inverse, m_inverse },
+		{ Builtin_Min, m_componentWise<FunctionOperation<Builtin_Min>, 2, false> },
+		{ Builtin_Max, m_componentWise<FunctionOperation<Builtin_Max>, 2, false> },
+		{ Builtin_Clamp, m_componentWise<FunctionOperation<Builtin_Clamp>, 3, false> },
+		{ Builtin_Mix, m_componentWise<FunctionOperation<Builtin_Mix>, 3, true> },
+		{ Builtin_Step, m_componentWise<FunctionOperation<Builtin_Step>, 2, true> },
+		{ Builtin_SmoothStep, m_componentWise<FunctionOperation<Builtin_SmoothStep>, 3, true> },
+		{ Builtin_Fma, m_componentWise<FunctionOperation<Builtin_Fma>, 3, true> },
+		{ Builtin_Cross, m_cross },
+		{ Builtin_Dot, m_dot },
+		{ Builtin_Length, m_length },
+		{ Builtin_Distance, m_distance },
+		{ Builtin_Normalize, m_normalize },
+		{ Builtin_Any, m_any },
+		{ Builtin_All, m_all },
+	};
+
+	// replacements used in MathMode::Fast
+	static const struct {
+		Builtin ID;
+		NativeFunction Function;
+	} m_fastFunctions[] = {
+		{ Builtin_Sin, m_componentWise<Float1<FastSin>, 1, true> },
+		{ Builtin_Cos, m_componentWise<Float1<FastCos>, 1, true> },
+		{ Builtin_Atan, m_fastAtan },
+		{ Builtin_Pow, m_componentWise<Float2<FastPow>, 2, true> },
+		{ Builtin_Exp, m_componentWise<Float1<FastExp>, 1, true> },
+		{ Builtin_Exp2, m_componentWise<Float1<FastExp2>, 1, true> },
+		{ Builtin_Log, m_componentWise<Float1<FastLog>, 1, true> },
+		{ Builtin_Log2, m_componentWise<Float1<FastLog2>, 1, true> },
+		{ Builtin_InverseSqrt, m_componentWise<Float1<FastInverseSqrt>, 1, true> },
+	};
+
+	NativeFunction GetNativeFunction(Builtin id, MathMode mode)
+	{
+		// indexed by the builtin ID
+		static const struct m_FunctionIndex {
+			NativeFunction ByID[BuiltinCount];
+			NativeFunction FastByID[BuiltinCount];
+			m_FunctionIndex() : ByID(), FastByID() {
+				for (const auto& func : m_functions)
+					ByID[func.ID] = FastByID[func.ID] = func.Function;
+				for (const auto& func : m_fastFunctions)
+					FastByID[func.ID] = func.Function;
+			}
+		} index;
+
+		if (id < 0 || id >= BuiltinCount)
+			return nullptr;
+		return mode == MathMode::Fast ? index.FastByID[id] : index.ByID[id];
+	}
+
+	template<void(*Func)(const float*, float*, int)>
+	static void m_arrayFloat1(const float* const* args, float* out, int count) { Func(args[0], out, count); }
+	template<void(*Func)(const float*, const float*, float*, int)>
+	static void m_arrayFloat2(const float* const* args, float* out, int count) { Func(args[0], args[1], out, count); }
+
+	ArrayFunction GetArrayFunction(Builtin id, int argCount, MathMode mode)
+	{
+		if (mode != MathMode::Fast)
+			return nullptr;
+
+		if (argCount == 1) {
+			switch (id) {
+			case Builtin_Sin: return m_arrayFloat1<FastSin>;
+			case Builtin_Cos: return m_arrayFloat1<FastCos>;
+			case Builtin_Exp: return m_arrayFloat1<FastExp>;
+			case Builtin_Exp2: return m_arrayFloat1<FastExp2>;
+			case Builtin_Log: return m_arrayFloat1<FastLog>;
+			case Builtin_Log2: return m_arrayFloat1<FastLog2>;
+			case Builtin_InverseSqrt: return m_arrayFloat1<FastInverseSqrt>;
+			default: break;
+			}
+		} else if (argCount == 2) {
+			switch (id) {
+			case Builtin_Pow: return m_arrayFloat2<FastPow>;
+			case Builtin_Atan: return m_arrayFloat2<FastAtan2>;
+			default: break;
+			}
+		}
+		return nullptr;
+	}
+	bool ResolveFunctionType(NativeFunction func, const ValueType* argTypes, int argCount, ValueType& out)
+	{
+		Value args[16], ret;
+		if (argCount > 16)
+			return false;
+
+		for (int i = 0; i < argCount; i++)
+			args[i].Type = argTypes[i];
+
+		if (!func(args, argCount, ret))
+			return false;
+
+		out = ret.Type;
+		return true;
+	}
+}
\ No newline at end of file
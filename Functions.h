@@ -0,0 +1,27 @@
+#pragma once
+#include "Value.h"
+#include "Builtins.h"
+
+namespace expr
+{
+	enum class MathMode
+	{
+		Precise,	// only rewrites that keep results identical (up to the sign of zero), libm for builtins
+		Fast		// allows rewrites that change rounding, NaN or infinity behavior, see FastMath.h for builtins
+	};
+
+	// native implementation of a builtin function
+	typedef bool (*NativeFunction)(const Value* args, int argCount, Value& out);
+
+	// returns nullptr for unknown functions and for functions that can't be evaluated on the CPU (ddx, texture, ...)
+	NativeFunction GetNativeFunction(Builtin id, MathMode mode = MathMode::Precise);
+
+	// the result type only depends on the argument types, so it can be resolved ahead of time
+	bool ResolveFunctionType(NativeFunction func, const ValueType* argTypes, int argCount, ValueType& out);
+
+	// evaluates a builtin for many scalar float arguments at once, args[i] points to count values of argument i
+	typedef void (*ArrayFunction)(const float* const* args, float* out, int count);
+
+	// only builtins with a vectorized kernel have one (the MathMode::Fast transcendentals), returns nullptr otherwise
+	ArrayFunction GetArrayFunction(Builtin id, int argCount, MathMode mode);
+}
\ No newline at end of file
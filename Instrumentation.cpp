@@ -0,0 +1,137 @@
+#include "Instrumentation.h"
+
+#include <stdio.h>
+#include <mutex>
+#include <vector>
+
+namespace expr
+{
+	struct m_TraceEvent
+	{
+		Phase Type;
+		int Thread;
+		double Start, Duration; // microseconds since the instrumentation was enabled
+	};
+
+	// events are dropped past this so that a forgotten trace doesn't eat all of the memory
+	static const size_t m_maxEvents = 1 << 20;
+
+	static std::atomic<unsigned long long> m_time[(int)Phase::Count];
+	static std::atomic<size_t> m_calls[(int)Phase::Count];
+	static std::atomic<size_t> m_counters[(int)Counter::Count];
+
+	static std::mutex m_eventMutex;
+	static std::vector<m_TraceEvent> m_events;
+	static std::chrono::steady_clock::time_point m_epoch = std::chrono::steady_clock::now();
+	static std::atomic<int> m_nextThread(0);
+
+	static const char* m_phaseNames[] = { "lex", "parse", "validate", "analyze", "codegen", "assignIDs" };
+	static const char* m_counterNames[] = { "tokens", "nodes", "bytesAllocated", "cacheHits", "cacheMisses" };
+	static_assert(sizeof(m_phaseNames) / sizeof(m_phaseNames[0]) == (int)Phase::Count, "every phase needs a name");
+	static_assert(sizeof(m_counterNames) / sizeof(m_counterNames[0]) == (int)Counter::Count, "every counter needs a name");
+
+	static int m_getThread()
+	{
+		thread_local int thread = m_nextThread++;
+		return thread;
+	}
+
+	void EnableInstrumentation(bool enable)
+	{
+		if (enable && !m_isInstrumentationEnabled.load())
+			ResetInstrumentation();
+		m_isInstrumentationEnabled.store(enable);
+	}
+	void ResetInstrumentation()
+	{
+		for (int i = 0; i < (int)Phase::Count; i++) {
+			m_time[i] = 0;
+			m_calls[i] = 0;
+		}
+		for (int i = 0; i < (int)Counter::Count; i++)
+			m_counters[i] = 0;
+
+		std::lock_guard<std::mutex> lock(m_eventMutex);
+		m_events.clear();
+		m_epoch = std::chrono::steady_clock::now();
+	}
+	void GetInstrumentationStats(InstrumentationStats& out)
+	{
+		for (int i = 0; i < (int)Phase::Count; i++) {
+			out.Time[i] = m_time[i].load() / 1e6;
+			out.Calls[i] = m_calls[i].load();
+		}
+		for (int i = 0; i < (int)Counter::Count; i++)
+			out.Counters[i] = m_counters[i].load();
+	}
+	void RecordPhase(Phase phase, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end, bool isTraced)
+	{
+		m_time[(int)phase] += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+		m_calls[(int)phase]++;
+
+		if (!isTraced)
+			return;
+
+		std::lock_guard<std::mutex> lock(m_eventMutex);
+		if (m_events.size() >= m_maxEvents)
+			return;
+
+		m_TraceEvent event;
+		event.Type = phase;
+		event.Thread = m_getThread();
+		event.Start = std::chrono::duration<double, std::micro>(start - m_epoch).count();
+		event.Duration = std::chrono::duration<double, std::micro>(end - start).count();
+		m_events.push_back(event);
+	}
+	void RecordCount(Counter counter, size_t count)
+	{
+		m_counters[(int)counter] += count;
+	}
+
+	void GetChromeTrace(std::string& out)
+	{
+		char buffer[256];
+
+		out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+		std::lock_guard<std::mutex> lock(m_eventMutex);
+		double end = 0.0;
+		for (size_t i = 0; i < m_events.size(); i++) {
+			const m_TraceEvent& event = m_events[i];
+			snprintf(buffer, sizeof(buffer), "%s\n{\"name\":\"%s\",\"cat\":\"expr\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				i == 0 ? "" : ",", m_phaseNames[(int)event.Type], event.Thread, event.Start, event.Duration);
+			out += buffer;
+
+			if (event.Start + event.Duration > end)
+				end = event.Start + event.Duration;
+		}
+
+		// counters and the summed up phases (lex isn't traced) go at the end of the trace
+		InstrumentationStats stats;
+		GetInstrumentationStats(stats);
+		for (int i = 0; i < (int)Counter::Count; i++) {
+			snprintf(buffer, sizeof(buffer), "%s\n{\"name\":\"%s\",\"cat\":\"expr\",\"ph\":\"C\",\"pid\":0,\"ts\":%.3f,\"args\":{\"value\":%zu}}",
+				(i == 0 && m_events.empty()) ? "" : ",", m_counterNames[i], end, stats.Counters[i]);
+			out += buffer;
+		}
+		for (int i = 0; i < (int)Phase::Count; i++) {
+			snprintf(buffer, sizeof(buffer), ",\n{\"name\":\"%sTotal\",\"cat\":\"expr\",\"ph\":\"C\",\"pid\":0,\"ts\":%.3f,\"args\":{\"ms\":%.4f,\"calls\":%zu}}",
+				m_phaseNames[i], end, stats.Time[i], stats.Calls[i]);
+			out += buffer;
+		}
+
+		out += "\n]}";
+	}
+	bool WriteChromeTrace(const char* filename)
+	{
+		std::string trace;
+		GetChromeTrace(trace);
+
+		FILE* file = fopen(filename, "wb");
+		if (file == nullptr)
+			return false;
+		bool success = fwrite(trace.data(), 1, trace.size(), file) == trace.size();
+		fclose(file);
+		return success;
+	}
+}
\ No newline at end of file
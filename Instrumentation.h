@@ -0,0 +1,98 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <stddef.h>
+
+namespace expr
+{
+	enum class Phase
+	{
+		Lex,		// Tokenizer::Next(), runs inside Parse so it's only summed up, not traced
+		Parse,
+		Validate,
+		Analyze,	// optimizer passes
+		Codegen,
+		AssignIDs,
+
+		Count
+	};
+
+	enum class Counter
+	{
+		Tokens,
+		Nodes,
+		BytesAllocated,
+		CacheHits,
+		CacheMisses,
+
+		Count
+	};
+
+	struct InstrumentationStats
+	{
+		double Time[(int)Phase::Count];	// milliseconds
+		size_t Calls[(int)Phase::Count];
+		size_t Counters[(int)Counter::Count];
+
+		inline double GetCacheHitRate() const
+		{
+			size_t total = Counters[(int)Counter::CacheHits] + Counters[(int)Counter::CacheMisses];
+			return total == 0 ? 0.0 : Counters[(int)Counter::CacheHits] / (double)total;
+		}
+	};
+
+	// opt-in instrumentation of the parser and the compilers - while it is disabled every hook
+	// is a single relaxed load, and building with EXPR_DISABLE_INSTRUMENTATION removes them
+	void EnableInstrumentation(bool enable);
+	void ResetInstrumentation();
+	void GetInstrumentationStats(InstrumentationStats& out);
+
+	// trace event JSON that chrome://tracing and Perfetto can load
+	void GetChromeTrace(std::string& out);
+	bool WriteChromeTrace(const char* filename);
+
+	inline std::atomic<bool> m_isInstrumentationEnabled(false);
+
+	inline bool IsInstrumentationEnabled()
+	{
+#ifdef EXPR_DISABLE_INSTRUMENTATION
+		return false;
+#else
+		return m_isInstrumentationEnabled.load(std::memory_order_relaxed);
+#endif
+	}
+
+	void RecordPhase(Phase phase, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end, bool isTraced);
+	void RecordCount(Counter counter, size_t count);
+
+	inline void CountEvent(Counter counter, size_t count = 1)
+	{
+		if (IsInstrumentationEnabled())
+			RecordCount(counter, count);
+	}
+
+	// measures the scope it lives in
+	class PhaseTimer
+	{
+	public:
+		inline PhaseTimer(Phase phase, bool isTraced = true)
+		{
+			m_phase = phase;
+			m_isTraced = isTraced;
+			m_isActive = IsInstrumentationEnabled();
+			if (m_isActive)
+				m_start = std::chrono::steady_clock::now();
+		}
+		inline ~PhaseTimer()
+		{
+			if (m_isActive)
+				RecordPhase(m_phase, m_start, std::chrono::steady_clock::now(), m_isTraced);
+		}
+
+	private:
+		Phase m_phase;
+		bool m_isActive, m_isTraced;
+		std::chrono::steady_clock::time_point m_start;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,190 @@
+#include "Interpreter.h"
+#include "Functions.h"
+#include "Analysis.h"
+
+namespace expr
+{
+	Interpreter::Interpreter(Node* root)
+	{
+		m_root = root;
+		GetSharedNodes(root, m_shared);
+	}
+	void Interpreter::SetVariable(const std::string& name, const Value& val)
+	{
+		m_vars[name] = val;
+
+		auto type = m_varTypes.find(name);
+		if (type == m_varTypes.end() || type->second != val.Type) {
+			m_varTypes[name] = val.Type;
+			m_types.clear();
+		}
+	}
+	bool Interpreter::Evaluate(Value& out)
+	{
+		m_hasError = false;
+		m_error = "";
+
+		if (m_root == nullptr)
+			return m_fail("empty expression");
+
+		m_cache.clear();
+		return m_visit(m_root, out);
+	}
+	bool Interpreter::m_fail(const char* msg)
+	{
+		if (!m_hasError)
+			m_error = msg;
+		m_hasError = true;
+		return false;
+	}
+	bool Interpreter::m_visit(Node* node, Value& out)
+	{
+		if (m_shared.empty() || m_shared.count(node) == 0)
+			return m_evaluate(node, out);
+
+		auto cached = m_cache.find(node);
+		if (cached != m_cache.end()) {
+			out = cached->second;
+			return true;
+		}
+
+		if (!m_evaluate(node, out))
+			return false;
+		m_cache[node] = out;
+		return true;
+	}
+	bool Interpreter::m_evaluate(Node* node, Value& out)
+	{
+		switch (node->GetNodeType()) {
+		case NodeType::FloatLiteral:
+			out = MakeFloat(((FloatLiteralNode*)node)->Value);
+			return true;
+		case NodeType::IntegerLiteral:
+			out = MakeInt(((IntegerLiteralNode*)node)->Value);
+			return true;
+		case NodeType::BooleanLiteral:
+			out = MakeBool(((BooleanLiteralNode*)node)->Value);
+			return true;
+		case NodeType::Identifier: {
+			auto it = m_vars.find(((IdentifierNode*)node)->Name);
+			if (it == m_vars.end())
+				return m_fail("unknown variable");
+			out = it->second;
+			return true;
+		} break;
+		case NodeType::BinaryExpression: {
+			BinaryExpressionNode* bexpr = (BinaryExpressionNode*)node;
+			Value left, right;
+			if (!m_visit(bexpr->Left, left))
+				return false;
+
+			// a scalar left side can decide && and || on its own, the right side then only
+			// contributes its type (false && bvec2(...) is still a bvec2)
+			bool isLogic = bexpr->Operator == TokenType_LogicAnd || bexpr->Operator == TokenType_LogicOr;
+			Value cond;
+			if (isLogic && IsScalar(left.Type) && ConvertValue(left, ValueType::Bool, cond) &&
+				cond.Bool[0] != (bexpr->Operator == TokenType_LogicAnd)) {
+				if (!ResolveType(bexpr->Right, m_varTypes, m_types, right.Type))
+					return m_fail("invalid operands to binary expression");
+			} else if (!m_visit(bexpr->Right, right))
+				return false;
+
+			if (!ApplyBinary(bexpr->Operator, left, right, out))
+				return m_fail("invalid operands to binary expression");
+			return true;
+		} break;
+		case NodeType::TernaryExpression: {
+			TernaryExpressionNode* texpr = (TernaryExpressionNode*)node;
+			Value cond, onTrue, onFalse;
+			if (!m_visit(texpr->Condition, cond))
+				return false;
+
+			if (IsScalar(cond.Type) && GetBaseType(cond.Type) == ValueType::Bool) {
+				// only evaluate the branch that was taken, the other one still takes part in
+				// picking the result type (c ? 1 : 2.0 is a float either way)
+				Value& taken = cond.Bool[0] ? onTrue : onFalse;
+				Value& skipped = cond.Bool[0] ? onFalse : onTrue;
+				if (!m_visit(cond.Bool[0] ? texpr->OnTrue : texpr->OnFalse, taken))
+					return false;
+				if (!ResolveType(cond.Bool[0] ? texpr->OnFalse : texpr->OnTrue, m_varTypes, m_types, skipped.Type))
+					return m_fail("invalid ternary expression");
+			} else if (!m_visit(texpr->OnTrue, onTrue) || !m_visit(texpr->OnFalse, onFalse))
+				return false;
+
+			if (!ApplySelect(cond, onTrue, onFalse, out))
+				return m_fail("invalid ternary expression");
+			return true;
+		} break;
+		case NodeType::UnaryExpression: {
+			UnaryExpressionNode* uexpr = (UnaryExpressionNode*)node;
+			Value child;
+			if (!m_visit(uexpr->Child, child))
+				return false;
+			if (!ApplyUnary(uexpr->Operator, uexpr->IsPost, child, out))
+				return m_fail("invalid operand to unary expression");
+			return true;
+		} break;
+		case NodeType::Cast: {
+			CastNode* cast = (CastNode*)node;
+			Value child;
+			ValueType type;
+			if (!m_visit(cast->Object, child))
+				return false;
+			if (!GetTokenValueType(cast->Type, type) || !ApplyCast(type, child, out))
+				return m_fail("invalid cast");
+			return true;
+		} break;
+		case NodeType::FunctionCall: {
+			FunctionCallNode* fcall = (FunctionCallNode*)node;
+			Value args[16];
+			int argCount = (int)fcall->Arguments.size();
+			if (argCount > 16)
+				return m_fail("too many arguments");
+
+			for (int i = 0; i < argCount; i++)
+				if (!m_visit(fcall->Arguments[i], args[i]))
+					return false;
+
+			ValueType type;
+			if (GetTokenValueType(fcall->TokenType, type)) {
+				if (!ConstructValue(type, args, argCount, out))
+					return m_fail("invalid constructor");
+				return true;
+			}
+
+			NativeFunction func = GetNativeFunction((Builtin)fcall->BuiltinID, m_mathMode);
+			if (func == nullptr)
+				return m_fail(FindBuiltin(fcall->Name) ? "wrong number of arguments passed to a builtin function" : "function can't be evaluated natively");
+			if (!func(args, argCount, out))
+				return m_fail("invalid arguments");
+			return true;
+		} break;
+		case NodeType::MemberAccess: {
+			MemberAccessNode* maccess = (MemberAccessNode*)node;
+			Value obj;
+			if (!m_visit(maccess->Object, obj))
+				return false;
+			if (!ApplySwizzle(obj, maccess->Swizzle, maccess->SwizzleCount, out))
+				return m_fail("invalid swizzle");
+			return true;
+		} break;
+		case NodeType::ArrayAccess: {
+			ArrayAccessNode* aaccess = (ArrayAccessNode*)node;
+			Value obj, index;
+			if (!m_visit(aaccess->Object, obj))
+				return false;
+			for (Node* indexNode : aaccess->Indices) {
+				if (!m_visit(indexNode, index))
+					return false;
+				if (!ApplyIndex(obj, index, obj))
+					return m_fail("invalid index");
+			}
+			out = obj;
+			return true;
+		} break;
+		default: break;
+		}
+
+		return m_fail("unsupported expression");
+	}
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+#include "Evaluator.h"
+
+#include <unordered_map>
+#include <unordered_set>
+
+namespace expr
+{
+	// evaluates the AST by walking it on every Evaluate() call - ternaries with a scalar
+	// condition and && / || only evaluate the operand that decides the result
+	class Interpreter : public Evaluator
+	{
+	public:
+		Interpreter(Node* root);
+
+		virtual void SetVariable(const std::string& name, const Value& val);
+		virtual bool Evaluate(Value& out);
+
+	private:
+		bool m_visit(Node* node, Value& out);
+		bool m_evaluate(Node* node, Value& out);
+		bool m_fail(const char* msg);
+
+		Node* m_root;
+		std::unordered_map<std::string, Value> m_vars;
+
+		// types of the skipped operands, so that they still contribute to the result type
+		std::unordered_map<std::string, ValueType> m_varTypes;
+		std::unordered_map<Node*, ValueType> m_types;
+
+		// values of the shared nodes computed during the current Evaluate() call
+		std::unordered_set<Node*> m_shared;
+		std::unordered_map<Node*, Value> m_cache;
+	};
+}
\ No newline at end of file
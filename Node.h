@@ -1,5 +1,6 @@
 #pragma once
 #include <vector>
+#include <stddef.h>
 
 namespace expr
 {
@@ -48,6 +49,9 @@ namespace expr
 	{
 	public:
 		inline virtual NodeType GetNodeType() { return NodeType::None; }
+
+		// [SourceStart, SourceEnd) byte range in the parsed text, empty for nodes created by the Optimizer
+		size_t SourceStart = 0, SourceEnd = 0;
 	};
 	class FloatLiteralNode : public Node
 	{
@@ -102,6 +106,7 @@ namespace expr
 		char Name[256];
 		std::vector<Node*> Arguments;
 		int TokenType;
+		int BuiltinID; // Builtin_None for constructors, user functions and builtin names with a wrong argument count, see Builtins.h
 	};
 	class ArrayAccessNode : public Node
 	{
@@ -118,6 +123,8 @@ namespace expr
 
 		Node* Object;
 		char Field[256];
+		int Swizzle[4];
+		int SwizzleCount; // resolved by the parser, 0 if Field isn't a valid swizzle
 	};
 	class MethodCallNode : public FunctionCallNode
 	{
@@ -0,0 +1,271 @@
+#pragma once
+#include "Tokenizer.h"
+#include "Builtins.h"
+#include "Arithmetic.h"
+#include <math.h>
+#include <type_traits>
+
+namespace expr
+{
+	// component-wise kernels shared by the interpreter and the closure compiler
+	template<int Op> struct BinaryOperation;
+
+	template<> struct BinaryOperation<'+'> {
+		template<typename T> using Result = T;
+		template<typename T> static inline T Apply(T a, T b) { return a + b; }
+	};
+	template<> struct BinaryOperation<'-'> {
+		template<typename T> using Result = T;
+		template<typename T> static inline T Apply(T a, T b) { return a - b; }
+	};
+	template<> struct BinaryOperation<'*'> {
+		template<typename T> using Result = T;
+		template<typename T> static inline T Apply(T a, T b)
+		{
+			if constexpr (std::is_same<T, bool>::value) return a && b;
+			else return a * b;
+		}
+	};
+	template<> struct BinaryOperation<'/'> {
+		template<typename T> using Result = T;
+		template<typename T> static inline T Apply(T a, T b) { return ScalarDivide(a, b); }
+	};
+	template<> struct BinaryOperation<'%'> {
+		template<typename T> using Result = T;
+		template<typename T> static inline T Apply(T a, T b) { return ScalarModulo(a, b); }
+	};
+	template<> struct BinaryOperation<'&'> {
+		template<typename T> using Result = T;
+		template<typename T> static inline T Apply(T a, T b)
+		{
+			if constexpr (std::is_integral<T>::value) return a & b;
+			else return T(0);
+		}
+	};
+	template<> struct BinaryOperation<'|'> {
+		template<typename T> using Result = T;
+		template<typename T> static inline T Apply(T a, T b)
+		{
+			if constexpr (std::is_integral<T>::value) return a | b;
+			else return T(0);
+		}
+	};
+	template<> struct BinaryOperation<'^'> {
+		template<typename T> using Result = T;
+		template<typename T> static inline T Apply(T a, T b)
+		{
+			if constexpr (std::is_integral<T>::value) return a ^ b;
+			else return T(0);
+		}
+	};
+	template<> struct BinaryOperation<TokenType_BitshiftLeft> {
+		template<typename T> using Result = T;
+		template<typename T> static inline T Apply(T a, T b) { return ScalarShiftLeft(a, b); }
+	};
+	template<> struct BinaryOperation<TokenType_BitshiftRight> {
+		template<typename T> using Result = T;
+		template<typename T> static inline T Apply(T a, T b) { return ScalarShiftRight(a, b); }
+	};
+	template<> struct BinaryOperation<TokenType_LogicAnd> {
+		template<typename T> using Result = bool;
+		template<typename T> static inline bool Apply(T a, T b) { return a && b; }
+	};
+	template<> struct BinaryOperation<TokenType_LogicOr> {
+		template<typename T> using Result = bool;
+		template<typename T> static inline bool Apply(T a, T b) { return a || b; }
+	};
+	template<> struct BinaryOperation<'<'> {
+		template<typename T> using Result = bool;
+		template<typename T> static inline bool Apply(T a, T b) { return a < b; }
+	};
+	template<> struct BinaryOperation<'>'> {
+		template<typename T> using Result = bool;
+		template<typename T> static inline bool Apply(T a, T b) { return a > b; }
+	};
+	template<> struct BinaryOperation<TokenType_LessThanEqual> {
+		template<typename T> using Result = bool;
+		template<typename T> static inline bool Apply(T a, T b) { return a <= b; }
+	};
+	template<> struct BinaryOperation<TokenType_GreaterThanEqual> {
+		template<typename T> using Result = bool;
+		template<typename T> static inline bool Apply(T a, T b) { return a >= b; }
+	};
+	template<> struct BinaryOperation<TokenType_Equal> {
+		template<typename T> using Result = bool;
+		template<typename T> static inline bool Apply(T a, T b) { return a == b; }
+	};
+	template<> struct BinaryOperation<TokenType_NotEqual> {
+		template<typename T> using Result = bool;
+		template<typename T> static inline bool Apply(T a, T b) { return a != b; }
+	};
+
+	// aStep/bStep are 0 for a broadcasted scalar and 1 otherwise
+	template<int Op, typename T>
+	inline void ApplyBinaryKernel(const T* a, int aStep, const T* b, int bStep, typename BinaryOperation<Op>::template Result<T>* out, int count)
+	{
+		for (int i = 0; i < count; i++)
+			out[i] = BinaryOperation<Op>::Apply(a[i * aStep], b[i * bStep]);
+	}
+
+	template<int Op> struct UnaryOperation;
+
+	template<> struct UnaryOperation<'+'> {
+		template<typename T> static inline T Apply(T a) { return a; }
+	};
+	template<> struct UnaryOperation<'-'> {
+		template<typename T> static inline T Apply(T a)
+		{
+			if constexpr (std::is_same<T, bool>::value) return a;
+			else return -a;
+		}
+	};
+	template<> struct UnaryOperation<'!'> {
+		template<typename T> static inline T Apply(T a) { return !a; }
+	};
+	template<> struct UnaryOperation<'~'> {
+		template<typename T> static inline T Apply(T a)
+		{
+			if constexpr (std::is_integral<T>::value && !std::is_same<T, bool>::value) return ~a;
+			else return a;
+		}
+	};
+	template<> struct UnaryOperation<TokenType_Increment> {
+		template<typename T> static inline T Apply(T a) { return a + T(1); }
+	};
+	template<> struct UnaryOperation<TokenType_Decrement> {
+		template<typename T> static inline T Apply(T a) { return a - T(1); }
+	};
+
+	template<int Op, typename T>
+	inline void ApplyUnaryKernel(const T* a, T* out, int count)
+	{
+		for (int i = 0; i < count; i++)
+			out[i] = UnaryOperation<Op>::Apply(a[i]);
+	}
+
+	template<typename From, typename To>
+	inline void ConvertKernel(const From* a, To* out, int count)
+	{
+		for (int i = 0; i < count; i++) {
+			if constexpr (std::is_same<To, bool>::value)
+				out[i] = a[i] != From(0);
+			else
+				out[i] = (To)a[i];
+		}
+	}
+
+	// scalar kernels of the component-wise builtin functions, shared by Functions.cpp and
+	// StaticExpression.h - Float builtins take floats, the Numeric ones any T
+	template<float(*Func)(float)> struct Float1 {
+		static inline float Apply(float x) { return Func(x); }
+	};
+	template<float(*Func)(float, float)> struct Float2 {
+		static inline float Apply(float x, float y) { return Func(x, y); }
+	};
+	template<float(*Func)(float, float, float)> struct Float3 {
+		static inline float Apply(float x, float y, float z) { return Func(x, y, z); }
+	};
+
+	template<Builtin Func> struct FunctionOperation;
+
+	template<> struct FunctionOperation<Builtin_Abs> {
+		template<typename T> static inline T Apply(T x)
+		{
+			if constexpr (std::is_unsigned<T>::value) return x;
+			else return x < T(0) ? -x : x;
+		}
+	};
+	template<> struct FunctionOperation<Builtin_Sign> {
+		template<typename T> static inline T Apply(T x) { return (x > T(0)) ? T(1) : ((x < T(0)) ? T(-1) : T(0)); }
+	};
+	template<> struct FunctionOperation<Builtin_Min> {
+		template<typename T> static inline T Apply(T x, T y) { return y < x ? y : x; }
+	};
+	template<> struct FunctionOperation<Builtin_Max> {
+		template<typename T> static inline T Apply(T x, T y) { return y > x ? y : x; }
+	};
+	template<> struct FunctionOperation<Builtin_Clamp> {
+		template<typename T> static inline T Apply(T x, T lo, T hi)
+		{
+			return FunctionOperation<Builtin_Min>::Apply(FunctionOperation<Builtin_Max>::Apply(x, lo), hi);
+		}
+	};
+	template<> struct FunctionOperation<Builtin_Round> : Float1<roundf> {};
+	template<> struct FunctionOperation<Builtin_RoundEven> : Float1<nearbyintf> {};
+	template<> struct FunctionOperation<Builtin_Trunc> : Float1<truncf> {};
+	template<> struct FunctionOperation<Builtin_Floor> : Float1<floorf> {};
+	template<> struct FunctionOperation<Builtin_Ceil> : Float1<ceilf> {};
+	template<> struct FunctionOperation<Builtin_Fract> {
+		static inline float Apply(float x) { return x - floorf(x); }
+	};
+	template<> struct FunctionOperation<Builtin_Radians> {
+		static inline float Apply(float x) { return x * 0.01745329251994329577f; }
+	};
+	template<> struct FunctionOperation<Builtin_Degrees> {
+		static inline float Apply(float x) { return x * 57.2957795130823208768f; }
+	};
+	template<> struct FunctionOperation<Builtin_Sin> : Float1<sinf> {};
+	template<> struct FunctionOperation<Builtin_Cos> : Float1<cosf> {};
+	template<> struct FunctionOperation<Builtin_Tan> : Float1<tanf> {};
+	template<> struct FunctionOperation<Builtin_Asin> : Float1<asinf> {};
+	template<> struct FunctionOperation<Builtin_Acos> : Float1<acosf> {};
+	template<> struct FunctionOperation<Builtin_Atan> {
+		static inline float Apply(float x) { return atanf(x); }
+		static inline float Apply(float y, float x) { return atan2f(y, x); }
+	};
+	template<> struct FunctionOperation<Builtin_Sinh> : Float1<sinhf> {};
+	template<> struct FunctionOperation<Builtin_Cosh> : Float1<coshf> {};
+	template<> struct FunctionOperation<Builtin_Tanh> : Float1<tanhf> {};
+	template<> struct FunctionOperation<Builtin_Asinh> : Float1<asinhf> {};
+	template<> struct FunctionOperation<Builtin_Acosh> : Float1<acoshf> {};
+	template<> struct FunctionOperation<Builtin_Atanh> : Float1<atanhf> {};
+	template<> struct FunctionOperation<Builtin_Pow> : Float2<powf> {};
+	template<> struct FunctionOperation<Builtin_Exp> : Float1<expf> {};
+	template<> struct FunctionOperation<Builtin_Exp2> : Float1<exp2f> {};
+	template<> struct FunctionOperation<Builtin_Log> : Float1<logf> {};
+	template<> struct FunctionOperation<Builtin_Log2> : Float1<log2f> {};
+	template<> struct FunctionOperation<Builtin_Sqrt> : Float1<sqrtf> {};
+	template<> struct FunctionOperation<Builtin_InverseSqrt> {
+		static inline float Apply(float x) { return 1.0f / sqrtf(x); }
+	};
+	template<> struct FunctionOperation<Builtin_Step> {
+		static inline float Apply(float edge, float x) { return x < edge ? 0.0f : 1.0f; }
+	};
+	template<> struct FunctionOperation<Builtin_Mix> {
+		static inline float Apply(float x, float y, float a) { return x * (1.0f - a) + y * a; }
+	};
+	template<> struct FunctionOperation<Builtin_SmoothStep> {
+		static inline float Apply(float e0, float e1, float x)
+		{
+			float t = (x - e0) / (e1 - e0);
+			t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+			return t * t * (3.0f - 2.0f * t);
+		}
+	};
+	template<> struct FunctionOperation<Builtin_Fma> : Float3<fmaf> {};
+
+	// column major matrix products: columns/rows describe the left operand
+	inline void MatrixTimesVector(const float* m, int columns, int rows, const float* v, float* out)
+	{
+		for (int r = 0; r < rows; r++) {
+			float sum = 0.0f;
+			for (int c = 0; c < columns; c++)
+				sum += m[c * rows + r] * v[c];
+			out[r] = sum;
+		}
+	}
+	inline void VectorTimesMatrix(const float* v, const float* m, int columns, int rows, float* out)
+	{
+		for (int c = 0; c < columns; c++) {
+			float sum = 0.0f;
+			for (int r = 0; r < rows; r++)
+				sum += v[r] * m[c * rows + r];
+			out[c] = sum;
+		}
+	}
+	inline void MatrixTimesMatrix(const float* a, int aColumns, int aRows, const float* b, int bColumns, float* out)
+	{
+		for (int c = 0; c < bColumns; c++)
+			MatrixTimesVector(a, aColumns, aRows, b + c * aColumns, out + c * aRows);
+	}
+}
\ No newline at end of file
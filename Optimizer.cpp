@@ -0,0 +1,726 @@
+#include "Optimizer.h"
+#include "Functions.h"
+#include "Analysis.h"
+#include "Instrumentation.h"
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+namespace expr
+{
+	Optimizer::Optimizer(Parser& parser) :
+		m_list(parser.GetList())
+	{
+	}
+
+	Node* Optimizer::Fold(Node* root)
+	{
+		PhaseTimer timer(Phase::Analyze);
+		if (root == nullptr)
+			return nullptr;
+		return m_fold(root);
+	}
+
+	bool Optimizer::GetConstant(Node* node, Value& out)
+	{
+		switch (node->GetNodeType()) {
+		case NodeType::FloatLiteral:
+			out = MakeFloat(((FloatLiteralNode*)node)->Value);
+			return true;
+		case NodeType::IntegerLiteral:
+			out = MakeInt(((IntegerLiteralNode*)node)->Value);
+			return true;
+		case NodeType::BooleanLiteral:
+			out = MakeBool(((BooleanLiteralNode*)node)->Value);
+			return true;
+		case NodeType::FunctionCall: {
+			FunctionCallNode* fcall = (FunctionCallNode*)node;
+			ValueType type;
+			Value args[16];
+			if (!GetTokenValueType(fcall->TokenType, type) || IsScalar(type) || fcall->Arguments.size() > 16)
+				return false;
+
+			for (int i = 0; i < fcall->Arguments.size(); i++)
+				if (!GetConstant(fcall->Arguments[i], args[i]))
+					return false;
+
+			return ConstructValue(type, args, (int)fcall->Arguments.size(), out);
+		} break;
+		default: break;
+		}
+		return false;
+	}
+	Node* Optimizer::CreateConstant(const Value& val)
+	{
+		ValueType base = GetBaseType(val.Type);
+
+		if (IsScalar(val.Type)) {
+			if (base == ValueType::Float) {
+				FloatLiteralNode* node = m_allocateNode<FloatLiteralNode>();
+				node->Value = val.Float[0];
+				return node;
+			} else if (base == ValueType::Int) {
+				IntegerLiteralNode* node = m_allocateNode<IntegerLiteralNode>();
+				node->Value = val.Int[0];
+				return node;
+			} else if (base == ValueType::Bool) {
+				BooleanLiteralNode* node = m_allocateNode<BooleanLiteralNode>();
+				node->Value = val.Bool[0];
+				return node;
+			}
+			return nullptr; // there are no uint literals
+		}
+
+		// vectors become constructors with one literal per component
+		if (!IsVector(val.Type) || base == ValueType::Uint)
+			return nullptr;
+
+		static const char* baseNames[] = { "float", "int", "uint", "bool" };
+		static const int baseTokens[] = { TokenType_Float, TokenType_Int, TokenType_Uint, TokenType_Bool };
+		int baseIndex = base == ValueType::Float ? 0 : (base == ValueType::Int ? 1 : 3);
+		int count = GetRowCount(val.Type);
+
+		FunctionCallNode* node = m_allocateNode<FunctionCallNode>();
+		snprintf(node->Name, sizeof(node->Name), "%s%d", baseNames[baseIndex], count);
+		node->TokenType = baseTokens[baseIndex] + count - 1;
+		node->BuiltinID = Builtin_None;
+
+		for (int i = 0; i < count; i++) {
+			Value comp;
+			comp.Type = base;
+			comp.Uint[0] = 0;
+			if (base == ValueType::Bool) comp.Bool[0] = val.Bool[i];
+			else comp.Uint[0] = val.Uint[i];
+			node->Arguments.push_back(CreateConstant(comp));
+		}
+
+		return node;
+	}
+	bool Optimizer::m_isCanonical(FunctionCallNode* fcall, ValueType type)
+	{
+		if (fcall->Arguments.size() != GetComponentCount(type))
+			return false;
+
+		NodeType literal = NodeType::BooleanLiteral;
+		if (GetBaseType(type) == ValueType::Float) literal = NodeType::FloatLiteral;
+		else if (GetBaseType(type) == ValueType::Int) literal = NodeType::IntegerLiteral;
+
+		for (Node* arg : fcall->Arguments)
+			if (arg->GetNodeType() != literal)
+				return false;
+		return true;
+	}
+	Node* Optimizer::m_replace(Node* node, const Value& val)
+	{
+		// keep the original node when the value can't be represented by literals
+		Node* ret = CreateConstant(val);
+		return ret ? m_keepRange(node, ret) : node;
+	}
+	Node* Optimizer::m_keepRange(Node* node, Node* replacement)
+	{
+		// new nodes point to the source of the node that they replaced
+		if (replacement->SourceEnd == 0) {
+			replacement->SourceStart = node->SourceStart;
+			replacement->SourceEnd = node->SourceEnd;
+		}
+		return replacement;
+	}
+	Node* Optimizer::m_fold(Node* node)
+	{
+		Value a, b, c, ret;
+
+		switch (node->GetNodeType()) {
+		case NodeType::BinaryExpression: {
+			BinaryExpressionNode* bexpr = (BinaryExpressionNode*)node;
+			bexpr->Left = m_fold(bexpr->Left);
+			bexpr->Right = m_fold(bexpr->Right);
+
+			bool isLeftConst = GetConstant(bexpr->Left, a);
+
+			// false && x, true || x - x is never evaluated but its shape decides the result type
+			// (false && bvec2(...) is a bvec2), so this only folds once the type of x is known
+			if (isLeftConst && a.Type == ValueType::Bool) {
+				if ((bexpr->Operator == TokenType_LogicAnd && !a.Bool[0]) || (bexpr->Operator == TokenType_LogicOr && a.Bool[0])) {
+					Value skipped;
+					if (GetType(bexpr->Right, skipped.Type) && ApplyBinary(bexpr->Operator, a, skipped, ret))
+						return m_replace(node, ret);
+					break;
+				}
+			}
+
+			if (isLeftConst && GetConstant(bexpr->Right, b) && ApplyBinary(bexpr->Operator, a, b, ret))
+				return m_replace(node, ret);
+		} break;
+		case NodeType::TernaryExpression: {
+			TernaryExpressionNode* texpr = (TernaryExpressionNode*)node;
+			texpr->Condition = m_fold(texpr->Condition);
+			texpr->OnTrue = m_fold(texpr->OnTrue);
+			texpr->OnFalse = m_fold(texpr->OnFalse);
+
+			// dead branch elimination - the branches can differ in type (c ? 1 : 2.0 is a float),
+			// so the taken branch only replaces the node when both types match
+			if (GetConstant(texpr->Condition, a) && a.Type == ValueType::Bool) {
+				Node* taken = a.Bool[0] ? texpr->OnTrue : texpr->OnFalse;
+				ValueType trueType, falseType;
+				if (GetType(texpr->OnTrue, trueType) && GetType(texpr->OnFalse, falseType) && trueType == falseType)
+					return taken;
+
+				Value skipped;
+				if (GetConstant(taken, b) && GetType(a.Bool[0] ? texpr->OnFalse : texpr->OnTrue, skipped.Type) &&
+					ApplySelect(a, a.Bool[0] ? b : skipped, a.Bool[0] ? skipped : b, ret))
+					return m_replace(node, ret);
+				break;
+			}
+
+			if (GetConstant(texpr->Condition, a) && GetConstant(texpr->OnTrue, b) && GetConstant(texpr->OnFalse, c) && ApplySelect(a, b, c, ret))
+				return m_replace(node, ret);
+		} break;
+		case NodeType::UnaryExpression: {
+			UnaryExpressionNode* uexpr = (UnaryExpressionNode*)node;
+			uexpr->Child = m_fold(uexpr->Child);
+
+			if (uexpr->Operator != TokenType_Increment && uexpr->Operator != TokenType_Decrement &&
+				GetConstant(uexpr->Child, a) && ApplyUnary(uexpr->Operator, uexpr->IsPost, a, ret))
+				return m_replace(node, ret);
+		} break;
+		case NodeType::Cast: {
+			CastNode* cast = (CastNode*)node;
+			ValueType type;
+			cast->Object = m_fold(cast->Object);
+
+			if (GetTokenValueType(cast->Type, type) && GetConstant(cast->Object, a) && ApplyCast(type, a, ret))
+				return m_replace(node, ret);
+		} break;
+		case NodeType::FunctionCall: {
+			FunctionCallNode* fcall = (FunctionCallNode*)node;
+			Value args[16];
+			bool isConst = fcall->Arguments.size() <= 16;
+
+			for (int i = 0; i < fcall->Arguments.size(); i++) {
+				fcall->Arguments[i] = m_fold(fcall->Arguments[i]);
+				isConst = isConst && GetConstant(fcall->Arguments[i], args[i]);
+			}
+
+			if (!isConst || fcall->Arguments.empty())
+				break;
+
+			ValueType type;
+			int argCount = (int)fcall->Arguments.size();
+			if (GetTokenValueType(fcall->TokenType, type)) {
+				// scalar constructors of vectors keep the vector shape in the SPIR-V compiler
+				if (IsScalar(type) && !IsScalar(args[0].Type))
+					break;
+				if (!IsScalar(type) && m_isCanonical(fcall, type))
+					break;
+				if (ConstructValue(type, args, argCount, ret))
+					return m_replace(node, ret);
+			} else {
+				NativeFunction func = GetNativeFunction((Builtin)fcall->BuiltinID);
+				if (func != nullptr && func(args, argCount, ret))
+					return m_replace(node, ret);
+			}
+		} break;
+		case NodeType::MethodCall: {
+			MethodCallNode* mcall = (MethodCallNode*)node;
+			mcall->Object = m_fold(mcall->Object);
+			for (int i = 0; i < mcall->Arguments.size(); i++)
+				mcall->Arguments[i] = m_fold(mcall->Arguments[i]);
+		} break;
+		case NodeType::MemberAccess: {
+			MemberAccessNode* maccess = (MemberAccessNode*)node;
+			maccess->Object = m_fold(maccess->Object);
+
+			if (GetConstant(maccess->Object, a) && ApplySwizzle(a, maccess->Swizzle, maccess->SwizzleCount, ret))
+				return m_replace(node, ret);
+		} break;
+		case NodeType::ArrayAccess: {
+			ArrayAccessNode* aaccess = (ArrayAccessNode*)node;
+			bool isConst = true;
+
+			aaccess->Object = m_fold(aaccess->Object);
+			isConst = GetConstant(aaccess->Object, a);
+			for (int i = 0; i < aaccess->Indices.size(); i++) {
+				aaccess->Indices[i] = m_fold(aaccess->Indices[i]);
+				isConst = isConst && GetConstant(aaccess->Indices[i], b) && ApplyIndex(a, b, a);
+			}
+
+			if (isConst)
+				return m_replace(node, a);
+		} break;
+		default: break;
+		}
+
+		return node;
+	}
+
+	void Optimizer::SetVariableType(const std::string& name, ValueType type)
+	{
+		m_varTypes[name] = type;
+		m_types.clear();
+	}
+	bool Optimizer::GetType(Node* node, ValueType& out)
+	{
+		auto it = m_types.find(node);
+		if (it != m_types.end()) {
+			out = it->second;
+			return true;
+		}
+
+		if (!m_getType(node, out))
+			return false;
+
+		m_types[node] = out;
+		return true;
+	}
+	bool Optimizer::m_getType(Node* node, ValueType& out)
+	{
+		ValueType a, b, c;
+
+		switch (node->GetNodeType()) {
+		case NodeType::FloatLiteral: out = ValueType::Float; return true;
+		case NodeType::IntegerLiteral: out = ValueType::Int; return true;
+		case NodeType::BooleanLiteral: out = ValueType::Bool; return true;
+		case NodeType::Identifier: {
+			auto it = m_varTypes.find(((IdentifierNode*)node)->Name);
+			if (it == m_varTypes.end())
+				return false;
+			out = it->second;
+			return true;
+		} break;
+		case NodeType::BinaryExpression: {
+			BinaryExpressionNode* bexpr = (BinaryExpressionNode*)node;
+			return GetType(bexpr->Left, a) && GetType(bexpr->Right, b) && ResolveBinaryType(bexpr->Operator, a, b, c, out);
+		} break;
+		case NodeType::UnaryExpression: {
+			UnaryExpressionNode* uexpr = (UnaryExpressionNode*)node;
+			return GetType(uexpr->Child, a) && ResolveUnaryType(uexpr->Operator, a, out);
+		} break;
+		case NodeType::TernaryExpression: {
+			TernaryExpressionNode* texpr = (TernaryExpressionNode*)node;
+			if (!GetType(texpr->OnTrue, a) || !GetType(texpr->OnFalse, b))
+				return false;
+			if (a == b) {
+				out = a;
+				return true;
+			}
+			if (IsScalar(a) != IsScalar(b) || !ResolveBinaryType('+', a, b, c, out))
+				return false;
+			out = GetSameShape(a, c);
+			return true;
+		} break;
+		case NodeType::Cast: {
+			CastNode* cast = (CastNode*)node;
+			if (!GetTokenValueType(cast->Type, c) || !GetType(cast->Object, a))
+				return false;
+			if (!IsScalar(c)) {
+				out = c;
+				return true;
+			}
+			if (IsMatrix(a) && c != ValueType::Float)
+				return false;
+			out = GetSameShape(a, c);
+			return true;
+		} break;
+		case NodeType::FunctionCall: {
+			FunctionCallNode* fcall = (FunctionCallNode*)node;
+			ValueType args[16];
+			if (fcall->Arguments.size() > 16)
+				return false;
+			for (int i = 0; i < fcall->Arguments.size(); i++)
+				if (!GetType(fcall->Arguments[i], args[i]))
+					return false;
+
+			if (GetTokenValueType(fcall->TokenType, c)) {
+				if (IsScalar(c) && !fcall->Arguments.empty() && !IsMatrix(args[0])) {
+					out = GetSameShape(args[0], c); // see the SPIR-V compiler
+					return true;
+				}
+				out = c;
+				return true;
+			}
+
+			NativeFunction func = GetNativeFunction((Builtin)fcall->BuiltinID);
+			return func != nullptr && ResolveFunctionType(func, args, (int)fcall->Arguments.size(), out);
+		} break;
+		case NodeType::MemberAccess: {
+			MemberAccessNode* maccess = (MemberAccessNode*)node;
+			if (!GetType(maccess->Object, a) || IsMatrix(a) || maccess->SwizzleCount == 0)
+				return false;
+			out = GetVectorType(GetBaseType(a), maccess->SwizzleCount);
+			return true;
+		} break;
+		case NodeType::ArrayAccess: {
+			ArrayAccessNode* aaccess = (ArrayAccessNode*)node;
+			if (!GetType(aaccess->Object, a))
+				return false;
+			for (int i = 0; i < aaccess->Indices.size(); i++) {
+				if (IsMatrix(a)) a = GetVectorType(ValueType::Float, GetRowCount(a));
+				else if (IsVector(a)) a = GetBaseType(a);
+				else return false;
+			}
+			out = a;
+			return true;
+		} break;
+		default: break;
+		}
+
+		return false;
+	}
+
+	Node* Optimizer::Simplify(Node* root, MathMode mode)
+	{
+		PhaseTimer timer(Phase::Analyze);
+		m_mode = mode;
+		if (root == nullptr)
+			return nullptr;
+		return m_simplify(root);
+	}
+	bool Optimizer::m_isConstant(Node* node, float value)
+	{
+		Value val;
+		if (!GetConstant(node, val) || GetBaseType(val.Type) == ValueType::Bool || !ConvertValue(val, ValueType::Float, val))
+			return false;
+
+		for (int i = 0; i < GetComponentCount(val.Type); i++)
+			if (val.Float[i] != value)
+				return false;
+		return true;
+	}
+	bool Optimizer::m_isFloat(Node* node)
+	{
+		ValueType type;
+		return GetType(node, type) && GetBaseType(type) == ValueType::Float && !IsMatrix(type);
+	}
+	Node* Optimizer::m_createBinary(int op, Node* left, Node* right)
+	{
+		BinaryExpressionNode* node = m_allocateNode<BinaryExpressionNode>();
+		node->Operator = op;
+		node->Left = left;
+		node->Right = right;
+		return node;
+	}
+	Node* Optimizer::m_createCall(Builtin func, Node* a, Node* b, Node* c)
+	{
+		FunctionCallNode* node = m_allocateNode<FunctionCallNode>();
+		strncpy(node->Name, GetBuiltinInfo(func)->Name, sizeof(node->Name) - 1);
+		node->Name[sizeof(node->Name) - 1] = 0;
+		node->TokenType = TokenType_Identifier;
+		node->BuiltinID = func;
+
+		node->Arguments.push_back(a);
+		if (b) node->Arguments.push_back(b);
+		if (c) node->Arguments.push_back(c);
+
+		return node;
+	}
+	Node* Optimizer::m_simplify(Node* node)
+	{
+		switch (node->GetNodeType()) {
+		case NodeType::BinaryExpression: {
+			BinaryExpressionNode* bexpr = (BinaryExpressionNode*)node;
+			bexpr->Left = m_simplify(bexpr->Left);
+			bexpr->Right = m_simplify(bexpr->Right);
+			return m_keepRange(bexpr, m_simplifyBinary(bexpr));
+		} break;
+		case NodeType::TernaryExpression: {
+			TernaryExpressionNode* texpr = (TernaryExpressionNode*)node;
+			texpr->Condition = m_simplify(texpr->Condition);
+			texpr->OnTrue = m_simplify(texpr->OnTrue);
+			texpr->OnFalse = m_simplify(texpr->OnFalse);
+		} break;
+		case NodeType::UnaryExpression: {
+			UnaryExpressionNode* uexpr = (UnaryExpressionNode*)node;
+			uexpr->Child = m_simplify(uexpr->Child);
+
+			// -(-x), !!x
+			if (uexpr->Child->GetNodeType() == NodeType::UnaryExpression && (uexpr->Operator == '-' || uexpr->Operator == '!')) {
+				UnaryExpressionNode* child = (UnaryExpressionNode*)uexpr->Child;
+				ValueType inner, outer;
+				if (child->Operator == uexpr->Operator && GetType(child->Child, inner) && GetType(uexpr, outer) && inner == outer)
+					return child->Child;
+			}
+		} break;
+		case NodeType::Cast: {
+			CastNode* cast = (CastNode*)node;
+			cast->Object = m_simplify(cast->Object);
+		} break;
+		case NodeType::FunctionCall: {
+			FunctionCallNode* fcall = (FunctionCallNode*)node;
+			for (int i = 0; i < fcall->Arguments.size(); i++)
+				fcall->Arguments[i] = m_simplify(fcall->Arguments[i]);
+			return m_keepRange(fcall, m_simplifyCall(fcall));
+		} break;
+		case NodeType::MethodCall: {
+			MethodCallNode* mcall = (MethodCallNode*)node;
+			mcall->Object = m_simplify(mcall->Object);
+			for (int i = 0; i < mcall->Arguments.size(); i++)
+				mcall->Arguments[i] = m_simplify(mcall->Arguments[i]);
+		} break;
+		case NodeType::MemberAccess: {
+			MemberAccessNode* maccess = (MemberAccessNode*)node;
+			maccess->Object = m_simplify(maccess->Object);
+		} break;
+		case NodeType::ArrayAccess: {
+			ArrayAccessNode* aaccess = (ArrayAccessNode*)node;
+			aaccess->Object = m_simplify(aaccess->Object);
+			for (int i = 0; i < aaccess->Indices.size(); i++)
+				aaccess->Indices[i] = m_simplify(aaccess->Indices[i]);
+		} break;
+		default: break;
+		}
+
+		return node;
+	}
+	Node* Optimizer::m_simplifyBinary(BinaryExpressionNode* bexpr)
+	{
+		ValueType lType, rType, opBase, resType;
+		if (!GetType(bexpr->Left, lType) || !GetType(bexpr->Right, rType) || !ResolveBinaryType(bexpr->Operator, lType, rType, opBase, resType))
+			return bexpr;
+
+		Node* left = bexpr->Left;
+		Node* right = bexpr->Right;
+		bool isFast = m_mode == MathMode::Fast;
+
+		switch (bexpr->Operator) {
+		case '+': {
+			// x + 0, 0 + x
+			if (m_isConstant(right, 0.0f) && resType == lType) return left;
+			if (m_isConstant(left, 0.0f) && resType == rType) return right;
+
+			// a * b + c -> fma(a, b, c)
+			if (isFast && GetBaseType(resType) == ValueType::Float && !IsMatrix(resType)) {
+				for (int i = 0; i < 2; i++) {
+					Node* mul = i == 0 ? left : right;
+					Node* add = i == 0 ? right : left;
+					if (mul->GetNodeType() != NodeType::BinaryExpression || ((BinaryExpressionNode*)mul)->Operator != '*')
+						continue;
+
+					BinaryExpressionNode* mexpr = (BinaryExpressionNode*)mul;
+					ValueType aType, bType, cType;
+					if (GetType(mexpr->Left, aType) && GetType(mexpr->Right, bType) && GetType(add, cType) &&
+						aType == resType && bType == resType && cType == resType)
+						return m_createCall(Builtin_Fma, mexpr->Left, mexpr->Right, add);
+				}
+			}
+		} break;
+		case '-': {
+			// x - 0
+			if (m_isConstant(right, 0.0f) && resType == lType) return left;
+		} break;
+		case '*': {
+			// x * 1, 1 * x
+			if (m_isConstant(right, 1.0f) && resType == lType) return left;
+			if (m_isConstant(left, 1.0f) && resType == rType) return right;
+
+			// x * 0 is only exact for integers (NaN * 0 = NaN, inf * 0 = NaN), and dropping x
+			// must not hide a failure or a side effect (user functions, method calls)
+			bool isLeftZero = m_isConstant(left, 0.0f), isRightZero = m_isConstant(right, 0.0f);
+			Node* other = isLeftZero ? right : left;
+			if ((isFast || opBase != ValueType::Float) && !IsMatrix(resType) && (isLeftZero || isRightZero) && !CanFail(other)) {
+				Value zero;
+				zero.Type = resType;
+				Node* ret = CreateConstant(zero);
+				if (ret) return ret;
+			}
+		} break;
+		case '/': {
+			// x / 1
+			if (m_isConstant(right, 1.0f) && resType == lType) return left;
+
+			// x / c -> x * (1 / c), exact when c is a power of two
+			Value divisor;
+			if (opBase == ValueType::Float && !IsMatrix(lType) && GetConstant(right, divisor) && ConvertValue(divisor, ValueType::Float, divisor)) {
+				Value reciprocal = divisor;
+				bool isValid = true;
+				for (int i = 0; i < GetComponentCount(divisor.Type); i++) {
+					int exponent = 0;
+					float mantissa = frexpf(divisor.Float[i], &exponent);
+					if (divisor.Float[i] == 0.0f || !isfinite(divisor.Float[i]) || (!isFast && fabsf(mantissa) != 0.5f))
+						isValid = false;
+					else
+						reciprocal.Float[i] = 1.0f / divisor.Float[i];
+				}
+
+				Node* constant = isValid ? CreateConstant(reciprocal) : nullptr;
+				if (constant)
+					return m_createBinary('*', left, constant);
+			}
+		} break;
+		}
+
+		return bexpr;
+	}
+	Node* Optimizer::m_simplifyCall(FunctionCallNode* fcall)
+	{
+		if (fcall->TokenType != TokenType_Identifier)
+			return fcall;
+
+		bool isFast = m_mode == MathMode::Fast;
+
+		if (fcall->BuiltinID == Builtin_Pow && fcall->Arguments.size() == 2) {
+			Node* x = fcall->Arguments[0];
+			Node* y = fcall->Arguments[1];
+			Value exponent;
+			if (!m_isFloat(x) || !GetConstant(y, exponent) || !IsScalar(exponent.Type) || !ConvertValue(exponent, ValueType::Float, exponent))
+				return fcall;
+
+			float e = exponent.Float[0];
+			if (e == 1.0f)
+				return x;
+			// x is shared, so it is still only computed once
+			if (e == 2.0f)
+				return m_createBinary('*', x, x);
+
+			if (isFast) {
+				if (e == 0.5f)
+					return m_createCall(Builtin_Sqrt, x, nullptr, nullptr);
+				if (e == -0.5f)
+					return m_createCall(Builtin_InverseSqrt, x, nullptr, nullptr);
+				if (e == -1.0f)
+					return m_createBinary('/', CreateConstant(MakeFloat(1.0f)), x);
+				if (e == 3.0f)
+					return m_createBinary('*', m_createBinary('*', x, x), x);
+			}
+		}
+
+		return fcall;
+	}
+
+	Node* Optimizer::EliminateCommonSubexpressions(Node* root)
+	{
+		PhaseTimer timer(Phase::Analyze);
+		m_canonical.clear();
+		m_buckets.clear();
+		if (root == nullptr)
+			return nullptr;
+		return m_eliminate(root);
+	}
+	void Optimizer::EliminateCommonSubexpressions(std::vector<Node*>& roots)
+	{
+		PhaseTimer timer(Phase::Analyze);
+		m_canonical.clear();
+		m_buckets.clear();
+		for (Node*& root : roots)
+			if (root != nullptr)
+				root = m_eliminate(root);
+	}
+	Node* Optimizer::m_eliminate(Node* node)
+	{
+		// the tree might already be a DAG (pow(x, 2) -> x*x)
+		auto visited = m_canonical.find(node);
+		if (visited != m_canonical.end())
+			return visited->second;
+
+		// children are canonical after this so comparing their pointers is enough
+		std::vector<Node**> children;
+		GetChildPointers(node, children);
+		for (Node** child : children)
+			*child = m_eliminate(*child);
+
+		Node* ret = node;
+		if (IsPure(node)) {
+			std::vector<Node*>& bucket = m_buckets[m_hash(node)];
+			for (Node* other : bucket) {
+				if (m_isEqual(node, other)) {
+					ret = other;
+					break;
+				}
+			}
+			if (ret == node)
+				bucket.push_back(node);
+		}
+
+		m_canonical[node] = ret;
+		return ret;
+	}
+	size_t Optimizer::m_hash(Node* node)
+	{
+		size_t hash = (size_t)node->GetNodeType();
+		auto combine = [&](size_t value) {
+			hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+		};
+
+		switch (node->GetNodeType()) {
+		case NodeType::FloatLiteral: {
+			unsigned int bits;
+			memcpy(&bits, &((FloatLiteralNode*)node)->Value, sizeof(bits));
+			combine(bits);
+		} break;
+		case NodeType::IntegerLiteral: combine((size_t)((IntegerLiteralNode*)node)->Value); break;
+		case NodeType::BooleanLiteral: combine((size_t)((BooleanLiteralNode*)node)->Value); break;
+		case NodeType::Identifier: combine(std::hash<std::string>()(((IdentifierNode*)node)->Name)); break;
+		case NodeType::BinaryExpression: combine(((BinaryExpressionNode*)node)->Operator); break;
+		case NodeType::UnaryExpression: {
+			UnaryExpressionNode* uexpr = (UnaryExpressionNode*)node;
+			combine(uexpr->Operator);
+			combine(uexpr->IsPost);
+		} break;
+		case NodeType::Cast: combine(((CastNode*)node)->Type); break;
+		case NodeType::FunctionCall:
+		case NodeType::MethodCall: {
+			// aliases (frac/fract, ddx/dFdx, ...) are the same function
+			FunctionCallNode* fcall = (FunctionCallNode*)node;
+			if (fcall->BuiltinID == Builtin_None)
+				combine(std::hash<std::string>()(fcall->Name));
+			combine(fcall->BuiltinID);
+			combine(fcall->TokenType);
+		} break;
+		case NodeType::MemberAccess: combine(std::hash<std::string>()(((MemberAccessNode*)node)->Field)); break;
+		default: break;
+		}
+
+		std::vector<Node*> children;
+		GetChildren(node, children);
+		for (Node* child : children)
+			combine(std::hash<Node*>()(child));
+
+		return hash;
+	}
+	bool Optimizer::m_isEqual(Node* a, Node* b)
+	{
+		if (a->GetNodeType() != b->GetNodeType())
+			return false;
+
+		switch (a->GetNodeType()) {
+		case NodeType::FloatLiteral:
+			if (memcmp(&((FloatLiteralNode*)a)->Value, &((FloatLiteralNode*)b)->Value, sizeof(float)) != 0) return false;
+			break;
+		case NodeType::IntegerLiteral:
+			if (((IntegerLiteralNode*)a)->Value != ((IntegerLiteralNode*)b)->Value) return false;
+			break;
+		case NodeType::BooleanLiteral:
+			if (((BooleanLiteralNode*)a)->Value != ((BooleanLiteralNode*)b)->Value) return false;
+			break;
+		case NodeType::Identifier:
+			if (strcmp(((IdentifierNode*)a)->Name, ((IdentifierNode*)b)->Name) != 0) return false;
+			break;
+		case NodeType::BinaryExpression:
+			if (((BinaryExpressionNode*)a)->Operator != ((BinaryExpressionNode*)b)->Operator) return false;
+			break;
+		case NodeType::UnaryExpression: {
+			UnaryExpressionNode* ua = (UnaryExpressionNode*)a;
+			UnaryExpressionNode* ub = (UnaryExpressionNode*)b;
+			if (ua->Operator != ub->Operator || ua->IsPost != ub->IsPost) return false;
+		} break;
+		case NodeType::Cast:
+			if (((CastNode*)a)->Type != ((CastNode*)b)->Type) return false;
+			break;
+		case NodeType::FunctionCall:
+		case NodeType::MethodCall: {
+			FunctionCallNode* fa = (FunctionCallNode*)a;
+			FunctionCallNode* fb = (FunctionCallNode*)b;
+			if (fa->BuiltinID != fb->BuiltinID || fa->TokenType != fb->TokenType) return false;
+			if (fa->BuiltinID == Builtin_None && strcmp(fa->Name, fb->Name) != 0) return false;
+		} break;
+		case NodeType::MemberAccess:
+			if (strcmp(((MemberAccessNode*)a)->Field, ((MemberAccessNode*)b)->Field) != 0) return false;
+			break;
+		default: break;
+		}
+
+		std::vector<Node*> childrenA, childrenB;
+		GetChildren(a, childrenA);
+		GetChildren(b, childrenB);
+		return childrenA == childrenB;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+#include "Parser.h"
+#include "Value.h"
+#include "Builtins.h"
+#include "Functions.h"
+
+#include <string>
+#include <unordered_map>
+
+namespace expr
+{
+	// AST level optimizations that run before any backend sees the tree - nodes that
+	// the passes create are added to the parser's list so Parser::Clear() frees them too
+	class Optimizer
+	{
+	public:
+		Optimizer(Parser& parser);
+
+		// folds literal subtrees and prunes ternaries with constant conditions - pruning and
+		// the false && x / true || x folds need the type of the dropped operand, so they only
+		// happen for operands whose types are known (literals or variables set with SetVariableType)
+		Node* Fold(Node* root);
+
+		// algebraic simplification and strength reduction - rewrites only happen when the
+		// types of the operands are known, so set the variable types before calling this
+		Node* Simplify(Node* root, MathMode mode = MathMode::Precise);
+
+		// makes structurally identical pure subtrees share one node, which turns the tree
+		// into a DAG - backends then compute each shared node only once (see GetSharedNodes)
+		Node* EliminateCommonSubexpressions(Node* root);
+		void EliminateCommonSubexpressions(std::vector<Node*>& roots); // shared between all of the roots
+
+		void SetVariableType(const std::string& name, ValueType type);
+		bool GetType(Node* node, ValueType& out);
+
+		// constants are literals and vector constructors that only take constants
+		bool GetConstant(Node* node, Value& out);
+		Node* CreateConstant(const Value& val);
+
+	private:
+		Node* m_fold(Node* node);
+		Node* m_simplify(Node* node);
+		Node* m_simplifyBinary(BinaryExpressionNode* bexpr);
+		Node* m_simplifyCall(FunctionCallNode* fcall);
+		bool m_getType(Node* node, ValueType& out);
+		bool m_isConstant(Node* node, float value);
+		bool m_isFloat(Node* node);
+		Node* m_createBinary(int op, Node* left, Node* right);
+		Node* m_createCall(Builtin func, Node* a, Node* b, Node* c);
+		Node* m_replace(Node* node, const Value& val);
+		Node* m_keepRange(Node* node, Node* replacement);
+		bool m_isCanonical(FunctionCallNode* fcall, ValueType type);
+		Node* m_eliminate(Node* node);
+		size_t m_hash(Node* node);
+		bool m_isEqual(Node* a, Node* b);
+
+		template<typename T>
+		T* m_allocateNode() {
+			T* ret = new T();
+			m_list.push_back((Node*)ret);
+			return ret;
+		}
+
+		std::vector<Node*>& m_list;
+
+		MathMode m_mode;
+		std::unordered_map<std::string, ValueType> m_varTypes;
+		std::unordered_map<Node*, ValueType> m_types;
+
+		std::unordered_map<Node*, Node*> m_canonical;
+		std::unordered_map<size_t, std::vector<Node*>> m_buckets;
+	};
+}
\ No newline at end of file
@@ -1,4 +1,7 @@
 #include "Parser.h"
+#include "Syntax.h"
+#include "Builtins.h"
+#include "Value.h"
 #include <string.h>
 
 namespace expr
@@ -8,36 +11,12 @@ namespace expr
 	{
 		m_hasError = false;
 		m_error = "";
-
-		m_opPrecedence['*'] = 1;
-		m_opPrecedence['/'] = 1;
-		m_opPrecedence['%'] = 1;
-
-		m_opPrecedence['+'] = 2;
-		m_opPrecedence['-'] = 2;
-
-		m_opPrecedence[TokenType_BitshiftLeft] = 3;
-		m_opPrecedence[TokenType_BitshiftRight] = 3;
-
-		m_opPrecedence['<'] = 4;
-		m_opPrecedence['>'] = 4;
-		m_opPrecedence[TokenType_LessThanEqual] = 4;
-		m_opPrecedence[TokenType_GreaterThanEqual] = 4;
-
-		m_opPrecedence[TokenType_Equal] = 5;
-		m_opPrecedence[TokenType_NotEqual] = 5;
-
-		m_opPrecedence['&'] = 6;
-		m_opPrecedence['^'] = 7;
-		m_opPrecedence['|'] = 8;
-		m_opPrecedence[TokenType_LogicAnd] = 9;
-		m_opPrecedence[TokenType_LogicOr] = 10;
-
-		m_opPrecedence[TokenTypeCount] = 10; // store max here
 	}
 
 	Node* Parser::Parse()
 	{
+		PhaseTimer timer(Phase::Parse);
+
 		m_token.Next();
 		Node* ret = m_parseTernaryExpression();
 		
@@ -48,6 +27,7 @@ namespace expr
 		}
 
 		// check for nulls
+		PhaseTimer validateTimer(Phase::Validate);
 		for (auto& node : m_list) {
 			if (m_hasError) break;
 
@@ -143,15 +123,16 @@ namespace expr
 	{
 		return (nodeType == NodeType::ArrayAccess || nodeType == NodeType::MemberAccess || nodeType == NodeType::Identifier);
 	}
+	void Parser::m_setRange(Node* node, size_t start)
+	{
+		node->SourceStart = start;
+		node->SourceEnd = m_token.GetPreviousEnd();
+	}
 	bool Parser::m_isType(int tokenType)
 	{
-		return (tokenType == TokenType_Bool || tokenType == TokenType_Bool2 || tokenType == TokenType_Bool3 || tokenType == TokenType_Bool4) ||
-			(tokenType == TokenType_Int || tokenType == TokenType_Int2 || tokenType == TokenType_Int3 || tokenType == TokenType_Int4) ||
-			(tokenType == TokenType_Float || tokenType == TokenType_Float2 || tokenType == TokenType_Float3 || tokenType == TokenType_Float4) ||
-			(tokenType == TokenType_Uint || tokenType == TokenType_Uint2 || tokenType == TokenType_Uint3 || tokenType == TokenType_Uint4) ||
-			(tokenType == TokenType_Float2x2 || tokenType == TokenType_Float3x3 || tokenType == TokenType_Float4x4);
+		return IsTypeToken(tokenType);
 	}
-	Node* Parser::m_parseFunctionCall(char* fname, int tokType)
+	Node* Parser::m_parseFunctionCall(char* fname, int tokType, size_t start)
 	{
 		FunctionCallNode* node = (FunctionCallNode*)m_allocateNode<FunctionCallNode>();
 		memcpy(node->Name, fname, 256);
@@ -161,6 +142,13 @@ namespace expr
 		m_parseArguments(node->Arguments);
 		m_eat(')');
 
+		// hosts can define functions that reuse builtin names with other signatures, so a call
+		// with the wrong argument count isn't an error here - it's left to the backends
+		const BuiltinInfo* builtin = tokType == TokenType_Identifier ? FindBuiltin(fname) : nullptr;
+		bool isBuiltin = builtin && node->Arguments.size() >= builtin->MinArgs && node->Arguments.size() <= builtin->MaxArgs;
+		node->BuiltinID = isBuiltin ? builtin->ID : Builtin_None;
+		m_setRange(node, start);
+
 		Node* ret = node;
 		Node* ext = m_parseExtIdentifier(node);
 		if (ext != nullptr) ret = ext;
@@ -177,6 +165,7 @@ namespace expr
 			node->Indices.push_back(m_parseTernaryExpression());
 			m_eat(']');
 		}
+		m_setRange(node, parent->SourceStart);
 
 		Node* ret = node;
 		Node* ext = m_parseExtIdentifier(node);
@@ -186,6 +175,7 @@ namespace expr
 	}
 	Node* Parser::m_parseMemberAccess(Node* parent)
 	{
+		size_t start = parent ? parent->SourceStart : m_token.GetTokenStart();
 		m_eat('.');
 
 		char identifier[256] = { 0 };
@@ -199,17 +189,21 @@ namespace expr
 			memcpy(node->Name, identifier, 256);
 			node->Object = parent;
 			node->TokenType = TokenType_Identifier;
+			node->BuiltinID = Builtin_None;
 
 			m_eat('(');
 			m_parseArguments(node->Arguments);
 			m_eat(')');
+			m_setRange(node, start);
 
 			ret = (Node*)node;
 		}
 		else {
 			MemberAccessNode* node = (MemberAccessNode*)m_allocateNode<MemberAccessNode>();
 			memcpy(node->Field, identifier, 256);
+			node->SwizzleCount = GetSwizzleIndices(identifier, node->Swizzle);
 			node->Object = parent;
+			m_setRange(node, start);
 			ret = (Node*)node;
 		}
 
@@ -250,6 +244,7 @@ namespace expr
 				uOp->Operator = operatorType;
 				uOp->Child = parent;
 				uOp->IsPost = true;
+				m_setRange(uOp, parent->SourceStart);
 				return uOp;
 			} else {
 				m_hasError = true;
@@ -261,6 +256,7 @@ namespace expr
 	}
 	Node* Parser::m_parseValue()
 	{
+		size_t start = m_token.GetTokenStart();
 		Node* ret = nullptr;
 		if (m_isToken('+') || m_isToken('-') || m_isToken('!') || m_isToken('~')) {
 			int operatorType = m_token.GetTokenType();
@@ -269,21 +265,25 @@ namespace expr
 			uOp->Operator = operatorType;
 			uOp->Child = m_parseValue();
 			uOp->IsPost = false;
+			m_setRange(uOp, start);
 			ret = uOp;
 		} else if (m_isToken(TokenType_IntegerLiteral)) {
 			IntegerLiteralNode* node = (IntegerLiteralNode*)m_allocateNode<IntegerLiteralNode>();
 			node->Value = m_token.GetIntValue();
 			m_eat(TokenType_IntegerLiteral);
+			m_setRange(node, start);
 			ret = node;
 		} else if (m_isToken(TokenType_FloatLiteral)) {
 			FloatLiteralNode* node = (FloatLiteralNode*)m_allocateNode<FloatLiteralNode>();
 			node->Value = m_token.GetFloatValue();
 			m_eat(TokenType_FloatLiteral);
+			m_setRange(node, start);
 			ret = node;
 		} else if (m_isToken(TokenType_BooleanLiteral)) {
 			BooleanLiteralNode* node = (BooleanLiteralNode*)m_allocateNode<BooleanLiteralNode>();
 			node->Value = m_token.GetIntValue();
 			m_eat(TokenType_BooleanLiteral);
+			m_setRange(node, start);
 			ret = node;
 		} else if (m_isToken(TokenType_Identifier) || m_isToken(TokenType_Increment) || m_isToken(TokenType_Decrement)) {
 			ret = m_parseIdentifier();
@@ -301,12 +301,15 @@ namespace expr
 					canHaveMember = true;
 					ret = m_parseTernaryExpression();
 					m_eat(')');
+					if (ret != nullptr)
+						m_setRange(ret, start);
 				} else {
 					m_eat(')');
 
 					CastNode* node = (CastNode*)m_allocateNode<CastNode>();
 					node->Object = m_parseValue();
 					node->Type = castType;
+					m_setRange(node, start);
 
 					ret = node;
 				}
@@ -314,6 +317,8 @@ namespace expr
 				canHaveMember = true;
 				ret = m_parseTernaryExpression();
 				m_eat(')');
+				if (ret != nullptr)
+					m_setRange(ret, start);
 			}
 
 			if (m_isToken('.')) {
@@ -333,14 +338,15 @@ namespace expr
 
 			m_eat(m_token.GetTokenType());
 
-			ret = m_parseFunctionCall(identifier, tokType);
+			ret = m_parseFunctionCall(identifier, tokType, start);
 		}
 
 		return ret;
 	}
 	Node* Parser::m_parseTernaryExpression()
 	{
-		Node* node = m_parseExpression(m_opPrecedence[TokenTypeCount]);
+		size_t start = m_token.GetTokenStart();
+		Node* node = m_parseExpression(MaxOperatorPrecedence);
 
 		if (m_isToken('?')) {
 			m_eat('?');
@@ -350,6 +356,7 @@ namespace expr
 			ternNode->OnTrue = m_parseTernaryExpression();
 			m_eat(':');
 			ternNode->OnFalse = m_parseTernaryExpression();
+			m_setRange(ternNode, start);
 
 			node = (Node*)ternNode;
 		}
@@ -361,17 +368,11 @@ namespace expr
 		if (prec == 0)
 			return m_parseValue();
 
+		size_t start = m_token.GetTokenStart();
 		Node* node = m_parseExpression(prec - 1);
 
 		while (true) {
-			bool shouldContinue = false;
-			for (const auto& op : m_opPrecedence)
-				if (op.second == prec && m_isToken(op.first)) {
-					shouldContinue = true;
-					break;
-				}
-
-			if (!shouldContinue)
+			if (GetOperatorPrecedence(m_token.GetTokenType()) != prec)
 				break;
 
 			int operatorType = m_token.GetTokenType();
@@ -381,6 +382,7 @@ namespace expr
 			binNode->Left = node;
 			binNode->Operator = operatorType;
 			binNode->Right = m_parseExpression(prec - 1);
+			m_setRange(binNode, start);
 
 			node = (Node*)binNode;
 		}
@@ -390,6 +392,7 @@ namespace expr
 	Node* Parser::m_parseIdentifier()
 	{
 		// prefix increment / decrement
+		size_t start = m_token.GetTokenStart();
 		int operatorType = -1;
 		if (m_isToken(TokenType_Increment) || m_isToken(TokenType_Decrement)) {
 			operatorType = m_token.GetTokenType();
@@ -397,6 +400,7 @@ namespace expr
 		}
 
 		// cache identifier
+		size_t identStart = m_token.GetTokenStart();
 		int identTokType = m_token.GetTokenType();
 		char identifier[256];
 		memcpy(identifier, m_token.GetIdentifier(), 256);
@@ -409,12 +413,13 @@ namespace expr
 				m_hasError = true;
 			}
 
-			return m_parseFunctionCall(identifier, identTokType);
+			return m_parseFunctionCall(identifier, identTokType, identStart);
 		}
 
 		// extended
 		IdentifierNode* node = (IdentifierNode*)m_allocateNode<IdentifierNode>();
 		memcpy(node->Name, identifier, 256);
+		m_setRange(node, identStart);
 		Node* ret = node;
 		Node* ext = m_parseExtIdentifier(node);
 		if (ext != nullptr) ret = ext;
@@ -426,6 +431,7 @@ namespace expr
 				uOp->Operator = operatorType;
 				uOp->Child = ret;
 				uOp->IsPost = false;
+				m_setRange(uOp, start);
 				ret = uOp;
 			} else {
 				m_hasError = true;
@@ -1,6 +1,7 @@
 #pragma once
 #include "Tokenizer.h"
 #include "Node.h"
+#include "Instrumentation.h"
 
 #include <vector>
 #include <string>
@@ -26,7 +27,7 @@ namespace expr
 		Node* m_parseExpression(int precedence);
 		Node* m_parseIdentifier();
 		Node* m_parseExtIdentifier(Node* parent);
-		Node* m_parseFunctionCall(char* fname, int tokType);
+		Node* m_parseFunctionCall(char* fname, int tokType, size_t start);
 		Node* m_parseArrayAccess(Node* parent);
 		Node* m_parseMemberAccess(Node* parent);
 		void m_parseArguments(std::vector<Node*>& args);
@@ -36,9 +37,14 @@ namespace expr
 		bool m_isLValue(NodeType nodeType);
 		bool m_eat(int tokenType);
 		bool m_isToken(int tokenType);
+		void m_setRange(Node* node, size_t start);
 
 		template<typename T>
 		Node* m_allocateNode() {
+			if (IsInstrumentationEnabled()) {
+				RecordCount(Counter::Nodes, 1);
+				RecordCount(Counter::BytesAllocated, sizeof(T));
+			}
 			m_list.push_back((Node*)new T());
 			return m_list.back();
 		}
@@ -49,7 +55,5 @@ namespace expr
 
 		bool m_hasError;
 		std::string m_error;
-
-		std::unordered_map<int, unsigned char> m_opPrecedence;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include "PredicateEvaluator.h"
+#include "Analysis.h"
+#include "Tokenizer.h"
+
+#include <algorithm>
+
+namespace expr
+{
+	PredicateEvaluator::PredicateEvaluator(Node* root)
+	{
+		m_batchSize = 256;
+		m_hasError = false;
+		m_error = "";
+
+		if (root != nullptr)
+			m_split(root);
+
+		// cheap tests first, so the expensive ones run for fewer invocations - conjuncts that can
+		// fail only run for the invocations that passed everything before them in the source, so
+		// they split the list into runs that are sorted separately
+		auto runStart = m_conjuncts.begin();
+		for (auto it = m_conjuncts.begin(); ; ++it) {
+			if (it == m_conjuncts.end() || it->CanFail) {
+				std::stable_sort(runStart, it, [](const Conjunct& a, const Conjunct& b) {
+					return a.Cost < b.Cost;
+				});
+				if (it == m_conjuncts.end())
+					break;
+				runStart = it + 1;
+			}
+		}
+		for (Conjunct& conj : m_conjuncts)
+			conj.Eval = new BatchEvaluator(conj.Root);
+	}
+	PredicateEvaluator::~PredicateEvaluator()
+	{
+		for (Conjunct& conj : m_conjuncts)
+			delete conj.Eval;
+	}
+	void PredicateEvaluator::m_split(Node* node)
+	{
+		if (node->GetNodeType() == NodeType::BinaryExpression) {
+			BinaryExpressionNode* bexpr = (BinaryExpressionNode*)node;
+			if (bexpr->Operator == TokenType_LogicAnd && bexpr->Left != nullptr && bexpr->Right != nullptr) {
+				m_split(bexpr->Left);
+				m_split(bexpr->Right);
+				return;
+			}
+		}
+
+		Conjunct conj;
+		conj.Root = node;
+		conj.Cost = EstimateCost(node);
+		conj.CanFail = CanFail(node);
+		conj.Eval = nullptr;
+		m_conjuncts.push_back(conj);
+	}
+	bool PredicateEvaluator::m_fail(const std::string& msg)
+	{
+		if (!m_hasError)
+			m_error = msg;
+		m_hasError = true;
+		return false;
+	}
+
+	void PredicateEvaluator::SetVariable(const std::string& name, const Value& val)
+	{
+		for (Conjunct& conj : m_conjuncts)
+			conj.Eval->SetVariable(name, val);
+
+		for (size_t i = 0; i < m_bindings.size(); i++)
+			if (m_bindings[i].Name == name) {
+				m_bindings.erase(m_bindings.begin() + i);
+				break;
+			}
+	}
+	void PredicateEvaluator::BindVariable(const std::string& name, const Value* values, int count)
+	{
+		for (Binding& binding : m_bindings)
+			if (binding.Name == name) {
+				binding.Values = values;
+				binding.Count = count;
+				return;
+			}
+		m_bindings.push_back({ name, values, count });
+	}
+
+	bool PredicateEvaluator::Find(int count, std::vector<int>& matches, size_t maxMatches)
+	{
+		m_hasError = false;
+		m_error = "";
+
+		if (m_conjuncts.empty())
+			return m_fail("empty expression");
+
+		for (const Binding& binding : m_bindings)
+			if (binding.Count < count)
+				return m_fail("not enough values for variable " + binding.Name);
+
+		m_mask.resize(m_batchSize);
+		m_results.resize(m_batchSize);
+
+		size_t found = 0;
+		for (int base = 0; base < count; base += m_batchSize) {
+			int laneCount = std::min(m_batchSize, count - base);
+
+			for (int l = 0; l < laneCount; l++)
+				m_mask[l] = 1;
+
+			int alive = laneCount;
+			for (Conjunct& conj : m_conjuncts) {
+				for (const Binding& binding : m_bindings)
+					conj.Eval->BindVariable(binding.Name, binding.Values + base, laneCount);
+
+				if (!conj.Eval->Evaluate(laneCount, m_results.data(), m_mask.data()))
+					return m_fail(conj.Eval->ErrorMessage());
+
+				alive = 0;
+				for (int l = 0; l < laneCount; l++) {
+					if (!m_mask[l])
+						continue;
+					if (m_results[l].Type != ValueType::Bool)
+						return m_fail("condition has to be a bool");
+					m_mask[l] = m_results[l].Bool[0];
+					alive += m_mask[l];
+				}
+
+				// the whole batch failed, the other conjuncts don't need to run
+				if (alive == 0)
+					break;
+			}
+
+			if (alive == 0)
+				continue;
+
+			for (int l = 0; l < laneCount; l++) {
+				if (!m_mask[l])
+					continue;
+				matches.push_back(base + l);
+				if (++found == maxMatches)
+					return true;
+			}
+		}
+
+		return true;
+	}
+}
\ No newline at end of file
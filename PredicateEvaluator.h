@@ -0,0 +1,64 @@
+#pragma once
+#include "BatchEvaluator.h"
+
+#include <vector>
+#include <string>
+
+namespace expr
+{
+	// tests a boolean condition (a conditional breakpoint) for a large number of invocations and
+	// returns the indices of the ones that pass. Top level && operands are split into separate
+	// conjuncts that run cheapest first, each only for the invocations that passed the previous
+	// ones, and a batch stops as soon as none of its invocations are left. Conjuncts that can
+	// fail (see CanFail) keep their place, so guards like i < 4 && v[i] > 0.5 still work.
+	class PredicateEvaluator
+	{
+	public:
+		PredicateEvaluator(Node* root);
+		~PredicateEvaluator();
+
+		// the same value for every invocation
+		void SetVariable(const std::string& name, const Value& val);
+		// one value per invocation - not copied, so values has to outlive the Find() calls
+		void BindVariable(const std::string& name, const Value* values, int count);
+
+		// appends the indices of the passing invocations to matches (in increasing order) and stops
+		// after maxMatches of them (0 = no limit)
+		bool Find(int count, std::vector<int>& matches, size_t maxMatches = 0);
+
+		inline void SetBatchSize(int size) { m_batchSize = size > 0 ? size : 1; }
+		inline int GetConjunctCount() { return (int)m_conjuncts.size(); }
+		inline Node* GetConjunct(int index) { return m_conjuncts[index].Root; } // in evaluation order
+
+		inline bool Error() { return m_hasError; }
+		inline const std::string& ErrorMessage() { return m_error; }
+
+	private:
+		struct Conjunct
+		{
+			Node* Root;
+			int Cost;
+			bool CanFail;
+			BatchEvaluator* Eval;
+		};
+		struct Binding
+		{
+			std::string Name;
+			const Value* Values;
+			int Count;
+		};
+
+		void m_split(Node* node);
+		bool m_fail(const std::string& msg);
+
+		std::vector<Conjunct> m_conjuncts;
+		std::vector<Binding> m_bindings;
+
+		int m_batchSize;
+		std::vector<unsigned char> m_mask;
+		std::vector<Value> m_results;
+
+		bool m_hasError;
+		std::string m_error;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,410 @@
+#pragma once
+#include "Syntax.h"
+#include "Value.h"
+#include "Operations.h"
+#include <string_view>
+
+namespace expr
+{
+	enum class StaticNodeKind
+	{
+		Literal,
+		Variable,
+		Unary,
+		Binary,
+		Ternary,
+		Call,		// builtin function
+		Construct	// float(x), (int)x, ...
+	};
+
+	struct StaticNode
+	{
+		StaticNodeKind Kind = StaticNodeKind::Literal;
+		ValueType Type = ValueType::Float;			// type of the result, always a scalar
+		ValueType OperandType = ValueType::Float;	// children get converted to this before the operation
+		int Operator = 0;
+		Builtin Function = Builtin_None;
+		int Children[3] = { 0, 0, 0 };
+		int ChildCount = 0;
+		float Float = 0.0f;
+		int Int = 0;
+		int Variable = 0;
+	};
+
+	// AST built by ParseStatic() - N is the length of the source, which is also the upper
+	// limit for the number of nodes and variables
+	template<size_t N>
+	struct StaticTree
+	{
+		StaticNode Nodes[N];
+		int NodeCount;
+		int Root;
+
+		char Names[N * 2];	// names of the variables, null terminated, in the order they first appear
+		int NameOffsets[N];
+		int NameLengths[N];
+		int VariableCount;
+
+		const char* Error;	// nullptr if the source was parsed
+
+		constexpr StaticTree() : Nodes(), NodeCount(0), Root(0), Names(), NameOffsets(), NameLengths(), VariableCount(0), Error(nullptr) { }
+
+		// empty for an index that isn't in [0, VariableCount)
+		constexpr std::string_view GetVariableName(int index) const
+		{
+			if (index < 0 || index >= VariableCount)
+				return std::string_view();
+			return std::string_view(&Names[NameOffsets[index]], (size_t)NameLengths[index]);
+		}
+		constexpr int FindVariable(const char* name, size_t length) const
+		{
+			for (int i = 0; i < VariableCount; i++)
+				if (GetVariableName(i) == std::string_view(name, length))
+					return i;
+			return -1;
+		}
+	};
+
+	// recursive descent parser that follows Parser (same ScanToken() and grammar tables from
+	// Syntax.h, same type rules from Value.h) but runs in constexpr context and only builds
+	// scalar expressions
+	template<size_t N>
+	class StaticParser
+	{
+	public:
+		constexpr StaticParser(const char* source) : m_tree(), m_source(source), m_pos(0), m_start(0), m_length(0), m_type(0), m_float(0.0f), m_int(0), m_nameLength(0) { }
+
+		constexpr StaticTree<N> Parse()
+		{
+			m_next();
+			m_tree.Root = m_parseTernary();
+			if (m_type != -1)
+				m_fail("Not fully parsed.");
+			return m_tree;
+		}
+
+	private:
+		// tokenizer
+		constexpr void m_next()
+		{
+			while (IsSpace(m_source[m_pos]))
+				m_pos++;
+
+			ScannedToken token = ScanToken(m_source + m_pos, m_source + N - 1);
+			m_start = m_pos;
+			m_pos += (int)token.Length;
+			m_length = (int)token.Length;
+			m_type = token.Type;
+			m_float = token.Float;
+			m_int = token.Int;
+		}
+		constexpr void m_expect(int tokenType)
+		{
+			if (m_type != tokenType)
+				m_fail("Unexpected token.");
+			else
+				m_next();
+		}
+
+		// parser
+		constexpr int m_parseTernary()
+		{
+			int node = m_parseExpression(MaxOperatorPrecedence);
+			if (m_type == '?') {
+				m_next();
+				int onTrue = m_parseTernary();
+				m_expect(':');
+				int onFalse = m_parseTernary();
+
+				// same rules as ApplySelect()
+				if (m_getType(node) != ValueType::Bool)
+					return m_fail("The condition of a ternary expression has to be a bool.");
+				ValueType type = m_getType(onTrue), operand = type, result = type;
+				if (m_getType(onFalse) != type) {
+					if (!ResolveBinaryType('+', type, m_getType(onFalse), operand, result))
+						return m_fail("Incompatible types in a ternary expression.");
+					type = operand;
+				}
+
+				int cond = m_addNode(StaticNodeKind::Ternary, type, ValueType::Bool, '?');
+				m_setChildren(cond, node, onTrue, onFalse, 3);
+				node = cond;
+			}
+			return node;
+		}
+		constexpr int m_parseExpression(int prec)
+		{
+			if (prec == 0)
+				return m_parseValue();
+
+			int node = m_parseExpression(prec - 1);
+			while (m_tree.Error == nullptr && GetOperatorPrecedence(m_type) == prec) {
+				int op = m_type;
+				m_next();
+				int right = m_parseExpression(prec - 1);
+				node = m_addBinary(op, node, right);
+			}
+			return node;
+		}
+		constexpr int m_parseValue()
+		{
+			int ret = 0;
+			if (m_type == '+' || m_type == '-' || m_type == '!' || m_type == '~') {
+				int op = m_type;
+				m_next();
+				int child = m_parseValue();
+
+				ValueType type = ValueType::Float;
+				if (!ResolveUnaryType(op, m_getType(child), type))
+					return m_fail("Invalid operand to unary expression.");
+
+				ret = m_addNode(StaticNodeKind::Unary, type, type, op);
+				m_setChildren(ret, child, 0, 0, 1);
+				return ret;
+			} else if (m_type == TokenType_IntegerLiteral || m_type == TokenType_BooleanLiteral) {
+				ret = m_addNode(StaticNodeKind::Literal, m_type == TokenType_IntegerLiteral ? ValueType::Int : ValueType::Bool, ValueType::Int, 0);
+				m_tree.Nodes[ret].Int = m_int;
+				m_next();
+			} else if (m_type == TokenType_FloatLiteral) {
+				ret = m_addNode(StaticNodeKind::Literal, ValueType::Float, ValueType::Float, 0);
+				m_tree.Nodes[ret].Float = m_float;
+				m_next();
+			} else if (m_type == TokenType_Identifier) {
+				int start = m_start, length = m_length;
+				m_next();
+				ret = m_type == '(' ? m_parseCall(start, length) : m_addVariable(start, length);
+			} else if (m_type == '(') {
+				m_next();
+
+				// (float)x is a cast, (float(x) + 1) isn't
+				if (IsTypeToken(m_type)) {
+					int type = m_type;
+					int pos = m_pos, start = m_start, length = m_length;
+					m_next();
+					if (m_type == ')') {
+						m_next();
+						return m_addConstruct(type, m_parseValue());
+					}
+
+					m_pos = pos;
+					m_start = start;
+					m_length = length;
+					m_type = type;
+				}
+
+				ret = m_parseTernary();
+				m_expect(')');
+			} else if (IsTypeToken(m_type)) {
+				int type = m_type;
+				m_next();
+				m_expect('(');
+				int child = m_parseTernary();
+				m_expect(')');
+				ret = m_addConstruct(type, child);
+			} else
+				return m_fail("Unexpected token.");
+
+			if (m_type == '.' || m_type == '[' || m_type == TokenType_Increment || m_type == TokenType_Decrement)
+				return m_fail("Member access, indexing and ++/-- aren't supported at compile time.");
+
+			return ret;
+		}
+		constexpr int m_parseCall(int start, int length)
+		{
+			const BuiltinInfo* info = FindBuiltin(m_source + start, length);
+			if (info == nullptr || (info->Signature != BuiltinSignature::Float && info->Signature != BuiltinSignature::Numeric))
+				return m_fail("Only scalar builtin functions can be called at compile time.");
+
+			int args[3] = { 0, 0, 0 };
+			int argCount = 0;
+			m_expect('(');
+			while (m_tree.Error == nullptr && m_type != ')') {
+				if (argCount == 3)
+					return m_fail("Wrong number of arguments passed to a builtin function.");
+				args[argCount++] = m_parseTernary();
+				if (m_type == ',')
+					m_next();
+				else
+					break;
+			}
+			m_expect(')');
+
+			if (argCount < info->MinArgs || argCount > info->MaxArgs)
+				return m_fail("Wrong number of arguments passed to a builtin function.");
+
+			// Numeric builtins work on the common base type (bool counts as int), see Functions.cpp
+			ValueType type = ValueType::Float;
+			if (info->Signature == BuiltinSignature::Numeric) {
+				type = ValueType::Int;
+				for (int i = 0; i < argCount; i++)
+					type = PromoteBaseType(type, m_getType(args[i]));
+			}
+
+			int node = m_addNode(StaticNodeKind::Call, type, type, 0);
+			m_tree.Nodes[node].Function = info->ID;
+			m_setChildren(node, args[0], args[1], args[2], argCount);
+			return node;
+		}
+		constexpr int m_addBinary(int op, int left, int right)
+		{
+			ValueType operand = ValueType::Float, result = ValueType::Float;
+			if (!ResolveBinaryType(op, m_getType(left), m_getType(right), operand, result))
+				return m_fail("Invalid operands to binary expression.");
+
+			int node = m_addNode(StaticNodeKind::Binary, result, operand, op);
+			m_setChildren(node, left, right, 0, 2);
+			return node;
+		}
+		constexpr int m_addConstruct(int tokenType, int child)
+		{
+			ValueType type = ValueType::Float;
+			if (!GetTokenValueType(tokenType, type) || !IsScalar(type))
+				return m_fail("Only scalar types are supported at compile time.");
+
+			int node = m_addNode(StaticNodeKind::Construct, type, type, 0);
+			m_setChildren(node, child, 0, 0, 1);
+			return node;
+		}
+		constexpr int m_addVariable(int start, int length)
+		{
+			int index = m_tree.FindVariable(m_source + start, length);
+			if (index < 0) {
+				index = m_tree.VariableCount++;
+				m_tree.NameOffsets[index] = m_nameLength;
+				m_tree.NameLengths[index] = length;
+				for (int i = 0; i < length; i++)
+					m_tree.Names[m_nameLength++] = m_source[start + i];
+				m_tree.Names[m_nameLength++] = 0;
+			}
+
+			int node = m_addNode(StaticNodeKind::Variable, ValueType::Float, ValueType::Float, 0);
+			m_tree.Nodes[node].Variable = index;
+			return node;
+		}
+		constexpr int m_addNode(StaticNodeKind kind, ValueType type, ValueType operand, int op)
+		{
+			if (m_tree.NodeCount >= (int)N)
+				return m_fail("Too many nodes.");
+
+			StaticNode& node = m_tree.Nodes[m_tree.NodeCount];
+			node.Kind = kind;
+			node.Type = type;
+			node.OperandType = operand;
+			node.Operator = op;
+			node.Function = Builtin_None;
+			return m_tree.NodeCount++;
+		}
+		constexpr void m_setChildren(int node, int a, int b, int c, int count)
+		{
+			m_tree.Nodes[node].Children[0] = a;
+			m_tree.Nodes[node].Children[1] = b;
+			m_tree.Nodes[node].Children[2] = c;
+			m_tree.Nodes[node].ChildCount = count;
+		}
+		constexpr ValueType m_getType(int node)
+		{
+			return m_tree.Nodes[node].Type;
+		}
+		constexpr int m_fail(const char* msg)
+		{
+			if (m_tree.Error == nullptr)
+				m_tree.Error = msg;
+			return 0;
+		}
+
+		StaticTree<N> m_tree;
+		const char* m_source;
+		int m_pos, m_start, m_length;
+
+		int m_type;
+		float m_float;
+		int m_int;
+
+		int m_nameLength;
+	};
+
+	template<size_t N>
+	constexpr StaticTree<N> ParseStatic(const char (&source)[N])
+	{
+		return StaticParser<N>(source).Parse();
+	}
+
+	template<ValueType T> struct StaticCType { typedef float Type; };
+	template<> struct StaticCType<ValueType::Int> { typedef int Type; };
+	template<> struct StaticCType<ValueType::Uint> { typedef unsigned int Type; };
+	template<> struct StaticCType<ValueType::Bool> { typedef bool Type; };
+
+	// evaluates a tree from ParseStatic() - every node is its own template instance, so the
+	// whole expression gets inlined into straight line code. Operators and builtins use the
+	// same kernels as the native evaluators (Operations.h). Tree has to be a constexpr
+	// variable with static storage duration:
+	//		static constexpr auto heat = expr::ParseStatic("clamp(x * 0.5 + y, 0.0, 1.0)");
+	//		float value = expr::StaticExpression<heat>::Evaluate(x, y);
+	// variables are floats and are passed in the order they first appear in the source
+	template<const auto& Tree>
+	class StaticExpression
+	{
+		static_assert(Tree.Error == nullptr, "the expression can't be parsed at compile time (see Tree.Error)");
+
+	public:
+		static constexpr int VariableCount = Tree.VariableCount;
+
+		template<typename... Args>
+		static inline auto Evaluate(Args... args)
+		{
+			static_assert(sizeof...(Args) == VariableCount, "pass one value per variable");
+			const float vars[VariableCount + 1] = { (float)args... };
+			return m_eval<Tree.Root>(vars);
+		}
+		static inline auto EvaluateArray(const float* vars)
+		{
+			return m_eval<Tree.Root>(vars);
+		}
+
+	private:
+		template<int Index, ValueType T>
+		static inline auto m_arg(const float* vars)
+		{
+			return (typename StaticCType<T>::Type)m_eval<Index>(vars);
+		}
+
+		template<int Index>
+		static inline auto m_eval(const float* vars)
+		{
+			constexpr StaticNode node = Tree.Nodes[Index];
+			constexpr ValueType type = node.OperandType;
+
+			if constexpr (node.Kind == StaticNodeKind::Literal) {
+				if constexpr (node.Type == ValueType::Float) return node.Float;
+				else if constexpr (node.Type == ValueType::Int) return node.Int;
+				else return node.Int != 0;
+			} else if constexpr (node.Kind == StaticNodeKind::Variable) {
+				return vars[node.Variable];
+			} else if constexpr (node.Kind == StaticNodeKind::Construct) {
+				return m_arg<node.Children[0], node.Type>(vars);
+			} else if constexpr (node.Kind == StaticNodeKind::Ternary) {
+				// only the branch that is taken gets evaluated
+				return m_arg<node.Children[0], ValueType::Bool>(vars) ? m_arg<node.Children[1], node.Type>(vars) : m_arg<node.Children[2], node.Type>(vars);
+			} else if constexpr (node.Kind == StaticNodeKind::Unary) {
+				return UnaryOperation<node.Operator>::Apply(m_arg<node.Children[0], type>(vars));
+			} else if constexpr (node.Kind == StaticNodeKind::Binary) {
+				// && and || short circuit
+				if constexpr (node.Operator == TokenType_LogicAnd)
+					return m_arg<node.Children[0], type>(vars) && m_arg<node.Children[1], type>(vars);
+				else if constexpr (node.Operator == TokenType_LogicOr)
+					return m_arg<node.Children[0], type>(vars) || m_arg<node.Children[1], type>(vars);
+				else
+					return BinaryOperation<node.Operator>::Apply(m_arg<node.Children[0], type>(vars), m_arg<node.Children[1], type>(vars));
+			} else {
+				// same kernels as the native functions in Functions.cpp
+				using Function = FunctionOperation<node.Function>;
+				if constexpr (node.ChildCount == 1)
+					return Function::Apply(m_arg<node.Children[0], type>(vars));
+				else if constexpr (node.ChildCount == 2)
+					return Function::Apply(m_arg<node.Children[0], type>(vars), m_arg<node.Children[1], type>(vars));
+				else
+					return Function::Apply(m_arg<node.Children[0], type>(vars), m_arg<node.Children[1], type>(vars), m_arg<node.Children[2], type>(vars));
+			}
+		}
+	};
+}
\ No newline at end of file
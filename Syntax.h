@@ -0,0 +1,494 @@
+#pragma once
+#include "Tokenizer.h"
+
+#include <stddef.h>
+#include <limits>
+
+namespace expr
+{
+	// grammar tables shared by the runtime Tokenizer/Parser and the compile time parser in
+	// StaticExpression.h - everything is constexpr so that both of them can use it
+
+	constexpr int MaxOperatorPrecedence = 10;
+
+	// precedence of a binary operator (1 binds the tightest), 0 for all other tokens
+	constexpr int GetOperatorPrecedence(int tokenType)
+	{
+		switch (tokenType) {
+		case '*': case '/': case '%': return 1;
+		case '+': case '-': return 2;
+		case TokenType_BitshiftLeft: case TokenType_BitshiftRight: return 3;
+		case '<': case '>': case TokenType_LessThanEqual: case TokenType_GreaterThanEqual: return 4;
+		case TokenType_Equal: case TokenType_NotEqual: return 5;
+		case '&': return 6;
+		case '^': return 7;
+		case '|': return 8;
+		case TokenType_LogicAnd: return 9;
+		case TokenType_LogicOr: return 10;
+		default: break;
+		}
+		return 0;
+	}
+
+	constexpr bool IsComparisonOperator(int tokenType)
+	{
+		return tokenType == '<' || tokenType == '>' || tokenType == TokenType_LessThanEqual || tokenType == TokenType_GreaterThanEqual ||
+			tokenType == TokenType_Equal || tokenType == TokenType_NotEqual;
+	}
+	constexpr bool IsBitwiseOperator(int tokenType)
+	{
+		return tokenType == '&' || tokenType == '|' || tokenType == '^' || tokenType == TokenType_BitshiftLeft || tokenType == TokenType_BitshiftRight;
+	}
+	constexpr bool IsArithmeticOperator(int tokenType)
+	{
+		return tokenType == '+' || tokenType == '-' || tokenType == '*' || tokenType == '/' || tokenType == '%';
+	}
+
+	constexpr bool IsSymbol(char c)
+	{
+		switch (c) {
+		case '+': case '-':
+		case '*': case '/':
+		case '%':
+		case '<': case '>':
+		case '(': case ')':
+		case '[': case ']':
+		case '{': case '}':
+		case ';': case '!':
+		case ',': case '.':
+		case '?': case ':':
+		case '|': case '&': case '^': case '~':
+			return true;
+		default: break;
+		}
+		return false;
+	}
+	constexpr bool IsSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+	}
+	constexpr bool IsDigit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	// token type of a two character operator, 0 if a and b aren't one
+	constexpr int GetTwoCharOperator(char a, char b)
+	{
+		if (a == '=' && b == '=') return TokenType_Equal;
+		if (a == '!' && b == '=') return TokenType_NotEqual;
+		if (a == '<' && b == '=') return TokenType_LessThanEqual;
+		if (a == '<' && b == '<') return TokenType_BitshiftLeft;
+		if (a == '>' && b == '=') return TokenType_GreaterThanEqual;
+		if (a == '>' && b == '>') return TokenType_BitshiftRight;
+		if (a == '+' && b == '+') return TokenType_Increment;
+		if (a == '-' && b == '-') return TokenType_Decrement;
+		if (a == '&' && b == '&') return TokenType_LogicAnd;
+		if (a == '|' && b == '|') return TokenType_LogicOr;
+		return 0;
+	}
+
+	struct KeywordInfo
+	{
+		const char* Name;
+		TokenType Type;
+	};
+
+	constexpr KeywordInfo KeywordTable[] = {
+		{ "float", TokenType_Float },
+		{ "float2", TokenType_Float2 },
+		{ "float3", TokenType_Float3 },
+		{ "float4", TokenType_Float4 },
+		{ "vec2", TokenType_Float2 },
+		{ "vec3", TokenType_Float3 },
+		{ "vec4", TokenType_Float4 },
+		{ "float2x2", TokenType_Float2x2 },
+		{ "float3x3", TokenType_Float3x3 },
+		{ "float4x4", TokenType_Float4x4 },
+		{ "mat2", TokenType_Float2x2 },
+		{ "mat3", TokenType_Float3x3 },
+		{ "mat4", TokenType_Float4x4 },
+		{ "int", TokenType_Int },
+		{ "int2", TokenType_Int2 },
+		{ "int3", TokenType_Int3 },
+		{ "int4", TokenType_Int4 },
+		{ "ivec2", TokenType_Int2 },
+		{ "ivec3", TokenType_Int3 },
+		{ "ivec4", TokenType_Int4 },
+		{ "uint", TokenType_Uint },
+		{ "uint2", TokenType_Uint2 },
+		{ "uint3", TokenType_Uint3 },
+		{ "uint4", TokenType_Uint4 },
+		{ "uvec2", TokenType_Uint2 },
+		{ "uvec3", TokenType_Uint3 },
+		{ "uvec4", TokenType_Uint4 },
+		{ "bool", TokenType_Bool },
+		{ "bool2", TokenType_Bool2 },
+		{ "bool3", TokenType_Bool3 },
+		{ "bool4", TokenType_Bool4 },
+		{ "bvec2", TokenType_Bool2 },
+		{ "bvec3", TokenType_Bool3 },
+		{ "bvec4", TokenType_Bool4 },
+	};
+
+	// true if the first length characters of name are exactly str
+	constexpr bool IsWord(const char* name, size_t length, const char* str)
+	{
+		for (size_t i = 0; i < length; i++)
+			if (str[i] != name[i])
+				return false;
+		return str[length] == 0;
+	}
+
+	// token type of a type keyword, TokenType_Identifier for every other name
+	constexpr int FindKeyword(const char* name, size_t length)
+	{
+		for (const KeywordInfo& keyword : KeywordTable)
+			if (IsWord(name, length, keyword.Name))
+				return keyword.Type;
+		return TokenType_Identifier;
+	}
+
+	constexpr bool IsTypeToken(int tokenType)
+	{
+		return tokenType >= TokenType_Float && tokenType <= TokenType_Bool4;
+	}
+
+	constexpr bool IsNumberEnd(char c)
+	{
+		return c == 0 || IsSpace(c) || IsSymbol(c);
+	}
+	constexpr int GetHexDigit(char c)
+	{
+		if (IsDigit(c)) return c - '0';
+		if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+		if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+		return -1;
+	}
+
+	// unsigned integer with just enough bits for the decimal literals that DecimalToFloat()
+	// can't convert with a single double operation
+	struct LiteralInteger
+	{
+		static constexpr int MaxWords = 24;
+
+		unsigned int Words[MaxWords];	// least significant first
+		int Count;
+
+		constexpr LiteralInteger(unsigned int value) : Words(), Count(value != 0) { Words[0] = value; }
+
+		constexpr void MultiplyAdd(unsigned int factor, unsigned int addend)
+		{
+			unsigned long long carry = addend;
+			for (int i = 0; i < Count; i++) {
+				carry += (unsigned long long)Words[i] * factor;
+				Words[i] = (unsigned int)carry;
+				carry >>= 32;
+			}
+			if (carry != 0 && Count < MaxWords)
+				Words[Count++] = (unsigned int)carry;
+		}
+		constexpr void ShiftLeft(int bits)
+		{
+			for (; bits > 0; bits--) {
+				unsigned int carry = 0;
+				for (int i = 0; i < Count; i++) {
+					unsigned int next = Words[i] >> 31;
+					Words[i] = (Words[i] << 1) | carry;
+					carry = next;
+				}
+				if (carry != 0 && Count < MaxWords)
+					Words[Count++] = carry;
+			}
+		}
+		constexpr int GetBitLength() const
+		{
+			if (Count == 0)
+				return 0;
+			int bits = (Count - 1) * 32;
+			for (unsigned int top = Words[Count - 1]; top != 0; top >>= 1)
+				bits++;
+			return bits;
+		}
+		constexpr bool GetBit(int bit) const
+		{
+			return bit / 32 < Count && ((Words[bit / 32] >> (bit % 32)) & 1) != 0;
+		}
+		constexpr bool IsZero() const { return Count == 0; }
+
+		constexpr bool IsLess(const LiteralInteger& other) const
+		{
+			if (Count != other.Count)
+				return Count < other.Count;
+			for (int i = Count - 1; i >= 0; i--)
+				if (Words[i] != other.Words[i])
+					return Words[i] < other.Words[i];
+			return false;
+		}
+		// requires other <= *this
+		constexpr void Subtract(const LiteralInteger& other)
+		{
+			long long borrow = 0;
+			for (int i = 0; i < Count; i++) {
+				long long diff = (long long)Words[i] - (i < other.Count ? other.Words[i] : 0) - borrow;
+				borrow = diff < 0;
+				Words[i] = (unsigned int)(diff + (borrow << 32));
+			}
+			while (Count > 0 && Words[Count - 1] == 0)
+				Count--;
+		}
+		// *this becomes the remainder
+		constexpr LiteralInteger Divide(const LiteralInteger& divisor)
+		{
+			LiteralInteger quotient(0), remainder(0);
+			for (int bit = GetBitLength() - 1; bit >= 0; bit--) {
+				remainder.ShiftLeft(1);
+				if (GetBit(bit)) {
+					if (remainder.Count == 0) remainder.Count = 1;
+					remainder.Words[0] |= 1;
+				}
+				quotient.ShiftLeft(1);
+				if (!remainder.IsLess(divisor)) {
+					remainder.Subtract(divisor);
+					if (quotient.Count == 0) quotient.Count = 1;
+					quotient.Words[0] |= 1;
+				}
+			}
+			*this = remainder;
+			return quotient;
+		}
+	};
+
+	constexpr double PowersOfTen[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	// true if a double in the normal float range lies exactly halfway between two floats -
+	// converting it to float would then round a second time
+	constexpr bool IsFloatMidpoint(double value)
+	{
+		while (value >= 33554432.0) value *= 0.5;
+		while (value < 16777216.0) value *= 2.0;
+
+		// floats in [2^24, 2^25) are the even integers
+		unsigned long long integer = (unsigned long long)value;
+		return (double)integer == value && (integer & 1) != 0;
+	}
+
+	// correctly rounded (like strtof) float value of the decimal digits in [str, end) times
+	// 10^exponent - a '.' in between is skipped
+	constexpr float DecimalToFloat(const char* str, const char* end, int exponent)
+	{
+		// enough significant digits to tell any two floats and the midpoint between them apart
+		constexpr int MaxDigits = 128;
+
+		unsigned long long mantissa = 0;
+		int digits = 0;
+		bool isTruncated = false;
+		for (const char* c = str; c != end; c++) {
+			if (*c == '.' || (digits == 0 && *c == '0'))
+				continue;
+			if (digits < 19)
+				mantissa = mantissa * 10 + (*c - '0');
+			else if (*c != '0')
+				isTruncated = true;
+			digits++;
+		}
+		if (digits == 0)
+			return 0.0f;
+
+		// mantissa and 10^scale are exact doubles, so the double result is rounded once
+		int scale = exponent + (digits > 19 ? digits - 19 : 0);
+		if (!isTruncated && mantissa < (1ull << 53) && scale >= -22 && scale <= 22) {
+			double value = scale < 0 ? (double)mantissa / PowersOfTen[-scale] : (double)mantissa * PowersOfTen[scale];
+			if ((double)(float)value == value || !IsFloatMidpoint(value))
+				return (float)value;
+		}
+
+		// exact path: value = numerator / denominator * 2^binaryExponent
+		LiteralInteger numerator(0), denominator(1);
+		int dropped = 0;
+		digits = 0;
+		isTruncated = false;
+		for (const char* c = str; c != end; c++) {
+			if (*c == '.' || (digits == 0 && *c == '0'))
+				continue;
+			if (digits < MaxDigits) {
+				numerator.MultiplyAdd(10, *c - '0');
+				digits++;
+			} else {
+				dropped++;
+				isTruncated = isTruncated || *c != '0';
+			}
+		}
+		exponent += dropped;
+
+		// value is in [10^(magnitude - 1), 10^magnitude)
+		int magnitude = digits + exponent;
+		if (magnitude > 39)
+			return std::numeric_limits<float>::infinity();
+		if (magnitude < -45)
+			return 0.0f;
+
+		for (int i = 0; i < exponent; i++)
+			numerator.MultiplyAdd(10, 0);
+		for (int i = 0; i < -exponent; i++)
+			denominator.MultiplyAdd(10, 0);
+
+		// at least 27 bits in the quotient: 24 for the float, a rounding bit and some slack
+		int binaryExponent = denominator.GetBitLength() - numerator.GetBitLength() + 27;
+		if (binaryExponent < 0)
+			binaryExponent = 0;
+		numerator.ShiftLeft(binaryExponent);
+		binaryExponent = -binaryExponent;
+
+		LiteralInteger quotient = numerator.Divide(denominator);
+		bool isSticky = isTruncated || !numerator.IsZero();
+
+		// keep 24 bits, or less for denormals (smallest float is 2^-149)
+		int shift = quotient.GetBitLength() - 24;
+		if (binaryExponent + shift < -149)
+			shift = -149 - binaryExponent;
+
+		unsigned long long rounded = 0;
+		for (int bit = quotient.GetBitLength() - 1; bit >= shift; bit--)
+			rounded = (rounded << 1) | quotient.GetBit(bit);
+		for (int bit = shift - 2; bit >= 0 && !isSticky; bit--)
+			isSticky = quotient.GetBit(bit);
+		binaryExponent += shift;
+
+		// round half to even
+		if (quotient.GetBit(shift - 1) && (isSticky || (rounded & 1) != 0))
+			rounded++;
+		if (rounded == (1ull << 24)) {
+			rounded >>= 1;
+			binaryExponent++;
+		}
+		if (binaryExponent > 104)
+			return std::numeric_limits<float>::infinity();
+
+		double value = (double)rounded;
+		for (; binaryExponent > 0; binaryExponent--) value *= 2.0;
+		for (; binaryExponent < 0; binaryExponent++) value *= 0.5;
+		return (float)value;
+	}
+
+	struct ScannedToken
+	{
+		int Type;		// -1 at the end of the source
+		size_t Length;	// in characters
+		float Float;	// FloatLiteral
+		int Int;		// IntegerLiteral and BooleanLiteral
+	};
+
+	// decimal (1, 1.5, .5, 1e-3, 2.0f) or hex (0x1F) literal at str, false if there is none
+	constexpr bool ScanNumber(const char* str, const char* end, ScannedToken& out)
+	{
+		const char* pos = str;
+
+		// integer values wrap to 32 bits, values that don't fit into 64 bits saturate
+		auto accumulate = [](unsigned long long value, int base, int digit) {
+			if (value > (0x7FFFFFFFFFFFFFFFull - digit) / base)
+				return 0x7FFFFFFFFFFFFFFFull;
+			return value * base + digit;
+		};
+
+		if (end - pos > 2 && pos[0] == '0' && pos[1] == 'x' && GetHexDigit(pos[2]) >= 0) {
+			unsigned long long value = 0;
+			for (pos += 2; pos != end && GetHexDigit(*pos) >= 0; pos++)
+				value = accumulate(value, 16, GetHexDigit(*pos));
+			if (pos == end || IsNumberEnd(*pos)) {
+				out.Type = TokenType_IntegerLiteral;
+				out.Length = pos - str;
+				out.Int = (int)(unsigned int)value;
+				return true;
+			}
+			pos = str;
+		}
+
+		unsigned long long integer = 0;
+		for (; pos != end && IsDigit(*pos); pos++)
+			integer = accumulate(integer, 10, *pos - '0');
+		const char* integerEnd = pos;
+		int fraction = 0;
+		if (pos != end && *pos == '.')
+			for (pos++; pos != end && IsDigit(*pos); pos++)
+				fraction++;
+		const char* digitsEnd = pos;
+		if (integerEnd == str && fraction == 0)
+			return false;
+
+		int exponent = 0;
+		if (pos != end && (*pos == 'e' || *pos == 'E')) {
+			const char* exp = pos + 1;
+			bool isNegative = exp != end && *exp == '-';
+			if (exp != end && (*exp == '+' || *exp == '-'))
+				exp++;
+			if (exp != end && IsDigit(*exp)) {
+				for (; exp != end && IsDigit(*exp); exp++)
+					if (exponent < 100000)
+						exponent = exponent * 10 + (*exp - '0');
+				if (isNegative)
+					exponent = -exponent;
+				pos = exp;
+			}
+		}
+		if (pos != end && *pos == 'f')
+			pos++;
+
+		if (pos != integerEnd && (pos == end || IsNumberEnd(*pos))) {
+			out.Type = TokenType_FloatLiteral;
+			out.Length = pos - str;
+			out.Float = DecimalToFloat(str, digitsEnd, exponent - fraction);
+			return true;
+		}
+
+		// "2.xy" - the integer in front of a member access
+		if (integerEnd != str && (integerEnd == end || IsNumberEnd(*integerEnd))) {
+			out.Type = TokenType_IntegerLiteral;
+			out.Length = integerEnd - str;
+			out.Int = (int)(unsigned int)integer;
+			return true;
+		}
+		return false;
+	}
+
+	// token at str, white space in front of it has to be skipped already - shared by Tokenizer
+	// and StaticParser so that both read the same source the same way
+	constexpr ScannedToken ScanToken(const char* str, const char* end)
+	{
+		ScannedToken ret = { -1, 0, 0.0f, 0 };
+		if (str == end || *str == 0)
+			return ret;
+
+		if (end - str >= 2) {
+			int op = GetTwoCharOperator(str[0], str[1]);
+			if (op != 0) {
+				ret.Type = op;
+				ret.Length = 2;
+				return ret;
+			}
+		}
+
+		if (ScanNumber(str, end, ret))
+			return ret;
+
+		if (IsSymbol(str[0])) {
+			ret.Type = str[0];
+			ret.Length = 1;
+			return ret;
+		}
+
+		const char* pos = str;
+		while (pos != end && *pos != 0 && !IsSpace(*pos) && !IsSymbol(*pos))
+			pos++;
+		ret.Length = pos - str;
+
+		if (IsWord(str, ret.Length, "true") || IsWord(str, ret.Length, "false")) {
+			ret.Type = TokenType_BooleanLiteral;
+			ret.Int = str[0] == 't';
+			ret.Float = (float)ret.Int;
+		} else
+			ret.Type = FindKeyword(str, ret.Length);
+		return ret;
+	}
+}
\ No newline at end of file
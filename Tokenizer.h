@@ -1,5 +1,5 @@
 #pragma once
-#include <unordered_map>
+#include <stddef.h>
 
 namespace expr
 {
@@ -58,14 +58,14 @@ namespace expr
 
         inline const char* GetIdentifier() { return m_curIdentifier; }
 
+        // byte offsets: where the current token starts and where the previous one ended
+        inline size_t GetTokenStart() { return m_curStart; }
+        inline size_t GetPreviousEnd() { return m_prevEnd; }
+
     private:
-        bool m_isSymbol(char c);
-        bool m_isValidNumberEnd(char c);
-        bool m_readNumber();
+        bool m_readToken();
 
 	private:
-        std::unordered_map<const char*, TokenType> m_keywords;
-
         char m_curIdentifier[256];
         int m_curType;
 
@@ -73,6 +73,10 @@ namespace expr
 		int m_prevType;
 		const char* m_tokenStart;
 
+        const char* m_bufferStart;
+        size_t m_curStart, m_curEnd, m_prevEnd;
+        size_t m_prevStart, m_prevPrevEnd;
+
         float m_floatValue;
         int m_intValue;
 
@@ -0,0 +1,336 @@
+#include "Value.h"
+#include "Operations.h"
+#include <string.h>
+
+namespace expr
+{
+	Value MakeFloat(float val)
+	{
+		Value ret;
+		ret.Type = ValueType::Float;
+		ret.Float[0] = val;
+		return ret;
+	}
+	Value MakeInt(int val)
+	{
+		Value ret;
+		ret.Type = ValueType::Int;
+		ret.Int[0] = val;
+		return ret;
+	}
+	Value MakeUint(unsigned int val)
+	{
+		Value ret;
+		ret.Type = ValueType::Uint;
+		ret.Uint[0] = val;
+		return ret;
+	}
+	Value MakeBool(bool val)
+	{
+		Value ret;
+		ret.Type = ValueType::Bool;
+		ret.Bool[0] = val;
+		return ret;
+	}
+
+	static void m_copyComponent(Value& dst, int dstIndex, const Value& src, int srcIndex)
+	{
+		if (GetBaseType(src.Type) == ValueType::Bool)
+			dst.Bool[dstIndex] = src.Bool[srcIndex];
+		else
+			dst.Uint[dstIndex] = src.Uint[srcIndex];
+	}
+
+	template<typename To>
+	static void m_convertTo(const Value& val, To* out, int count)
+	{
+		switch (GetBaseType(val.Type)) {
+		case ValueType::Float: ConvertKernel<float, To>(val.Float, out, count); break;
+		case ValueType::Int: ConvertKernel<int, To>(val.Int, out, count); break;
+		case ValueType::Uint: ConvertKernel<unsigned int, To>(val.Uint, out, count); break;
+		case ValueType::Bool: ConvertKernel<bool, To>(val.Bool, out, count); break;
+		default: break;
+		}
+	}
+	bool ConvertValue(const Value& val, ValueType baseType, Value& out)
+	{
+		if (IsMatrix(val.Type) && baseType != ValueType::Float)
+			return false;
+
+		int count = GetComponentCount(val.Type);
+		Value tmp; // val and out might alias
+
+		tmp.Type = GetSameShape(val.Type, baseType);
+		switch (baseType) {
+		case ValueType::Float: m_convertTo<float>(val, tmp.Float, count); break;
+		case ValueType::Int: m_convertTo<int>(val, tmp.Int, count); break;
+		case ValueType::Uint: m_convertTo<unsigned int>(val, tmp.Uint, count); break;
+		case ValueType::Bool: m_convertTo<bool>(val, tmp.Bool, count); break;
+		default: return false;
+		}
+
+		out = tmp;
+		return true;
+	}
+	bool ConstructValue(ValueType type, const Value* args, int argCount, Value& out)
+	{
+		ValueType base = GetBaseType(type);
+		int total = GetComponentCount(type);
+		Value ret, conv;
+		ret.Type = type;
+
+		if (argCount == 0)
+			return false;
+
+		if (IsMatrix(type) && argCount == 1) {
+			if (IsScalar(args[0].Type)) {
+				if (!ConvertValue(args[0], ValueType::Float, conv))
+					return false;
+				int rows = GetRowCount(type);
+				for (int c = 0; c < GetColumnCount(type); c++)
+					for (int r = 0; r < rows; r++)
+						ret.Float[c * rows + r] = (c == r) ? conv.Float[0] : 0.0f;
+				out = ret;
+				return true;
+			} else if (IsMatrix(args[0].Type)) {
+				int rows = GetRowCount(type), srcRows = GetRowCount(args[0].Type);
+				for (int c = 0; c < GetColumnCount(type); c++)
+					for (int r = 0; r < rows; r++) {
+						if (c < GetColumnCount(args[0].Type) && r < srcRows)
+							ret.Float[c * rows + r] = args[0].Float[c * srcRows + r];
+						else
+							ret.Float[c * rows + r] = (c == r) ? 1.0f : 0.0f;
+					}
+				out = ret;
+				return true;
+			}
+		}
+
+		int cur = 0;
+		for (int i = 0; i < argCount && cur < total; i++) {
+			if (!ConvertValue(args[i], base, conv))
+				return false;
+			int count = GetComponentCount(conv.Type);
+			for (int j = 0; j < count && cur < total; j++)
+				m_copyComponent(ret, cur++, conv, j);
+		}
+
+		// same as the SPIR-V compiler: repeat the last component
+		for (; cur < total; cur++)
+			m_copyComponent(ret, cur, ret, cur - 1);
+
+		out = ret;
+		return true;
+	}
+
+	bool ApplyCast(ValueType type, const Value& val, Value& out)
+	{
+		// scalar casts only change the base type, just like in the SPIR-V compiler
+		if (IsScalar(type))
+			return ConvertValue(val, type, out);
+		return ConstructValue(type, &val, 1, out);
+	}
+
+	template<int Op>
+	static bool m_unary(const Value& val, Value& out)
+	{
+		int count = GetComponentCount(val.Type);
+		switch (GetBaseType(val.Type)) {
+		case ValueType::Float: ApplyUnaryKernel<Op, float>(val.Float, out.Float, count); break;
+		case ValueType::Int: ApplyUnaryKernel<Op, int>(val.Int, out.Int, count); break;
+		case ValueType::Uint: ApplyUnaryKernel<Op, unsigned int>(val.Uint, out.Uint, count); break;
+		case ValueType::Bool: ApplyUnaryKernel<Op, bool>(val.Bool, out.Bool, count); break;
+		default: return false;
+		}
+		return true;
+	}
+	bool ApplyUnary(int op, bool isPost, const Value& val, Value& out)
+	{
+		ValueType resType;
+		if (!ResolveUnaryType(op, val.Type, resType))
+			return false;
+
+		Value src;
+		if (!ConvertValue(val, GetBaseType(resType), src))
+			return false;
+
+		// post increment/decrement evaluate to the old value
+		if (isPost && (op == TokenType_Increment || op == TokenType_Decrement)) {
+			out = src;
+			return true;
+		}
+
+		Value ret;
+		ret.Type = resType;
+		bool success = false;
+		switch (op) {
+		case '+': success = m_unary<'+'>(src, ret); break;
+		case '-': success = m_unary<'-'>(src, ret); break;
+		case '!': success = m_unary<'!'>(src, ret); break;
+		case '~': success = m_unary<'~'>(src, ret); break;
+		case TokenType_Increment: success = m_unary<TokenType_Increment>(src, ret); break;
+		case TokenType_Decrement: success = m_unary<TokenType_Decrement>(src, ret); break;
+		}
+
+		if (success)
+			out = ret;
+		return success;
+	}
+
+	template<int Op>
+	static bool m_binary(ValueType base, const Value& a, int aStep, const Value& b, int bStep, Value& out, int count)
+	{
+		typedef BinaryOperation<Op> Operation;
+		switch (base) {
+		case ValueType::Float: ApplyBinaryKernel<Op, float>(a.Float, aStep, b.Float, bStep, GetData<typename Operation::template Result<float>>(out), count); break;
+		case ValueType::Int: ApplyBinaryKernel<Op, int>(a.Int, aStep, b.Int, bStep, GetData<typename Operation::template Result<int>>(out), count); break;
+		case ValueType::Uint: ApplyBinaryKernel<Op, unsigned int>(a.Uint, aStep, b.Uint, bStep, GetData<typename Operation::template Result<unsigned int>>(out), count); break;
+		case ValueType::Bool: ApplyBinaryKernel<Op, bool>(a.Bool, aStep, b.Bool, bStep, GetData<typename Operation::template Result<bool>>(out), count); break;
+		default: return false;
+		}
+		return true;
+	}
+	bool ApplyBinary(int op, const Value& left, const Value& right, Value& out)
+	{
+		ValueType opBase, resType;
+		if (!ResolveBinaryType(op, left.Type, right.Type, opBase, resType))
+			return false;
+
+		Value a, b, ret;
+		ConvertValue(left, opBase, a);
+		ConvertValue(right, opBase, b);
+		ret.Type = resType;
+
+		// matrix products
+		if (op == '*' && (IsMatrix(a.Type) || IsMatrix(b.Type)) && !IsScalar(a.Type) && !IsScalar(b.Type)) {
+			if (IsMatrix(a.Type) && IsMatrix(b.Type))
+				MatrixTimesMatrix(a.Float, GetColumnCount(a.Type), GetRowCount(a.Type), b.Float, GetColumnCount(b.Type), ret.Float);
+			else if (IsMatrix(a.Type))
+				MatrixTimesVector(a.Float, GetColumnCount(a.Type), GetRowCount(a.Type), b.Float, ret.Float);
+			else
+				VectorTimesMatrix(a.Float, b.Float, GetColumnCount(b.Type), GetRowCount(b.Type), ret.Float);
+
+			out = ret;
+			return true;
+		}
+
+		int count = GetComponentCount(resType);
+		int aStep = IsScalar(a.Type) ? 0 : 1;
+		int bStep = IsScalar(b.Type) ? 0 : 1;
+		bool success = false;
+
+		switch (op) {
+		case '+': success = m_binary<'+'>(opBase, a, aStep, b, bStep, ret, count); break;
+		case '-': success = m_binary<'-'>(opBase, a, aStep, b, bStep, ret, count); break;
+		case '*': success = m_binary<'*'>(opBase, a, aStep, b, bStep, ret, count); break;
+		case '/': success = m_binary<'/'>(opBase, a, aStep, b, bStep, ret, count); break;
+		case '%': success = m_binary<'%'>(opBase, a, aStep, b, bStep, ret, count); break;
+		case '&': success = m_binary<'&'>(opBase, a, aStep, b, bStep, ret, count); break;
+		case '|': success = m_binary<'|'>(opBase, a, aStep, b, bStep, ret, count); break;
+		case '^': success = m_binary<'^'>(opBase, a, aStep, b, bStep, ret, count); break;
+		case '<': success = m_binary<'<'>(opBase, a, aStep, b, bStep, ret, count); break;
+		case '>': success = m_binary<'>'>(opBase, a, aStep, b, bStep, ret, count); break;
+		case TokenType_BitshiftLeft: success = m_binary<TokenType_BitshiftLeft>(opBase, a, aStep, b, bStep, ret, count); break;
+		case TokenType_BitshiftRight: success = m_binary<TokenType_BitshiftRight>(opBase, a, aStep, b, bStep, ret, count); break;
+		case TokenType_LogicAnd: success = m_binary<TokenType_LogicAnd>(opBase, a, aStep, b, bStep, ret, count); break;
+		case TokenType_LogicOr: success = m_binary<TokenType_LogicOr>(opBase, a, aStep, b, bStep, ret, count); break;
+		case TokenType_LessThanEqual: success = m_binary<TokenType_LessThanEqual>(opBase, a, aStep, b, bStep, ret, count); break;
+		case TokenType_GreaterThanEqual: success = m_binary<TokenType_GreaterThanEqual>(opBase, a, aStep, b, bStep, ret, count); break;
+		case TokenType_Equal: success = m_binary<TokenType_Equal>(opBase, a, aStep, b, bStep, ret, count); break;
+		case TokenType_NotEqual: success = m_binary<TokenType_NotEqual>(opBase, a, aStep, b, bStep, ret, count); break;
+		}
+
+		if (success)
+			out = ret;
+		return success;
+	}
+
+	int GetSwizzleIndices(const char* field, int* indices)
+	{
+		int len = 0;
+		for (; field[len] != 0; len++) {
+			if (len == 4)
+				return 0;
+
+			switch (field[len]) {
+			case 'x': case 'r': case 's': indices[len] = 0; break;
+			case 'y': case 'g': case 't': indices[len] = 1; break;
+			case 'z': case 'b': case 'p': indices[len] = 2; break;
+			case 'w': case 'a': case 'q': indices[len] = 3; break;
+			default: return 0;
+			}
+		}
+
+		return len;
+	}
+	bool ApplySwizzle(const Value& val, const int* indices, int count, Value& out)
+	{
+		if (IsMatrix(val.Type) || count == 0)
+			return false;
+
+		Value ret;
+		ret.Type = GetVectorType(GetBaseType(val.Type), count);
+		for (int i = 0; i < count; i++) {
+			if (indices[i] >= GetRowCount(val.Type))
+				return false;
+			m_copyComponent(ret, i, val, indices[i]);
+		}
+
+		out = ret;
+		return true;
+	}
+	bool ApplyIndex(const Value& val, const Value& index, Value& out)
+	{
+		ValueType indexBase = GetBaseType(index.Type);
+		if (!IsScalar(index.Type) || (indexBase != ValueType::Int && indexBase != ValueType::Uint) || IsScalar(val.Type))
+			return false;
+
+		// out of range reads return 0 just like robust buffer access - negative indices are huge
+		unsigned int i = index.Uint[0];
+		Value ret;
+		if (IsMatrix(val.Type)) {
+			int rows = GetRowCount(val.Type);
+			bool isInRange = i < (unsigned int)GetColumnCount(val.Type);
+			ret.Type = GetVectorType(ValueType::Float, rows);
+			for (int r = 0; r < rows; r++)
+				ret.Float[r] = isInRange ? val.Float[i * rows + r] : 0.0f;
+		} else {
+			ret.Type = GetBaseType(val.Type);
+			if (i < (unsigned int)GetRowCount(val.Type))
+				m_copyComponent(ret, 0, val, i);
+		}
+
+		out = ret;
+		return true;
+	}
+	bool ApplySelect(const Value& condition, const Value& onTrue, const Value& onFalse, Value& out)
+	{
+		if (GetBaseType(condition.Type) != ValueType::Bool)
+			return false;
+
+		Value a = onTrue, b = onFalse;
+		if (a.Type != b.Type) {
+			ValueType opBase, resType;
+			if (!ResolveBinaryType('+', a.Type, b.Type, opBase, resType) || IsScalar(a.Type) != IsScalar(b.Type))
+				return false;
+			ConvertValue(a, opBase, a);
+			ConvertValue(b, opBase, b);
+		}
+
+		if (IsScalar(condition.Type)) {
+			out = condition.Bool[0] ? a : b;
+			return true;
+		}
+
+		if (IsMatrix(a.Type) || GetRowCount(condition.Type) != GetRowCount(a.Type))
+			return false;
+
+		Value ret;
+		ret.Type = a.Type;
+		for (int i = 0; i < GetRowCount(a.Type); i++)
+			m_copyComponent(ret, i, condition.Bool[i] ? a : b, i);
+
+		out = ret;
+		return true;
+	}
+}
\ No newline at end of file
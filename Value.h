@@ -0,0 +1,213 @@
+#pragma once
+#include "Node.h"
+#include "Syntax.h"
+
+namespace expr
+{
+	// Value of any ValueType - matrices are stored column major and FloatCxR
+	// types have C columns with R components each (GLSL's matCxR)
+	struct Value
+	{
+		Value() { Type = ValueType::Float; for (int i = 0; i < 16; i++) Uint[i] = 0; }
+
+		ValueType Type;
+		union {
+			float Float[16];
+			int Int[16];
+			unsigned int Uint[16];
+			bool Bool[16];
+		};
+	};
+
+	constexpr ValueType GetBaseType(ValueType type)
+	{
+		if (type <= ValueType::Float4x2) return ValueType::Float;
+		if (type <= ValueType::Int4) return ValueType::Int;
+		if (type <= ValueType::Uint4) return ValueType::Uint;
+		return ValueType::Bool;
+	}
+	constexpr int GetColumnCount(ValueType type)
+	{
+		switch (type) {
+		case ValueType::Float2x2: return 2;
+		case ValueType::Float3x3: return 3;
+		case ValueType::Float4x4:
+		case ValueType::Float4x3:
+		case ValueType::Float4x2: return 4;
+		default: break;
+		}
+		return 1;
+	}
+	constexpr int GetRowCount(ValueType type)
+	{
+		switch (type) {
+		case ValueType::Float2x2: return 2;
+		case ValueType::Float3x3: return 3;
+		case ValueType::Float4x4: return 4;
+		case ValueType::Float4x3: return 3;
+		case ValueType::Float4x2: return 2;
+		default: break;
+		}
+		return (int)type - (int)GetBaseType(type) + 1;
+	}
+	constexpr int GetComponentCount(ValueType type) { return GetColumnCount(type) * GetRowCount(type); }
+	constexpr bool IsMatrix(ValueType type) { return GetColumnCount(type) > 1; }
+	constexpr bool IsScalar(ValueType type) { return GetComponentCount(type) == 1; }
+	constexpr bool IsVector(ValueType type) { return !IsMatrix(type) && !IsScalar(type); }
+	constexpr ValueType GetVectorType(ValueType baseType, int compCount) { return (ValueType)((int)baseType + compCount - 1); }
+	constexpr ValueType GetSameShape(ValueType type, ValueType baseType) { return IsMatrix(type) ? type : GetVectorType(baseType, GetRowCount(type)); }
+	constexpr bool GetMatrixType(int columns, int rows, ValueType& out)
+	{
+		if (columns == 2 && rows == 2) out = ValueType::Float2x2;
+		else if (columns == 3 && rows == 3) out = ValueType::Float3x3;
+		else if (columns == 4 && rows == 4) out = ValueType::Float4x4;
+		else if (columns == 4 && rows == 3) out = ValueType::Float4x3;
+		else if (columns == 4 && rows == 2) out = ValueType::Float4x2;
+		else return false;
+		return true;
+	}
+	constexpr bool GetTokenValueType(int tokenType, ValueType& out)
+	{
+		switch (tokenType) {
+		case TokenType_Float: out = ValueType::Float; break;
+		case TokenType_Float2: out = ValueType::Float2; break;
+		case TokenType_Float3: out = ValueType::Float3; break;
+		case TokenType_Float4: out = ValueType::Float4; break;
+		case TokenType_Float2x2: out = ValueType::Float2x2; break;
+		case TokenType_Float3x3: out = ValueType::Float3x3; break;
+		case TokenType_Float4x4: out = ValueType::Float4x4; break;
+		case TokenType_Int: out = ValueType::Int; break;
+		case TokenType_Int2: out = ValueType::Int2; break;
+		case TokenType_Int3: out = ValueType::Int3; break;
+		case TokenType_Int4: out = ValueType::Int4; break;
+		case TokenType_Uint: out = ValueType::Uint; break;
+		case TokenType_Uint2: out = ValueType::Uint2; break;
+		case TokenType_Uint3: out = ValueType::Uint3; break;
+		case TokenType_Uint4: out = ValueType::Uint4; break;
+		case TokenType_Bool: out = ValueType::Bool; break;
+		case TokenType_Bool2: out = ValueType::Bool2; break;
+		case TokenType_Bool3: out = ValueType::Bool3; break;
+		case TokenType_Bool4: out = ValueType::Bool4; break;
+		default: return false;
+		}
+		return true;
+	}
+
+	template<typename T> inline T* GetData(Value& val);
+	template<> inline float* GetData<float>(Value& val) { return val.Float; }
+	template<> inline int* GetData<int>(Value& val) { return val.Int; }
+	template<> inline unsigned int* GetData<unsigned int>(Value& val) { return val.Uint; }
+	template<> inline bool* GetData<bool>(Value& val) { return val.Bool; }
+	template<typename T> inline const T* GetData(const Value& val) { return GetData<T>(const_cast<Value&>(val)); }
+
+	Value MakeFloat(float val);
+	Value MakeInt(int val);
+	Value MakeUint(unsigned int val);
+	Value MakeBool(bool val);
+
+	// bool arithmetic goes through int, just like in HLSL
+	constexpr ValueType PromoteBaseType(ValueType a, ValueType b)
+	{
+		if (a == ValueType::Float || b == ValueType::Float)
+			return ValueType::Float;
+		if (a == ValueType::Uint || b == ValueType::Uint)
+			return ValueType::Uint;
+		return ValueType::Int;
+	}
+
+	// type rules shared by every evaluator and by StaticExpression.h (hence constexpr);
+	// operandBase is the base type both sides get converted to
+	constexpr bool ResolveBinaryType(int op, ValueType left, ValueType right, ValueType& operandBase, ValueType& result)
+	{
+		ValueType lBase = GetBaseType(left), rBase = GetBaseType(right);
+		bool isLogic = op == TokenType_LogicAnd || op == TokenType_LogicOr;
+		bool isCompare = IsComparisonOperator(op);
+		bool isBitwise = IsBitwiseOperator(op);
+
+		if (isLogic)
+			operandBase = ValueType::Bool;
+		else if (isBitwise) {
+			if (lBase == ValueType::Float || rBase == ValueType::Float)
+				return false;
+			if (lBase == ValueType::Bool && rBase == ValueType::Bool && op != TokenType_BitshiftLeft && op != TokenType_BitshiftRight)
+				operandBase = ValueType::Bool;
+			else
+				operandBase = PromoteBaseType(lBase, rBase);
+		}
+		else if (isCompare && lBase == ValueType::Bool && rBase == ValueType::Bool)
+			operandBase = ValueType::Bool;
+		else if (isCompare || IsArithmeticOperator(op))
+			operandBase = PromoteBaseType(lBase, rBase);
+		else
+			return false;
+
+		// matrices
+		if (IsMatrix(left) || IsMatrix(right)) {
+			if (operandBase != ValueType::Float || !IsArithmeticOperator(op))
+				return false;
+
+			if (op == '*' && !IsScalar(left) && !IsScalar(right)) {
+				if (IsMatrix(left) && IsMatrix(right)) {
+					if (GetColumnCount(left) != GetRowCount(right))
+						return false;
+					return GetMatrixType(GetColumnCount(right), GetRowCount(left), result);
+				} else if (IsMatrix(left)) {
+					if (GetRowCount(right) != GetColumnCount(left))
+						return false;
+					result = GetVectorType(ValueType::Float, GetRowCount(left));
+				} else {
+					if (GetRowCount(left) != GetRowCount(right))
+						return false;
+					result = GetVectorType(ValueType::Float, GetColumnCount(right));
+				}
+				return true;
+			}
+
+			if (IsScalar(left)) result = right;
+			else if (IsScalar(right) || left == right) result = left;
+			else return false;
+
+			return true;
+		}
+
+		// scalars & vectors
+		int lCount = GetRowCount(left), rCount = GetRowCount(right);
+		int count = lCount;
+		if (lCount == 1) count = rCount;
+		else if (rCount != 1 && rCount != lCount) return false;
+
+		result = GetVectorType((isLogic || isCompare) ? ValueType::Bool : operandBase, count);
+		return true;
+	}
+	constexpr bool ResolveUnaryType(int op, ValueType type, ValueType& result)
+	{
+		ValueType base = GetBaseType(type);
+		switch (op) {
+		case '+': case '-':
+		case TokenType_Increment: case TokenType_Decrement:
+			result = (base == ValueType::Bool) ? GetVectorType(ValueType::Int, GetRowCount(type)) : type;
+			return true;
+		case '!':
+			if (IsMatrix(type)) return false;
+			result = GetVectorType(ValueType::Bool, GetRowCount(type));
+			return true;
+		case '~':
+			if (base != ValueType::Int && base != ValueType::Uint) return false;
+			result = type;
+			return true;
+		}
+		return false;
+	}
+
+	bool ConvertValue(const Value& val, ValueType baseType, Value& out);
+	bool ConstructValue(ValueType type, const Value* args, int argCount, Value& out);
+	bool ApplyCast(ValueType type, const Value& val, Value& out);
+	bool ApplyUnary(int op, bool isPost, const Value& val, Value& out);
+	bool ApplyBinary(int op, const Value& left, const Value& right, Value& out);
+	bool ApplySwizzle(const Value& val, const int* indices, int count, Value& out);
+	bool ApplyIndex(const Value& val, const Value& index, Value& out);
+	bool ApplySelect(const Value& condition, const Value& onTrue, const Value& onFalse, Value& out);
+
+	// returns the number of components (1-4) and fills indices, 0 if the field isn't a valid swizzle
+	int GetSwizzleIndices(const char* field, int* indices);
+}
\ No newline at end of file
@@ -0,0 +1,715 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+#include "Arithmetic.h"
+
+// define EXPR_DISABLE_SIMD to use the portable implementation on x86 too
+#if !defined(EXPR_DISABLE_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define EXPR_VECTORMATH_SSE2
+#include <emmintrin.h>
+#if defined(__AVX__)
+#define EXPR_VECTORMATH_AVX
+#include <immintrin.h>
+#endif
+#endif
+
+namespace expr
+{
+	// HLSL/GLSL style vectors and matrices for native evaluation. Every vector lives in one
+	// 128 bit register (SSE2 when it's available), vectors with less than 4 components
+	// leave the remaining lanes unspecified. Matrices use the same layout as Value: column
+	// major, Matrix<C, R> has C columns with R components each (GLSL's matCxR)
+
+	// lane representation: bool lanes are masks (all bits set for true), the rest is stored as is
+	template<typename T> struct VectorLane
+	{
+		typedef T Type;
+		static inline T ToLane(T val) { return val; }
+		static inline T FromLane(T val) { return val; }
+	};
+	template<> struct VectorLane<bool>
+	{
+		typedef uint32_t Type;
+		static inline uint32_t ToLane(bool val) { return val ? 0xFFFFFFFFu : 0u; }
+		static inline bool FromLane(uint32_t val) { return val != 0; }
+	};
+
+	// division, modulo and shifts share their edge cases with the evaluators, see Arithmetic.h
+
+	// result of the portable comparisons, shared by all lane types like __m128i is with SSE2
+	struct VectorMask { uint32_t Lanes[4]; };
+
+	// operations on all 4 lanes of a register - Vector and Matrix are built on top of these
+	template<typename T> struct VectorLanes
+	{
+		typedef typename VectorLane<T>::Type Lane;
+		struct Register { Lane Lanes[4]; };
+		typedef VectorMask Mask;
+
+		template<typename F> static inline Register m_map(Register a, Register b, F func)
+		{
+			Register ret;
+			for (int i = 0; i < 4; i++) ret.Lanes[i] = func(a.Lanes[i], b.Lanes[i]);
+			return ret;
+		}
+		template<typename F> static inline Mask m_compare(Register a, Register b, F func)
+		{
+			Mask ret;
+			for (int i = 0; i < 4; i++) ret.Lanes[i] = func(a.Lanes[i], b.Lanes[i]) ? 0xFFFFFFFFu : 0u;
+			return ret;
+		}
+
+		static inline Register Splat(Lane x) { return { { x, x, x, x } }; }
+		static inline Register Set(Lane x, Lane y, Lane z, Lane w) { return { { x, y, z, w } }; }
+
+		static inline Register Add(Register a, Register b) { return m_map(a, b, [](Lane x, Lane y) { return Lane(x + y); }); }
+		static inline Register Sub(Register a, Register b) { return m_map(a, b, [](Lane x, Lane y) { return Lane(x - y); }); }
+		static inline Register Mul(Register a, Register b) { return m_map(a, b, [](Lane x, Lane y) { return Lane(x * y); }); }
+		static inline Register Div(Register a, Register b) { return m_map(a, b, ScalarDivide<Lane>); }
+		static inline Register Mod(Register a, Register b) { return m_map(a, b, ScalarModulo<Lane>); }
+		static inline Register Neg(Register a) { return Sub(Splat(Lane(0)), a); }
+		static inline Register Min(Register a, Register b) { return m_map(a, b, [](Lane x, Lane y) { return y < x ? y : x; }); }
+		static inline Register Max(Register a, Register b) { return m_map(a, b, [](Lane x, Lane y) { return x < y ? y : x; }); }
+		static inline Register Abs(Register a) { return m_map(a, a, [](Lane x, Lane) { return x < Lane(0) ? Lane(-x) : x; }); }
+		static inline Register Sqrt(Register a) { return m_map(a, a, [](Lane x, Lane) { return sqrtf(x); }); }
+
+		static inline Register And(Register a, Register b) { return m_map(a, b, [](Lane x, Lane y) { return Lane(x & y); }); }
+		static inline Register Or(Register a, Register b) { return m_map(a, b, [](Lane x, Lane y) { return Lane(x | y); }); }
+		static inline Register Xor(Register a, Register b) { return m_map(a, b, [](Lane x, Lane y) { return Lane(x ^ y); }); }
+		static inline Register Not(Register a) { return m_map(a, a, [](Lane x, Lane) { return Lane(~x); }); }
+		static inline Register ShiftLeft(Register a, Register b) { return m_map(a, b, ScalarShiftLeft<Lane>); }
+		static inline Register ShiftRight(Register a, Register b) { return m_map(a, b, ScalarShiftRight<Lane>); }
+
+		static inline Mask Equal(Register a, Register b) { return m_compare(a, b, [](Lane x, Lane y) { return x == y; }); }
+		static inline Mask NotEqual(Register a, Register b) { return m_compare(a, b, [](Lane x, Lane y) { return x != y; }); }
+		static inline Mask Less(Register a, Register b) { return m_compare(a, b, [](Lane x, Lane y) { return x < y; }); }
+		static inline Mask LessEqual(Register a, Register b) { return m_compare(a, b, [](Lane x, Lane y) { return x <= y; }); }
+		static inline Mask Greater(Register a, Register b) { return m_compare(a, b, [](Lane x, Lane y) { return x > y; }); }
+		static inline Mask GreaterEqual(Register a, Register b) { return m_compare(a, b, [](Lane x, Lane y) { return x >= y; }); }
+
+		static inline Register Select(Mask mask, Register a, Register b)
+		{
+			Register ret;
+			for (int i = 0; i < 4; i++) ret.Lanes[i] = mask.Lanes[i] ? a.Lanes[i] : b.Lanes[i];
+			return ret;
+		}
+		// X and Y pick from a, Z and W from b
+		template<int X, int Y, int Z, int W> static inline Register Shuffle(Register a, Register b) { return { { a.Lanes[X], a.Lanes[Y], b.Lanes[Z], b.Lanes[W] } }; }
+		template<int X, int Y, int Z, int W> static inline Register Shuffle(Register a) { return Shuffle<X, Y, Z, W>(a, a); }
+
+		static inline void Transpose(Register& a, Register& b, Register& c, Register& d)
+		{
+			Register ta = a, tb = b, tc = c, td = d;
+			a = { { ta.Lanes[0], tb.Lanes[0], tc.Lanes[0], td.Lanes[0] } };
+			b = { { ta.Lanes[1], tb.Lanes[1], tc.Lanes[1], td.Lanes[1] } };
+			c = { { ta.Lanes[2], tb.Lanes[2], tc.Lanes[2], td.Lanes[2] } };
+			d = { { ta.Lanes[3], tb.Lanes[3], tc.Lanes[3], td.Lanes[3] } };
+		}
+		// adds up the first N lanes, in order
+		template<int N> static inline Lane Sum(Register a)
+		{
+			Lane ret = a.Lanes[0];
+			for (int i = 1; i < N; i++) ret = ret + a.Lanes[i];
+			return ret;
+		}
+		static inline Lane Get(Register a, int i) { return a.Lanes[i]; }
+		static inline int MaskBits(Mask mask)
+		{
+			int ret = 0;
+			for (int i = 0; i < 4; i++) ret |= mask.Lanes[i] ? (1 << i) : 0;
+			return ret;
+		}
+		static inline Register FromMask(Mask mask) { Register ret; for (int i = 0; i < 4; i++) ret.Lanes[i] = Lane(mask.Lanes[i]); return ret; }
+		static inline Mask ToMask(Register a) { Mask ret; for (int i = 0; i < 4; i++) ret.Lanes[i] = uint32_t(a.Lanes[i]); return ret; }
+	};
+
+#ifdef EXPR_VECTORMATH_SSE2
+	template<> struct VectorLanes<float>
+	{
+		typedef float Lane;
+		typedef __m128 Register;
+		typedef __m128i Mask;
+
+		static inline Register Splat(float x) { return _mm_set1_ps(x); }
+		static inline Register Set(float x, float y, float z, float w) { return _mm_setr_ps(x, y, z, w); }
+
+		static inline Register Add(Register a, Register b) { return _mm_add_ps(a, b); }
+		static inline Register Sub(Register a, Register b) { return _mm_sub_ps(a, b); }
+		static inline Register Mul(Register a, Register b) { return _mm_mul_ps(a, b); }
+		static inline Register Div(Register a, Register b) { return _mm_div_ps(a, b); }
+		static inline Register Mod(Register a, Register b)
+		{
+			// SSE2 has no floor
+			alignas(16) float x[4], y[4];
+			_mm_store_ps(x, a);
+			_mm_store_ps(y, b);
+			for (int i = 0; i < 4; i++) x[i] = ScalarModulo(x[i], y[i]);
+			return _mm_load_ps(x);
+		}
+		static inline Register Neg(Register a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+		static inline Register Min(Register a, Register b) { return _mm_min_ps(a, b); }
+		static inline Register Max(Register a, Register b) { return _mm_max_ps(a, b); }
+		static inline Register Abs(Register a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+		static inline Register Sqrt(Register a) { return _mm_sqrt_ps(a); }
+
+		static inline Mask Equal(Register a, Register b) { return _mm_castps_si128(_mm_cmpeq_ps(a, b)); }
+		static inline Mask NotEqual(Register a, Register b) { return _mm_castps_si128(_mm_cmpneq_ps(a, b)); }
+		static inline Mask Less(Register a, Register b) { return _mm_castps_si128(_mm_cmplt_ps(a, b)); }
+		static inline Mask LessEqual(Register a, Register b) { return _mm_castps_si128(_mm_cmple_ps(a, b)); }
+		static inline Mask Greater(Register a, Register b) { return _mm_castps_si128(_mm_cmpgt_ps(a, b)); }
+		static inline Mask GreaterEqual(Register a, Register b) { return _mm_castps_si128(_mm_cmpge_ps(a, b)); }
+
+		static inline Register Select(Mask mask, Register a, Register b)
+		{
+			__m128 m = _mm_castsi128_ps(mask);
+			return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+		}
+		template<int X, int Y, int Z, int W> static inline Register Shuffle(Register a, Register b) { return _mm_shuffle_ps(a, b, _MM_SHUFFLE(W, Z, Y, X)); }
+		template<int X, int Y, int Z, int W> static inline Register Shuffle(Register a) { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(W, Z, Y, X)); }
+
+		static inline void Transpose(Register& a, Register& b, Register& c, Register& d) { _MM_TRANSPOSE4_PS(a, b, c, d); }
+		template<int N> static inline float Sum(Register a)
+		{
+			__m128 ret = a;
+			if constexpr (N > 1) ret = _mm_add_ss(ret, Shuffle<1, 1, 1, 1>(a));
+			if constexpr (N > 2) ret = _mm_add_ss(ret, Shuffle<2, 2, 2, 2>(a));
+			if constexpr (N > 3) ret = _mm_add_ss(ret, Shuffle<3, 3, 3, 3>(a));
+			return _mm_cvtss_f32(ret);
+		}
+		static inline float Get(Register a, int i) { alignas(16) float x[4]; _mm_store_ps(x, a); return x[i]; }
+		static inline int MaskBits(Mask mask) { return _mm_movemask_ps(_mm_castsi128_ps(mask)); }
+	};
+
+	// int and unsigned int share everything but the comparisons, shifts and division
+	template<typename T> struct m_IntegerLanes
+	{
+		typedef T Lane;
+		typedef __m128i Register;
+		typedef __m128i Mask;
+
+		static inline Register Splat(T x) { return _mm_set1_epi32((int)x); }
+		static inline Register Set(T x, T y, T z, T w) { return _mm_setr_epi32((int)x, (int)y, (int)z, (int)w); }
+
+		static inline Register Add(Register a, Register b) { return _mm_add_epi32(a, b); }
+		static inline Register Sub(Register a, Register b) { return _mm_sub_epi32(a, b); }
+		static inline Register Mul(Register a, Register b)
+		{
+			// no 32 bit mullo in SSE2 - multiply the even and the odd lanes separately, the low halves are the same for both signs
+			__m128i even = _mm_mul_epu32(a, b);
+			__m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+			return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+		}
+		template<T(*Func)(T, T)> static inline Register m_perLane(Register a, Register b)
+		{
+			alignas(16) T x[4], y[4];
+			_mm_store_si128((__m128i*)x, a);
+			_mm_store_si128((__m128i*)y, b);
+			for (int i = 0; i < 4; i++) x[i] = Func(x[i], y[i]);
+			return _mm_load_si128((const __m128i*)x);
+		}
+
+		// no integer division in SSE at all
+		static inline Register Div(Register a, Register b) { return m_perLane<ScalarDivide<T>>(a, b); }
+		static inline Register Mod(Register a, Register b) { return m_perLane<ScalarModulo<T>>(a, b); }
+		static inline Register Neg(Register a) { return _mm_sub_epi32(_mm_setzero_si128(), a); }
+		static inline Register Min(Register a, Register b) { return Select(Less(b, a), b, a); }
+		static inline Register Max(Register a, Register b) { return Select(Less(a, b), b, a); }
+		static inline Register Abs(Register a)
+		{
+			if constexpr (std::is_signed<T>::value) {
+				__m128i sign = _mm_srai_epi32(a, 31);
+				return _mm_sub_epi32(_mm_xor_si128(a, sign), sign);
+			} else
+				return a;
+		}
+
+		static inline Register And(Register a, Register b) { return _mm_and_si128(a, b); }
+		static inline Register Or(Register a, Register b) { return _mm_or_si128(a, b); }
+		static inline Register Xor(Register a, Register b) { return _mm_xor_si128(a, b); }
+		static inline Register Not(Register a) { return _mm_xor_si128(a, _mm_set1_epi32(-1)); }
+		static inline Register ShiftLeft(Register a, Register b)
+		{
+#ifdef __AVX2__
+			// the variable shifts give 0 / sign fill for large counts, mask them like ScalarShiftLeft
+			return _mm_sllv_epi32(a, _mm_and_si128(b, _mm_set1_epi32(31)));
+#else
+			return m_perLane<ScalarShiftLeft<T>>(a, b);
+#endif
+		}
+		static inline Register ShiftRight(Register a, Register b)
+		{
+#ifdef __AVX2__
+			__m128i count = _mm_and_si128(b, _mm_set1_epi32(31));
+			if constexpr (std::is_signed<T>::value) return _mm_srav_epi32(a, count);
+			else return _mm_srlv_epi32(a, count);
+#else
+			return m_perLane<ScalarShiftRight<T>>(a, b);
+#endif
+		}
+
+		// SSE2 only compares signed integers, flipping the sign bit maps unsigned order onto it
+		static inline Register m_signed(Register a)
+		{
+			if constexpr (std::is_signed<T>::value) return a;
+			else return _mm_xor_si128(a, _mm_set1_epi32((int)0x80000000));
+		}
+		static inline Mask Equal(Register a, Register b) { return _mm_cmpeq_epi32(a, b); }
+		static inline Mask NotEqual(Register a, Register b) { return Not(Equal(a, b)); }
+		static inline Mask Less(Register a, Register b) { return _mm_cmplt_epi32(m_signed(a), m_signed(b)); }
+		static inline Mask LessEqual(Register a, Register b) { return Not(Greater(a, b)); }
+		static inline Mask Greater(Register a, Register b) { return _mm_cmpgt_epi32(m_signed(a), m_signed(b)); }
+		static inline Mask GreaterEqual(Register a, Register b) { return Not(Less(a, b)); }
+
+		static inline Register Select(Mask mask, Register a, Register b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+		template<int X, int Y, int Z, int W> static inline Register Shuffle(Register a, Register b)
+		{
+			return _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(W, Z, Y, X)));
+		}
+		template<int X, int Y, int Z, int W> static inline Register Shuffle(Register a) { return _mm_shuffle_epi32(a, _MM_SHUFFLE(W, Z, Y, X)); }
+
+		template<int N> static inline T Sum(Register a)
+		{
+			alignas(16) T x[4];
+			_mm_store_si128((__m128i*)x, a);
+			T ret = x[0];
+			for (int i = 1; i < N; i++) ret += x[i];
+			return ret;
+		}
+		static inline T Get(Register a, int i) { alignas(16) T x[4]; _mm_store_si128((__m128i*)x, a); return x[i]; }
+		static inline int MaskBits(Mask mask) { return _mm_movemask_ps(_mm_castsi128_ps(mask)); }
+	};
+	template<> struct VectorLanes<int> : m_IntegerLanes<int> { };
+	template<> struct VectorLanes<unsigned int> : m_IntegerLanes<unsigned int> { };
+
+	// bool lanes are the masks that the comparisons return
+	template<> struct VectorLanes<bool>
+	{
+		typedef uint32_t Lane;
+		typedef __m128i Register;
+		typedef __m128i Mask;
+
+		static inline Register Splat(uint32_t x) { return _mm_set1_epi32((int)x); }
+		static inline Register Set(uint32_t x, uint32_t y, uint32_t z, uint32_t w) { return _mm_setr_epi32((int)x, (int)y, (int)z, (int)w); }
+
+		static inline Register And(Register a, Register b) { return _mm_and_si128(a, b); }
+		static inline Register Or(Register a, Register b) { return _mm_or_si128(a, b); }
+		static inline Register Xor(Register a, Register b) { return _mm_xor_si128(a, b); }
+		static inline Register Not(Register a) { return _mm_xor_si128(a, _mm_set1_epi32(-1)); }
+
+		static inline Mask Equal(Register a, Register b) { return _mm_cmpeq_epi32(a, b); }
+		static inline Mask NotEqual(Register a, Register b) { return _mm_xor_si128(a, b); }
+
+		static inline Register Select(Mask mask, Register a, Register b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+		template<int X, int Y, int Z, int W> static inline Register Shuffle(Register a) { return _mm_shuffle_epi32(a, _MM_SHUFFLE(W, Z, Y, X)); }
+
+		static inline uint32_t Get(Register a, int i) { alignas(16) uint32_t x[4]; _mm_store_si128((__m128i*)x, a); return x[i]; }
+		static inline int MaskBits(Mask mask) { return _mm_movemask_ps(_mm_castsi128_ps(mask)); }
+		static inline Register FromMask(Mask mask) { return mask; }
+		static inline Mask ToMask(Register a) { return a; }
+	};
+#endif
+
+	template<typename T, int N>
+	struct Vector
+	{
+		static_assert(N >= 1 && N <= 4, "vectors have 1 to 4 components");
+
+		typedef VectorLanes<T> Lanes;
+		typedef typename Lanes::Register Register;
+
+		Register Simd;
+
+		Vector() : Simd(Lanes::Splat(typename Lanes::Lane(0))) { }
+		explicit Vector(T val) : Simd(Lanes::Splat(VectorLane<T>::ToLane(val))) { }
+		explicit Vector(Register reg) : Simd(reg) { }
+		template<typename... Args>
+		Vector(T x, T y, Args... rest) : Simd(m_set(x, y, T(rest)...))
+		{
+			static_assert(sizeof...(Args) + 2 == N, "wrong number of components");
+		}
+
+		// reads/writes N components - works directly on Value::Float, Value::Int, ...
+		static inline Vector Load(const T* data)
+		{
+#ifdef EXPR_VECTORMATH_SSE2
+			if constexpr (N == 4 && std::is_same<T, float>::value)
+				return Vector(Register(_mm_loadu_ps(data)));
+			else if constexpr (N == 4 && std::is_integral<T>::value && sizeof(T) == 4)
+				return Vector(Register(_mm_loadu_si128((const __m128i*)data)));
+			else
+#endif
+			{
+				Vector ret;
+				for (int i = 0; i < N; i++)
+					ret.Set(i, data[i]);
+				return ret;
+			}
+		}
+		inline void Store(T* out) const
+		{
+#ifdef EXPR_VECTORMATH_SSE2
+			if constexpr (N == 4 && std::is_same<T, float>::value)
+				_mm_storeu_ps(out, Simd);
+			else if constexpr (N == 4 && std::is_integral<T>::value && sizeof(T) == 4)
+				_mm_storeu_si128((__m128i*)out, Simd);
+			else
+#endif
+			{
+				for (int i = 0; i < N; i++)
+					out[i] = (*this)[i];
+			}
+		}
+
+		inline T operator[](int i) const { return VectorLane<T>::FromLane(Lanes::Get(Simd, i)); }
+		inline void Set(int i, T val)
+		{
+			alignas(16) typename Lanes::Lane lanes[4];
+			for (int j = 0; j < 4; j++)
+				lanes[j] = Lanes::Get(Simd, j);
+			lanes[i] = VectorLane<T>::ToLane(val);
+			Simd = Lanes::Set(lanes[0], lanes[1], lanes[2], lanes[3]);
+		}
+
+		// v.Swizzle<2, 1, 0>() is v.zyx - the indices are checked at compile time
+		template<int... Indices>
+		inline Vector<T, sizeof...(Indices)> Swizzle() const
+		{
+			static_assert(sizeof...(Indices) >= 1 && sizeof...(Indices) <= 4, "swizzles pick 1 to 4 components");
+			static_assert(((Indices >= 0 && Indices < N) && ...), "swizzle index out of range");
+			return Vector<T, sizeof...(Indices)>(m_shuffle<Indices...>(Simd));
+		}
+
+		inline Vector& operator+=(const Vector& b) { return *this = *this + b; }
+		inline Vector& operator-=(const Vector& b) { return *this = *this - b; }
+		inline Vector& operator*=(const Vector& b) { return *this = *this * b; }
+		inline Vector& operator/=(const Vector& b) { return *this = *this / b; }
+		inline Vector& operator*=(T b) { return *this = *this * b; }
+		inline Vector& operator/=(T b) { return *this = *this / b; }
+
+	private:
+		template<typename... Args>
+		static inline Register m_set(Args... vals)
+		{
+			typename Lanes::Lane lanes[4] = { VectorLane<T>::ToLane(vals)... };
+			return Lanes::Set(lanes[0], lanes[1], lanes[2], lanes[3]);
+		}
+		template<int X, int Y = X, int Z = Y, int W = Z>
+		static inline Register m_shuffle(Register reg) { return Lanes::template Shuffle<X, Y, Z, W>(reg); }
+	};
+
+	typedef Vector<float, 2> float2;
+	typedef Vector<float, 3> float3;
+	typedef Vector<float, 4> float4;
+	typedef Vector<int, 2> int2;
+	typedef Vector<int, 3> int3;
+	typedef Vector<int, 4> int4;
+	typedef Vector<unsigned int, 2> uint2;
+	typedef Vector<unsigned int, 3> uint3;
+	typedef Vector<unsigned int, 4> uint4;
+	typedef Vector<bool, 2> bool2;
+	typedef Vector<bool, 3> bool3;
+	typedef Vector<bool, 4> bool4;
+
+	// component-wise arithmetic, scalars are broadcasted
+	template<typename T, int N> inline Vector<T, N> operator+(const Vector<T, N>& a, const Vector<T, N>& b) { return Vector<T, N>(VectorLanes<T>::Add(a.Simd, b.Simd)); }
+	template<typename T, int N> inline Vector<T, N> operator-(const Vector<T, N>& a, const Vector<T, N>& b) { return Vector<T, N>(VectorLanes<T>::Sub(a.Simd, b.Simd)); }
+	template<typename T, int N> inline Vector<T, N> operator*(const Vector<T, N>& a, const Vector<T, N>& b) { return Vector<T, N>(VectorLanes<T>::Mul(a.Simd, b.Simd)); }
+	template<typename T, int N> inline Vector<T, N> operator/(const Vector<T, N>& a, const Vector<T, N>& b) { return Vector<T, N>(VectorLanes<T>::Div(a.Simd, b.Simd)); }
+	template<typename T, int N> inline Vector<T, N> operator%(const Vector<T, N>& a, const Vector<T, N>& b) { return Vector<T, N>(VectorLanes<T>::Mod(a.Simd, b.Simd)); }
+	template<typename T, int N> inline Vector<T, N> operator-(const Vector<T, N>& a) { return Vector<T, N>(VectorLanes<T>::Neg(a.Simd)); }
+
+	template<typename T, int N> inline Vector<T, N> operator+(const Vector<T, N>& a, T b) { return a + Vector<T, N>(b); }
+	template<typename T, int N> inline Vector<T, N> operator-(const Vector<T, N>& a, T b) { return a - Vector<T, N>(b); }
+	template<typename T, int N> inline Vector<T, N> operator*(const Vector<T, N>& a, T b) { return a * Vector<T, N>(b); }
+	template<typename T, int N> inline Vector<T, N> operator/(const Vector<T, N>& a, T b) { return a / Vector<T, N>(b); }
+	template<typename T, int N> inline Vector<T, N> operator%(const Vector<T, N>& a, T b) { return a % Vector<T, N>(b); }
+	template<typename T, int N> inline Vector<T, N> operator+(T a, const Vector<T, N>& b) { return Vector<T, N>(a) + b; }
+	template<typename T, int N> inline Vector<T, N> operator-(T a, const Vector<T, N>& b) { return Vector<T, N>(a) - b; }
+	template<typename T, int N> inline Vector<T, N> operator*(T a, const Vector<T, N>& b) { return Vector<T, N>(a) * b; }
+	template<typename T, int N> inline Vector<T, N> operator/(T a, const Vector<T, N>& b) { return Vector<T, N>(a) / b; }
+	template<typename T, int N> inline Vector<T, N> operator%(T a, const Vector<T, N>& b) { return Vector<T, N>(a) % b; }
+
+	// bitwise operations, only for int and uint vectors
+	template<typename T, int N> inline Vector<T, N> operator&(const Vector<T, N>& a, const Vector<T, N>& b) { return Vector<T, N>(VectorLanes<T>::And(a.Simd, b.Simd)); }
+	template<typename T, int N> inline Vector<T, N> operator|(const Vector<T, N>& a, const Vector<T, N>& b) { return Vector<T, N>(VectorLanes<T>::Or(a.Simd, b.Simd)); }
+	template<typename T, int N> inline Vector<T, N> operator^(const Vector<T, N>& a, const Vector<T, N>& b) { return Vector<T, N>(VectorLanes<T>::Xor(a.Simd, b.Simd)); }
+	template<typename T, int N> inline Vector<T, N> operator~(const Vector<T, N>& a) { return Vector<T, N>(VectorLanes<T>::Not(a.Simd)); }
+	template<typename T, int N> inline Vector<T, N> operator<<(const Vector<T, N>& a, const Vector<T, N>& b) { return Vector<T, N>(VectorLanes<T>::ShiftLeft(a.Simd, b.Simd)); }
+	template<typename T, int N> inline Vector<T, N> operator>>(const Vector<T, N>& a, const Vector<T, N>& b) { return Vector<T, N>(VectorLanes<T>::ShiftRight(a.Simd, b.Simd)); }
+
+	// comparisons are component-wise like in HLSL, use Any()/All() to reduce them
+	template<typename T, int N> inline Vector<bool, N> m_fromMask(typename VectorLanes<T>::Mask mask) { return Vector<bool, N>(VectorLanes<bool>::FromMask(mask)); }
+	template<typename T, int N> inline Vector<bool, N> operator==(const Vector<T, N>& a, const Vector<T, N>& b) { return m_fromMask<T, N>(VectorLanes<T>::Equal(a.Simd, b.Simd)); }
+	template<typename T, int N> inline Vector<bool, N> operator!=(const Vector<T, N>& a, const Vector<T, N>& b) { return m_fromMask<T, N>(VectorLanes<T>::NotEqual(a.Simd, b.Simd)); }
+	template<typename T, int N> inline Vector<bool, N> operator<(const Vector<T, N>& a, const Vector<T, N>& b) { return m_fromMask<T, N>(VectorLanes<T>::Less(a.Simd, b.Simd)); }
+	template<typename T, int N> inline Vector<bool, N> operator<=(const Vector<T, N>& a, const Vector<T, N>& b) { return m_fromMask<T, N>(VectorLanes<T>::LessEqual(a.Simd, b.Simd)); }
+	template<typename T, int N> inline Vector<bool, N> operator>(const Vector<T, N>& a, const Vector<T, N>& b) { return m_fromMask<T, N>(VectorLanes<T>::Greater(a.Simd, b.Simd)); }
+	template<typename T, int N> inline Vector<bool, N> operator>=(const Vector<T, N>& a, const Vector<T, N>& b) { return m_fromMask<T, N>(VectorLanes<T>::GreaterEqual(a.Simd, b.Simd)); }
+
+	template<int N> inline Vector<bool, N> operator&&(const Vector<bool, N>& a, const Vector<bool, N>& b) { return Vector<bool, N>(VectorLanes<bool>::And(a.Simd, b.Simd)); }
+	template<int N> inline Vector<bool, N> operator||(const Vector<bool, N>& a, const Vector<bool, N>& b) { return Vector<bool, N>(VectorLanes<bool>::Or(a.Simd, b.Simd)); }
+	template<int N> inline Vector<bool, N> operator!(const Vector<bool, N>& a) { return Vector<bool, N>(VectorLanes<bool>::Not(a.Simd)); }
+	template<int N> inline bool Any(const Vector<bool, N>& a) { return (VectorLanes<bool>::MaskBits(VectorLanes<bool>::ToMask(a.Simd)) & ((1 << N) - 1)) != 0; }
+	template<int N> inline bool All(const Vector<bool, N>& a) { return (VectorLanes<bool>::MaskBits(VectorLanes<bool>::ToMask(a.Simd)) & ((1 << N) - 1)) == (1 << N) - 1; }
+
+	template<typename T, int N> inline Vector<T, N> Select(const Vector<bool, N>& cond, const Vector<T, N>& a, const Vector<T, N>& b)
+	{
+		typedef VectorLanes<T> Lanes;
+		return Vector<T, N>(Lanes::Select(typename Lanes::Mask(VectorLanes<bool>::ToMask(cond.Simd)), a.Simd, b.Simd));
+	}
+	template<typename T, int N> inline Vector<T, N> Min(const Vector<T, N>& a, const Vector<T, N>& b) { return Vector<T, N>(VectorLanes<T>::Min(a.Simd, b.Simd)); }
+	template<typename T, int N> inline Vector<T, N> Max(const Vector<T, N>& a, const Vector<T, N>& b) { return Vector<T, N>(VectorLanes<T>::Max(a.Simd, b.Simd)); }
+	template<typename T, int N> inline Vector<T, N> Clamp(const Vector<T, N>& x, const Vector<T, N>& lo, const Vector<T, N>& hi) { return Min(Max(x, lo), hi); }
+	template<typename T, int N> inline Vector<T, N> Abs(const Vector<T, N>& a) { return Vector<T, N>(VectorLanes<T>::Abs(a.Simd)); }
+	template<int N> inline Vector<float, N> Sqrt(const Vector<float, N>& a) { return Vector<float, N>(VectorLanes<float>::Sqrt(a.Simd)); }
+	template<int N> inline Vector<float, N> Lerp(const Vector<float, N>& a, const Vector<float, N>& b, float t) { return a + (b - a) * t; }
+
+	template<typename T, int N> inline T Dot(const Vector<T, N>& a, const Vector<T, N>& b) { return VectorLanes<T>::template Sum<N>(VectorLanes<T>::Mul(a.Simd, b.Simd)); }
+	template<typename T> inline Vector<T, 3> Cross(const Vector<T, 3>& a, const Vector<T, 3>& b)
+	{
+		typedef VectorLanes<T> Lanes;
+		typename Lanes::Register ret = Lanes::Sub(
+			Lanes::Mul(a.Simd, Lanes::template Shuffle<1, 2, 0, 3>(b.Simd)),
+			Lanes::Mul(Lanes::template Shuffle<1, 2, 0, 3>(a.Simd), b.Simd));
+		return Vector<T, 3>(Lanes::template Shuffle<1, 2, 0, 3>(ret));
+	}
+	template<int N> inline float Length(const Vector<float, N>& a) { return sqrtf(Dot(a, a)); }
+	template<int N> inline float Distance(const Vector<float, N>& a, const Vector<float, N>& b) { return Length(a - b); }
+	template<int N> inline Vector<float, N> Normalize(const Vector<float, N>& a) { return a / Length(a); }
+
+
+	template<int C, int R>
+	struct Matrix
+	{
+		static_assert(C >= 2 && C <= 4 && R >= 2 && R <= 4, "matrices have 2 to 4 columns and rows");
+
+		Vector<float, R> Columns[C];
+
+		Matrix() { }
+		// diagonal matrix, Matrix(1.0f) is the identity
+		explicit Matrix(float diagonal)
+		{
+			for (int c = 0; c < C; c++)
+				if (c < R)
+					Columns[c].Set(c, diagonal);
+		}
+		template<typename... Args>
+		Matrix(const Vector<float, R>& first, const Args&... rest) : Columns{ first, rest... }
+		{
+			static_assert(sizeof...(Args) + 1 == C, "wrong number of columns");
+		}
+
+		// column major C * R floats, the layout of Value::Float
+		static inline Matrix Load(const float* data)
+		{
+			Matrix ret;
+			for (int c = 0; c < C; c++)
+				ret.Columns[c] = Vector<float, R>::Load(data + c * R);
+			return ret;
+		}
+		inline void Store(float* out) const
+		{
+			for (int c = 0; c < C; c++)
+				Columns[c].Store(out + c * R);
+		}
+
+		inline Vector<float, R>& operator[](int c) { return Columns[c]; }
+		inline const Vector<float, R>& operator[](int c) const { return Columns[c]; }
+	};
+
+	typedef Matrix<2, 2> float2x2;
+	typedef Matrix<3, 3> float3x3;
+	typedef Matrix<4, 4> float4x4;
+	typedef Matrix<4, 3> float4x3;
+	typedef Matrix<4, 2> float4x2;
+
+	template<int C, int R> inline Matrix<C, R> operator+(const Matrix<C, R>& a, const Matrix<C, R>& b)
+	{
+		Matrix<C, R> ret;
+		for (int c = 0; c < C; c++) ret.Columns[c] = a.Columns[c] + b.Columns[c];
+		return ret;
+	}
+	template<int C, int R> inline Matrix<C, R> operator-(const Matrix<C, R>& a, const Matrix<C, R>& b)
+	{
+		Matrix<C, R> ret;
+		for (int c = 0; c < C; c++) ret.Columns[c] = a.Columns[c] - b.Columns[c];
+		return ret;
+	}
+	template<int C, int R> inline Matrix<C, R> operator*(const Matrix<C, R>& a, float b)
+	{
+		Matrix<C, R> ret;
+		for (int c = 0; c < C; c++) ret.Columns[c] = a.Columns[c] * b;
+		return ret;
+	}
+	template<int C, int R> inline Matrix<C, R> operator*(float a, const Matrix<C, R>& b) { return b * a; }
+	// HLSL's * between two matrices
+	template<int C, int R> inline Matrix<C, R> MatrixCompMult(const Matrix<C, R>& a, const Matrix<C, R>& b)
+	{
+		Matrix<C, R> ret;
+		for (int c = 0; c < C; c++) ret.Columns[c] = a.Columns[c] * b.Columns[c];
+		return ret;
+	}
+
+	// linear algebra products use GLSL's order: m * v treats v as a column vector, v * m as a
+	// row vector. Sums run in column order, so the results match the scalar evaluators
+	template<int C, int R, int... I>
+	inline Vector<float, R> m_matrixTimesVector(const Matrix<C, R>& m, const Vector<float, C>& v, std::integer_sequence<int, I...>)
+	{
+		typedef VectorLanes<float> Lanes;
+		typename Lanes::Register ret = Lanes::Mul(m.Columns[0].Simd, Lanes::template Shuffle<0, 0, 0, 0>(v.Simd));
+		((ret = Lanes::Add(ret, Lanes::Mul(m.Columns[I + 1].Simd, Lanes::template Shuffle<I + 1, I + 1, I + 1, I + 1>(v.Simd)))), ...);
+		return Vector<float, R>(ret);
+	}
+#ifdef EXPR_VECTORMATH_AVX
+	inline __m256 m_duplicate(__m128 a) { return _mm256_insertf128_ps(_mm256_castps128_ps256(a), a, 1); }
+	template<int K, int R, int... I>
+	inline void m_matrixTimesColumns(const Matrix<K, R>& m, const Vector<float, K>& v0, const Vector<float, K>& v1,
+		Vector<float, R>& out0, Vector<float, R>& out1, std::integer_sequence<int, I...>)
+	{
+		__m256 v = _mm256_insertf128_ps(_mm256_castps128_ps256(v0.Simd), v1.Simd, 1);
+		__m256 ret = _mm256_mul_ps(m_duplicate(m.Columns[0].Simd), _mm256_shuffle_ps(v, v, 0x00));
+		((ret = _mm256_add_ps(ret, _mm256_mul_ps(m_duplicate(m.Columns[I + 1].Simd), _mm256_shuffle_ps(v, v, (I + 1) * 0x55)))), ...);
+		out0 = Vector<float, R>(_mm256_castps256_ps128(ret));
+		out1 = Vector<float, R>(_mm256_extractf128_ps(ret, 1));
+	}
+#endif
+	template<int C, int R> inline Vector<float, R> operator*(const Matrix<C, R>& m, const Vector<float, C>& v)
+	{
+		return m_matrixTimesVector(m, v, std::make_integer_sequence<int, C - 1>());
+	}
+	template<int C, int R> inline Vector<float, C> operator*(const Vector<float, R>& v, const Matrix<C, R>& m)
+	{
+		// products of each column, transposed so that every register holds one row - then the
+		// rows are added up and each lane ends up with the dot product of one column
+		typedef VectorLanes<float> Lanes;
+		typename Lanes::Register rows[4];
+		for (int c = 0; c < 4; c++)
+			rows[c] = c < C ? Lanes::Mul(v.Simd, m.Columns[c].Simd) : Lanes::Splat(0.0f);
+		Lanes::Transpose(rows[0], rows[1], rows[2], rows[3]);
+
+		typename Lanes::Register ret = rows[0];
+		for (int r = 1; r < R; r++)
+			ret = Lanes::Add(ret, rows[r]);
+		return Vector<float, C>(ret);
+	}
+	template<int K, int R, int C> inline Matrix<C, R> operator*(const Matrix<K, R>& a, const Matrix<C, K>& b)
+	{
+		Matrix<C, R> ret;
+		int c = 0;
+#ifdef EXPR_VECTORMATH_AVX
+		// two columns of the result per instruction
+		for (; c + 1 < C; c += 2)
+			m_matrixTimesColumns(a, b.Columns[c], b.Columns[c + 1], ret.Columns[c], ret.Columns[c + 1], std::make_integer_sequence<int, K - 1>());
+#endif
+		for (; c < C; c++)
+			ret.Columns[c] = a * b.Columns[c];
+		return ret;
+	}
+
+	// HLSL's mul(): HLSL stores the same data row major (the rows of a floatRxC are our
+	// columns), which reverses the order of the operands - mul(a, b) is b * a
+	template<int C, int R> inline Vector<float, C> Mul(const Matrix<C, R>& m, const Vector<float, R>& v) { return v * m; }
+	template<int C, int R> inline Vector<float, R> Mul(const Vector<float, C>& v, const Matrix<C, R>& m) { return m * v; }
+	template<int K, int R, int C> inline Matrix<C, R> Mul(const Matrix<C, K>& a, const Matrix<K, R>& b) { return b * a; }
+	template<int N> inline float Mul(const Vector<float, N>& a, const Vector<float, N>& b) { return Dot(a, b); }
+
+	template<int C, int R> inline Matrix<R, C> Transpose(const Matrix<C, R>& m)
+	{
+		typedef VectorLanes<float> Lanes;
+		typename Lanes::Register cols[4];
+		for (int c = 0; c < 4; c++)
+			cols[c] = c < C ? m.Columns[c].Simd : Lanes::Splat(0.0f);
+		Lanes::Transpose(cols[0], cols[1], cols[2], cols[3]);
+
+		Matrix<R, C> ret;
+		for (int r = 0; r < R; r++)
+			ret.Columns[r] = Vector<float, C>(cols[r]);
+		return ret;
+	}
+
+	inline float Determinant(const float2x2& m) { return m[0][0] * m[1][1] - m[1][0] * m[0][1]; }
+	inline float Determinant(const float3x3& m) { return Dot(m[0], Cross(m[1], m[2])); }
+
+	// 2x2 matrices packed row major into one register: a * b, adj(a) * b and a * adj(b)
+	inline VectorLanes<float>::Register m_matrix2Mul(VectorLanes<float>::Register a, VectorLanes<float>::Register b)
+	{
+		typedef VectorLanes<float> Lanes;
+		return Lanes::Add(Lanes::Mul(a, Lanes::Shuffle<0, 3, 0, 3>(b)), Lanes::Mul(Lanes::Shuffle<1, 0, 3, 2>(a), Lanes::Shuffle<2, 1, 2, 1>(b)));
+	}
+	inline VectorLanes<float>::Register m_matrix2AdjMul(VectorLanes<float>::Register a, VectorLanes<float>::Register b)
+	{
+		typedef VectorLanes<float> Lanes;
+		return Lanes::Sub(Lanes::Mul(Lanes::Shuffle<3, 3, 0, 0>(a), b), Lanes::Mul(Lanes::Shuffle<1, 1, 2, 2>(a), Lanes::Shuffle<2, 3, 0, 1>(b)));
+	}
+	inline VectorLanes<float>::Register m_matrix2MulAdj(VectorLanes<float>::Register a, VectorLanes<float>::Register b)
+	{
+		typedef VectorLanes<float> Lanes;
+		return Lanes::Sub(Lanes::Mul(a, Lanes::Shuffle<3, 0, 3, 0>(b)), Lanes::Mul(Lanes::Shuffle<1, 0, 3, 2>(a), Lanes::Shuffle<2, 1, 2, 1>(b)));
+	}
+	// blockwise inversion with 2x2 sub matrices [A B; C D], out can be null when only the determinant is needed.
+	// The columns are used as rows: inverting the transpose gives the inverse in transposed form, which is what we store
+	inline float m_blockInverse(const float4x4& m, float4x4* out)
+	{
+		typedef VectorLanes<float> Lanes;
+		typedef Lanes::Register Register;
+		Register c0 = m[0].Simd, c1 = m[1].Simd, c2 = m[2].Simd, c3 = m[3].Simd;
+
+		Register a = Lanes::Shuffle<0, 1, 0, 1>(c0, c1), b = Lanes::Shuffle<2, 3, 2, 3>(c0, c1);
+		Register c = Lanes::Shuffle<0, 1, 0, 1>(c2, c3), d = Lanes::Shuffle<2, 3, 2, 3>(c2, c3);
+
+		// (|A|, |B|, |C|, |D|)
+		Register dets = Lanes::Sub(
+			Lanes::Mul(Lanes::Shuffle<0, 2, 0, 2>(c0, c2), Lanes::Shuffle<1, 3, 1, 3>(c1, c3)),
+			Lanes::Mul(Lanes::Shuffle<1, 3, 1, 3>(c0, c2), Lanes::Shuffle<0, 2, 0, 2>(c1, c3)));
+
+		Register adjDC = m_matrix2AdjMul(d, c);
+		Register adjAB = m_matrix2AdjMul(a, b);
+
+		// |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+		float trace = Lanes::Sum<4>(Lanes::Mul(adjAB, Lanes::Shuffle<0, 2, 1, 3>(adjDC)));
+		float det = Lanes::Get(dets, 0) * Lanes::Get(dets, 3) + Lanes::Get(dets, 1) * Lanes::Get(dets, 2) - trace;
+		if (out == nullptr)
+			return det;
+
+		Register x = Lanes::Sub(Lanes::Mul(Lanes::Shuffle<3, 3, 3, 3>(dets), a), m_matrix2Mul(b, adjDC));
+		Register w = Lanes::Sub(Lanes::Mul(Lanes::Shuffle<0, 0, 0, 0>(dets), d), m_matrix2Mul(c, adjAB));
+		Register y = Lanes::Sub(Lanes::Mul(Lanes::Shuffle<1, 1, 1, 1>(dets), c), m_matrix2MulAdj(d, adjAB));
+		Register z = Lanes::Sub(Lanes::Mul(Lanes::Shuffle<2, 2, 2, 2>(dets), b), m_matrix2MulAdj(a, adjDC));
+
+		Register invDet = Lanes::Div(Lanes::Set(1.0f, -1.0f, -1.0f, 1.0f), Lanes::Splat(det));
+		x = Lanes::Mul(x, invDet);
+		y = Lanes::Mul(y, invDet);
+		z = Lanes::Mul(z, invDet);
+		w = Lanes::Mul(w, invDet);
+
+		// the shuffles apply the final adjugate
+		out->Columns[0] = float4(Lanes::Shuffle<3, 1, 3, 1>(x, y));
+		out->Columns[1] = float4(Lanes::Shuffle<2, 0, 2, 0>(x, y));
+		out->Columns[2] = float4(Lanes::Shuffle<3, 1, 3, 1>(z, w));
+		out->Columns[3] = float4(Lanes::Shuffle<2, 0, 2, 0>(z, w));
+		return det;
+	}
+	inline float Determinant(const float4x4& m) { return m_blockInverse(m, nullptr); }
+
+	// singular matrices return infinities or NaNs
+	inline float2x2 Inverse(const float2x2& m)
+	{
+		float invDet = 1.0f / Determinant(m);
+		return float2x2(float2(m[1][1], -m[0][1]) * invDet, float2(-m[1][0], m[0][0]) * invDet);
+	}
+	inline float3x3 Inverse(const float3x3& m)
+	{
+		// the rows of the inverse are perpendicular to two of the columns
+		float3 r0 = Cross(m[1], m[2]), r1 = Cross(m[2], m[0]), r2 = Cross(m[0], m[1]);
+		float invDet = 1.0f / Dot(m[0], r0);
+		return Transpose(float3x3(r0 * invDet, r1 * invDet, r2 * invDet));
+	}
+	inline float4x4 Inverse(const float4x4& m)
+	{
+		float4x4 ret;
+		m_blockInverse(m, &ret);
+		return ret;
+	}
+}
\ No newline at end of file
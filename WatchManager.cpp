@@ -0,0 +1,156 @@
+#include "WatchManager.h"
+#include "ClosureEvaluator.h"
+#include "Optimizer.h"
+#include "Analysis.h"
+
+#include <algorithm>
+
+namespace expr
+{
+	WatchManager::WatchManager()
+	{
+		m_nextHandle = 0;
+	}
+	WatchManager::~WatchManager()
+	{
+		while (!m_watches.empty())
+			Remove(m_watches.begin()->first);
+	}
+	int WatchManager::Add(const std::string& expression)
+	{
+		Parser* parser = new Parser(expression.c_str(), expression.size());
+		Node* root = parser->Parse();
+		if (parser->Error()) {
+			parser->Clear();
+			delete parser;
+			return -1;
+		}
+
+		Optimizer opt(*parser);
+		root = opt.Fold(root);
+		root = opt.EliminateCommonSubexpressions(root);
+
+		int handle = m_nextHandle++;
+		Watch& watch = m_watches[handle];
+		watch.Source = parser;
+		watch.Eval = new ClosureEvaluator(root);
+		watch.IsDirty = true;
+		watch.HasError = false;
+		expr::GetVariables(root, watch.Variables);
+
+		for (const std::string& name : watch.Variables) {
+			m_readers[name].push_back(handle);
+
+			auto var = m_vars.find(name);
+			if (var != m_vars.end())
+				watch.Eval->SetVariable(name, var->second);
+		}
+
+		return handle;
+	}
+	void WatchManager::Remove(int handle)
+	{
+		auto it = m_watches.find(handle);
+		if (it == m_watches.end())
+			return;
+
+		Watch& watch = it->second;
+		for (const std::string& name : watch.Variables) {
+			auto readers = m_readers.find(name);
+			if (readers == m_readers.end())
+				continue;
+
+			std::vector<int>& list = readers->second;
+			list.erase(std::remove(list.begin(), list.end(), handle), list.end());
+			if (list.empty())
+				m_readers.erase(readers);
+		}
+
+		delete watch.Eval;
+		watch.Source->Clear();
+		delete watch.Source;
+
+		m_watches.erase(it);
+	}
+	void WatchManager::SetVariable(const std::string& name, const Value& val)
+	{
+		auto var = m_vars.find(name);
+		if (var != m_vars.end() && m_isEqual(var->second, val))
+			return;
+		m_vars[name] = val;
+
+		auto readers = m_readers.find(name);
+		if (readers == m_readers.end())
+			return;
+
+		for (int handle : readers->second) {
+			Watch& watch = m_watches[handle];
+			watch.Eval->SetVariable(name, val);
+			watch.IsDirty = true;
+		}
+	}
+	void WatchManager::Update(std::vector<int>& updated)
+	{
+		size_t start = updated.size();
+		for (auto& it : m_watches) {
+			Watch& watch = it.second;
+			if (!watch.IsDirty)
+				continue;
+
+			watch.HasError = !watch.Eval->Evaluate(watch.Result);
+			watch.Error = watch.HasError ? watch.Eval->ErrorMessage() : "";
+			watch.IsDirty = false;
+
+			updated.push_back(it.first);
+		}
+
+		// m_watches is unordered - report the handles in a stable order
+		std::sort(updated.begin() + start, updated.end());
+	}
+	void WatchManager::GetAffected(const std::vector<std::string>& vars, std::vector<int>& out)
+	{
+		size_t start = out.size();
+		for (const std::string& name : vars) {
+			auto readers = m_readers.find(name);
+			if (readers != m_readers.end())
+				out.insert(out.end(), readers->second.begin(), readers->second.end());
+		}
+
+		// watches that read more than one of the variables only get reported once
+		std::sort(out.begin() + start, out.end());
+		out.erase(std::unique(out.begin() + start, out.end()), out.end());
+	}
+	bool WatchManager::IsWatched(const std::string& name)
+	{
+		return m_readers.find(name) != m_readers.end();
+	}
+	const std::vector<std::string>& WatchManager::GetVariables(int handle)
+	{
+		auto it = m_watches.find(handle);
+		return it == m_watches.end() ? m_empty : it->second.Variables;
+	}
+	bool WatchManager::GetValue(int handle, Value& out)
+	{
+		auto it = m_watches.find(handle);
+		if (it == m_watches.end() || it->second.HasError)
+			return false;
+		out = it->second.Result;
+		return true;
+	}
+	const std::string& WatchManager::ErrorMessage(int handle)
+	{
+		auto it = m_watches.find(handle);
+		return it == m_watches.end() ? m_noError : it->second.Error;
+	}
+	bool WatchManager::m_isEqual(const Value& a, const Value& b)
+	{
+		if (a.Type != b.Type)
+			return false;
+
+		bool isBool = GetBaseType(a.Type) == ValueType::Bool;
+		for (int i = 0; i < GetComponentCount(a.Type); i++)
+			if (isBool ? (a.Bool[i] != b.Bool[i]) : (a.Uint[i] != b.Uint[i]))
+				return false;
+		return true;
+	}
+}
\ No newline at end of file
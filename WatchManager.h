@@ -0,0 +1,63 @@
+#pragma once
+#include "Parser.h"
+#include "Evaluator.h"
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+namespace expr
+{
+	// watch expressions of a debugger session - every watch knows which variables it
+	// reads, so after a step only the watches whose inputs actually changed are evaluated
+	class WatchManager
+	{
+	public:
+		WatchManager();
+		~WatchManager();
+
+		// returns a handle to the watch or -1 if the expression can't be parsed
+		int Add(const std::string& expression);
+		void Remove(int handle);
+
+		// marks the watches that read the variable as dirty, unless the value is the same
+		void SetVariable(const std::string& name, const Value& val);
+
+		// evaluates the dirty watches and appends their handles, sorted in ascending order
+		void Update(std::vector<int>& updated);
+
+		// watches that read any of the variables - for watches that have to be recompiled
+		// instead of evaluated natively
+		void GetAffected(const std::vector<std::string>& vars, std::vector<int>& out);
+
+		// false once the last watch that reads the variable is removed
+		bool IsWatched(const std::string& name);
+
+		const std::vector<std::string>& GetVariables(int handle);
+		bool GetValue(int handle, Value& out); // false if the last evaluation failed
+		const std::string& ErrorMessage(int handle);
+
+	private:
+		struct Watch
+		{
+			Parser* Source;
+			Evaluator* Eval;
+			std::vector<std::string> Variables;
+
+			Value Result;
+			bool IsDirty;
+			bool HasError;
+			std::string Error;
+		};
+
+		bool m_isEqual(const Value& a, const Value& b);
+
+		std::unordered_map<int, Watch> m_watches;
+		std::unordered_map<std::string, std::vector<int>> m_readers; // variable -> watches that read it
+		std::unordered_map<std::string, Value> m_vars;
+		int m_nextHandle;
+
+		std::vector<std::string> m_empty;
+		std::string m_noError;
+	};
+}
\ No newline at end of file
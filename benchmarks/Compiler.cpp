@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#include "../examples/Compiler.h"
+#include "ExpressionGenerator.h"
+
+// compile time per expression against modules of different sizes - with IdAllocator it
+// shouldn't depend on the size of the module, renumbering the whole module after every
+// compile (what Compiler did before) grows linearly with it
+
+// a module with a few variables and a function with roughly instrCount instructions
+static void generateModule(IAllocator* alloc, ILogger* logger, int instrCount, std::vector<unsigned int>& out)
+{
+	Module module(alloc, spv::Version, logger);
+	module.addCapability(spv::Capability::Shader);
+
+	Instruction* a = module.variable<float>(spv::StorageClass::Private, "a");
+	module.variable<vector_t<float, 3>>(spv::StorageClass::Private, "pos");
+
+	Function& func = module.addFunction<void>("filler", spv::FunctionControlMask::Const);
+	BasicBlock& bb = *func;
+	Instruction* value = bb->opLoad(a);
+	for (int i = 0; i < instrCount; i++)
+		value = bb->opFAdd(value, module.constant((float)(i % 64)));
+	bb->opReturn();
+
+	module.assignIDs();
+
+	BinaryVectorWriter writer(out);
+	module.write(&writer);
+}
+
+static double measure(IAllocator* alloc, ILogger* logger, const std::vector<unsigned int>& binary, const std::vector<std::string>& exprs, bool renumber, int iterations)
+{
+	const int exprCount = (int)exprs.size();
+
+	CompileSession session(alloc, logger);
+	if (!session.Load(binary)) {
+		printf("%s\n", session.ErrorMessage().c_str());
+		return 0.0;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < iterations; i++) {
+		int handle = session.Compile(exprs[i % exprCount]);
+		if (renumber)
+			session.GetModule().assignIDs();
+		session.Remove(handle);
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+
+	return std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+}
+
+int main(int argc, char** argv)
+{
+	bool csv = argc > 1 && strcmp(argv[1], "--csv") == 0;
+
+	HeapAllocator alloc;
+	ConsoleLogger logger;
+
+	const int sizes[] = { 1000, 10000, 50000, 200000 };
+	const int iterations = 200;
+
+	std::vector<std::string> small = {
+		"a * 2.0 + 1.0",
+		"dot(normalize(pos), vec3(0.0, 1.0, 0.0)) * a",
+		"pos.x > 0.5 ? pos.zyx * a : vec3(a)",
+		"length(pos - vec3(a, 0.0, 1.0))",
+	};
+
+	// same generator as the Throughput benchmark
+	ExpressionGenerator generator;
+	std::vector<std::string> large;
+	for (int i = 0; i < 4; i++)
+		large.push_back(generator.Generate(1024));
+
+	if (csv)
+		printf("instructions,incremental_us,assign_ids_us,generated_1kb_us\n");
+	else
+		printf("%-14s %18s %18s %18s\n", "instructions", "incremental (us)", "assignIDs (us)", "generated 1KB (us)");
+	for (int size : sizes) {
+		std::vector<unsigned int> binary;
+		generateModule(&alloc, &logger, size, binary);
+
+		double incremental = measure(&alloc, &logger, binary, small, false, iterations);
+		double renumber = measure(&alloc, &logger, binary, small, true, iterations);
+		double generated = measure(&alloc, &logger, binary, large, false, iterations);
+
+		if (csv)
+			printf("%d,%.2f,%.2f,%.2f\n", size, incremental, renumber, generated);
+		else
+			printf("%-14d %18.1f %18.1f %18.1f\n", size, incremental, renumber, generated);
+	}
+
+	return 0;
+}
\ No newline at end of file
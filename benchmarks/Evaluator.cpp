@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#include "../Parser.h"
+#include "../Interpreter.h"
+#include "../ClosureEvaluator.h"
+
+// compares the tree-walking interpreter with the closure evaluator, and the closure
+// evaluator with the polynomial builtins (MathMode::Fast)
+static double measure(expr::Evaluator& eval, int iterations, float& checksum)
+{
+	expr::Value ret;
+	eval.Evaluate(ret); // warm up (compiles the closure tree)
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < iterations; i++) {
+		eval.SetVariable("t", expr::MakeFloat(i * 0.001f));
+		eval.Evaluate(ret);
+		checksum += ret.Float[0];
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+
+	return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+int main()
+{
+	const char* exprs[] = {
+		"t * 2.0 + 1.0",
+		"sin(t) * 0.5 + 0.5",
+		"length(pos - vec3(t, 0.0, 1.0)) < 2.0 ? 1.0 : 0.0",
+		"dot(normalize(pos), vec3(0.0, 1.0, 0.0)) * clamp(t, 0.0, 1.0)",
+		"(pos.x > 0.5 && pos.y < 0.25) ? mix(t, 1.0, 0.5) : pow(t, 2.0)",
+		"vec4(pos.zyx * t, 1.0).w + mat2(2.0)[1].y * t",
+		"exp(-t) * cos(t * 20.0) + pow(t, 2.2) * inversesqrt(t + 1.0)",
+		"atan(pos.y, pos.x) + log2(t + 1.0) * sin(t * 3.0)",
+	};
+	const int iterations = 1000000;
+
+	expr::Value pos;
+	pos.Type = expr::ValueType::Float3;
+	pos.Float[0] = 0.75f; pos.Float[1] = 0.1f; pos.Float[2] = 0.3f;
+
+	printf("%-70s %12s %12s %8s %12s\n", "expression", "tree (ns)", "closure (ns)", "speedup", "fast (ns)");
+	for (const char* e : exprs) {
+		expr::Parser parser(e, strlen(e));
+		expr::Node* root = parser.Parse();
+		if (parser.Error()) {
+			printf("%s: %s\n", e, parser.ErrorMessage().c_str());
+			continue;
+		}
+
+		expr::Interpreter interpreter(root);
+		expr::ClosureEvaluator closures(root);
+		expr::ClosureEvaluator fastClosures(root);
+		fastClosures.SetMathMode(expr::MathMode::Fast);
+		interpreter.SetVariable("t", expr::MakeFloat(0.0f));
+		interpreter.SetVariable("pos", pos);
+		closures.SetVariable("t", expr::MakeFloat(0.0f));
+		closures.SetVariable("pos", pos);
+		fastClosures.SetVariable("t", expr::MakeFloat(0.0f));
+		fastClosures.SetVariable("pos", pos);
+
+		float checkTree = 0.0f, checkClosure = 0.0f, checkFast = 0.0f;
+		double tree = measure(interpreter, iterations, checkTree);
+		double closure = measure(closures, iterations, checkClosure);
+		double fast = measure(fastClosures, iterations, checkFast);
+
+		printf("%-70s %12.1f %12.1f %7.2fx %12.1f%s\n", e, tree, closure, tree / closure, fast, checkTree != checkClosure ? " (MISMATCH)" : "");
+
+		parser.Clear();
+	}
+
+	return 0;
+}
\ No newline at end of file
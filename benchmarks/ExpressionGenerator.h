@@ -0,0 +1,100 @@
+#pragma once
+#include <string>
+#include <stdint.h>
+#include <stdio.h>
+
+// deterministic generator of shader-like expressions - the same seed always produces the
+// same text, so numbers from different runs/machines can be compared. The expressions only
+// use a float "a" and a vec3 "pos" and always evaluate to a float.
+class ExpressionGenerator
+{
+public:
+	ExpressionGenerator(uint32_t seed = 0x2545F491u) { m_state = seed ? seed : 1; }
+
+	// joins random terms with operators until the text is at least targetLength bytes long
+	std::string Generate(size_t targetLength)
+	{
+		std::string out;
+		m_float(out, 4);
+		while (out.size() < targetLength) {
+			out += m_operators[m_next(4)];
+			m_float(out, 4);
+		}
+		return out;
+	}
+
+private:
+	uint32_t m_next()
+	{
+		// xorshift32
+		m_state ^= m_state << 13;
+		m_state ^= m_state >> 17;
+		m_state ^= m_state << 5;
+		return m_state;
+	}
+	inline uint32_t m_next(uint32_t range) { return m_next() % range; }
+
+	void m_literal(std::string& out)
+	{
+		char buffer[32];
+		snprintf(buffer, sizeof(buffer), "%u.%u", m_next(10), m_next(100));
+		out += buffer;
+	}
+	void m_float(std::string& out, int depth)
+	{
+		static const char* swizzles[] = { "x", "y", "z" };
+
+		int choice = depth <= 0 ? (int)m_next(3) : (int)m_next(14);
+		switch (choice) {
+		case 0: m_literal(out); break;
+		case 1: out += "a"; break;
+		case 2: out += "pos."; out += swizzles[m_next(3)]; break;
+		case 3: out += "sin("; m_float(out, depth - 1); out += ")"; break;
+		case 4: out += "clamp("; m_float(out, depth - 1); out += ", 0.0, 1.0)"; break;
+		case 5: out += "mix("; m_float(out, depth - 1); out += ", "; m_float(out, depth - 1); out += ", 0.5)"; break;
+		case 6: out += "dot("; m_vec3(out, depth - 1); out += ", "; m_vec3(out, depth - 1); out += ")"; break;
+		case 7: out += "length("; m_vec3(out, depth - 1); out += ")"; break;
+		case 8: out += "float(int("; m_float(out, depth - 1); out += "))"; break;
+		case 9: m_vec3(out, depth - 1); out += "."; out += swizzles[m_next(3)]; break;
+		case 10: {
+			// long operator chain
+			int count = 4 + m_next(8);
+			m_float(out, 0);
+			for (int i = 0; i < count; i++) {
+				out += m_operators[m_next(4)];
+				m_float(out, 0);
+			}
+		} break;
+		case 11: {
+			// deep parentheses
+			int count = 2 + m_next(6);
+			out.append(count, '(');
+			m_float(out, depth - 1);
+			out.append(count, ')');
+		} break;
+		case 12:
+			m_float(out, 0); out += " > "; m_float(out, 0); out += " ? ";
+			m_float(out, depth - 1); out += " : "; m_float(out, depth - 1);
+			break;
+		default:
+			out += "("; m_float(out, depth - 1); out += m_operators[m_next(4)]; m_float(out, depth - 1); out += ")";
+			break;
+		}
+	}
+	void m_vec3(std::string& out, int depth)
+	{
+		int choice = depth <= 0 ? (int)m_next(2) : (int)m_next(7);
+		switch (choice) {
+		case 0: out += "pos"; break;
+		case 1: out += "pos.zyx"; break;
+		case 2: out += "vec3("; m_float(out, depth - 1); out += ")"; break;
+		case 3: out += "vec3("; m_float(out, depth - 1); out += ", "; m_float(out, depth - 1); out += ", "; m_float(out, depth - 1); out += ")"; break;
+		case 4: out += "normalize("; m_vec3(out, depth - 1); out += ")"; break;
+		case 5: out += "("; m_vec3(out, depth - 1); out += " * "; m_float(out, depth - 1); out += ")"; break;
+		default: out += "("; m_vec3(out, depth - 1); out += " + "; m_vec3(out, depth - 1); out += ")"; break;
+		}
+	}
+
+	uint32_t m_state;
+	const char* m_operators[4] = { " + ", " - ", " * ", " / " };
+};
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <new>
+
+#include "../Parser.h"
+#include "ExpressionGenerator.h"
+
+// tokenizer and parser throughput on generated expressions of different sizes
+// run with --csv to get output that's easier to track between commits
+
+// every allocation goes through here so that allocations per parse and peak memory can be measured
+static size_t m_allocCount = 0;
+static size_t m_curBytes = 0;
+static size_t m_peakBytes = 0;
+
+static const size_t m_headerSize = 16; // keeps the returned pointer aligned
+
+void* operator new(size_t size)
+{
+	char* block = (char*)malloc(size + m_headerSize);
+	if (block == nullptr)
+		throw std::bad_alloc();
+	*(size_t*)block = size;
+
+	m_allocCount++;
+	m_curBytes += size;
+	if (m_curBytes > m_peakBytes)
+		m_peakBytes = m_curBytes;
+
+	return block + m_headerSize;
+}
+void operator delete(void* ptr) noexcept
+{
+	if (ptr == nullptr)
+		return;
+	char* block = (char*)ptr - m_headerSize;
+	m_curBytes -= *(size_t*)block;
+	free(block);
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete[](void* ptr) noexcept { operator delete(ptr); }
+void operator delete(void* ptr, size_t) noexcept { operator delete(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { operator delete(ptr); }
+
+struct Result
+{
+	size_t Bytes, Tokens, Nodes;
+	double TokensPerSecond;
+	double BytesPerSecond, NodesPerSecond;
+	double AllocationsPerParse;
+	size_t PeakBytes;
+};
+
+// runs func until at least minSeconds have passed, returns seconds per call
+template<typename F>
+static double measure(F func, double minSeconds = 0.25)
+{
+	func(); // warm up
+
+	int iterations = 0;
+	auto start = std::chrono::high_resolution_clock::now();
+	double elapsed = 0.0;
+	do {
+		func();
+		iterations++;
+		elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	} while (elapsed < minSeconds || iterations < 3);
+
+	return elapsed / iterations;
+}
+
+static bool run(const std::string& text, Result& out)
+{
+	out.Bytes = text.size();
+
+	// make sure that the generator produced something valid
+	{
+		expr::Parser parser(text.c_str(), text.size());
+		parser.Parse();
+		bool hasError = parser.Error();
+		if (hasError)
+			printf("generated expression doesn't parse: %s\n", parser.ErrorMessage().c_str());
+		out.Nodes = parser.GetList().size();
+		parser.Clear();
+		if (hasError)
+			return false;
+	}
+
+	// tokenizer
+	size_t tokens = 0;
+	double lexTime = measure([&]() {
+		expr::Tokenizer tokenizer(text.c_str(), (unsigned int)text.size());
+		tokens = 0;
+		while (tokenizer.Next())
+			tokens++;
+	});
+	out.Tokens = tokens;
+	out.TokensPerSecond = tokens / lexTime;
+
+	// parser
+	double parseTime = measure([&]() {
+		expr::Parser parser(text.c_str(), text.size());
+		parser.Parse();
+		parser.Clear();
+	});
+	out.BytesPerSecond = text.size() / parseTime;
+	out.NodesPerSecond = out.Nodes / parseTime;
+
+	// allocations and memory of a single parse
+	size_t allocStart = m_allocCount;
+	size_t bytesStart = m_curBytes;
+	m_peakBytes = m_curBytes;
+	{
+		expr::Parser parser(text.c_str(), text.size());
+		parser.Parse();
+		out.AllocationsPerParse = (double)(m_allocCount - allocStart);
+		parser.Clear();
+	}
+	out.PeakBytes = m_peakBytes - bytesStart;
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	bool csv = argc > 1 && strcmp(argv[1], "--csv") == 0;
+
+	const size_t sizes[] = { 64, 1024, 16 * 1024, 256 * 1024 };
+
+	if (csv)
+		printf("bytes,tokens,nodes,lex_tokens_per_sec,parse_bytes_per_sec,parse_nodes_per_sec,allocs_per_parse,peak_bytes\n");
+	else
+		printf("%-10s %10s %10s %14s %14s %14s %12s %12s\n", "bytes", "tokens", "nodes", "lex (Mtok/s)", "parse (MB/s)", "parse (Mn/s)", "allocs", "peak (KB)");
+
+	for (size_t size : sizes) {
+		ExpressionGenerator generator;
+		std::string text = generator.Generate(size);
+
+		Result res;
+		if (!run(text, res))
+			return 1;
+
+		if (csv)
+			printf("%zu,%zu,%zu,%.0f,%.0f,%.0f,%.0f,%zu\n", res.Bytes, res.Tokens, res.Nodes, res.TokensPerSecond, res.BytesPerSecond,
+				res.NodesPerSecond, res.AllocationsPerParse, res.PeakBytes);
+		else
+			printf("%-10zu %10zu %10zu %14.2f %14.2f %14.2f %12.0f %12.1f\n", res.Bytes, res.Tokens, res.Nodes, res.TokensPerSecond / 1e6,
+				res.BytesPerSecond / 1e6, res.NodesPerSecond / 1e6, res.AllocationsPerParse, res.PeakBytes / 1024.0);
+	}
+
+	return 0;
+}
\ No newline at end of file
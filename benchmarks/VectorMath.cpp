@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+#include "../VectorMath.h"
+#include "../Operations.h"
+
+// compares the VectorMath types with the scalar column major kernels that Value uses,
+// every operation runs over an array of independent inputs
+template<typename F>
+static double measure(int count, int repeat, F func)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int r = 0; r < repeat; r++)
+		for (int i = 0; i < count; i++)
+			func(i);
+	auto end = std::chrono::high_resolution_clock::now();
+
+	return std::chrono::duration<double, std::nano>(end - start).count() / ((double)count * repeat);
+}
+
+int main()
+{
+	const int count = 1024, repeat = 10000;
+
+	// column major float4x4s and float4s, the first matrix is the identity
+	std::vector<float> mats(count * 16), vecs(count * 4), out(count * 16);
+	for (int i = 0; i < count * 16; i++)
+		mats[i] = ((i % 16) % 5 == 0) ? 1.0f + (i / 16) * 1e-3f : ((i * 7919) % 101) * 1e-3f;
+	for (int i = 0; i < count * 4; i++)
+		vecs[i] = ((i * 104729) % 1000) * 1e-3f;
+
+	std::vector<expr::float4x4> mm(count), mout(count);
+	std::vector<expr::float4> vv(count), vout(count);
+	for (int i = 0; i < count; i++) {
+		mm[i] = expr::float4x4::Load(&mats[i * 16]);
+		vv[i] = expr::float4::Load(&vecs[i * 4]);
+	}
+
+	float checksum = 0.0f;
+	printf("%-28s %12s %12s %8s\n", "operation", "scalar (ns)", "simd (ns)", "speedup");
+
+	double scalar = measure(count, repeat, [&](int i) { expr::MatrixTimesVector(&mats[i * 16], 4, 4, &vecs[i * 4], &out[i * 4]); });
+	double simd = measure(count, repeat, [&](int i) { vout[i] = mm[i] * vv[i]; });
+	checksum += out[4] + vout[1][0];
+	printf("%-28s %12.2f %12.2f %7.2fx\n", "float4x4 * float4", scalar, simd, scalar / simd);
+
+	scalar = measure(count, repeat, [&](int i) { expr::VectorTimesMatrix(&vecs[i * 4], &mats[i * 16], 4, 4, &out[i * 4]); });
+	simd = measure(count, repeat, [&](int i) { vout[i] = vv[i] * mm[i]; });
+	checksum += out[4] + vout[1][0];
+	printf("%-28s %12.2f %12.2f %7.2fx\n", "float4 * float4x4", scalar, simd, scalar / simd);
+
+	scalar = measure(count, repeat, [&](int i) { expr::MatrixTimesMatrix(&mats[i * 16], 4, 4, &mats[(count - 1 - i) * 16], 4, &out[i * 16]); });
+	simd = measure(count, repeat, [&](int i) { mout[i] = mm[i] * mm[count - 1 - i]; });
+	checksum += out[16] + mout[1][0][0];
+	printf("%-28s %12.2f %12.2f %7.2fx\n", "float4x4 * float4x4", scalar, simd, scalar / simd);
+
+	simd = measure(count, repeat, [&](int i) { mout[i] = expr::Inverse(mm[i]); });
+	checksum += mout[1][0][0];
+	printf("%-28s %12s %12.2f\n", "inverse(float4x4)", "-", simd);
+
+	printf("\nchecksum: %f\n", checksum);
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,2277 @@
+#pragma once
+#include <stdio.h>
+#include <vector>
+#include <map>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <unordered_set>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <deque>
+#include <functional>
+#include <memory>
+
+#include <spvgentwo/SpvGenTwo.h>
+#include <common/ConsoleLogger.h>
+#include <common/HeapAllocator.h>
+#include <common/BinaryVectorWriter.h>
+#include <common/BinaryFileReader.h>
+#include <common/HeapVector.h>
+#include <spirv-tools/libspirv.h>
+#include <spirv-tools/optimizer.hpp>
+#include <spvgentwo/Grammar.h>
+#include "../Parser.h"
+#include "../Optimizer.h"
+#include "../Builtins.h"
+#include "../Analysis.h"
+#include "../Instrumentation.h"
+
+using namespace spvgentwo;
+
+// name lookups into a loaded module - build it once and share it between all of the
+// expressions that get compiled against the module
+class ModuleIndex
+{
+public:
+	ModuleIndex(spvgentwo::Module* module)
+	{
+		m_module = module;
+		Build();
+	}
+
+	void Build()
+	{
+		m_names.clear();
+		m_functions.clear();
+		m_overloads.clear();
+
+		m_module->iterateInstructions([&](Instruction& inst) {
+			const char* name = m_module->getName(&inst, 0);
+			if (name != nullptr && name[0] != 0)
+				m_names[name] = &inst;
+		});
+
+		// function names are mangled as name(args;
+		for (auto& func : m_module->getFunctions()) {
+			const char* name = m_module->getName(func.getFunction(), 0);
+			if (name == nullptr)
+				continue;
+
+			const char* end = strchr(name, '(');
+			std::string fname = end ? std::string(name, end - name) : std::string(name);
+			m_functions.emplace(fname, &func); // first overload wins
+
+			// every parameter ends with a ';', unmangled names match any argument count
+			int paramCount = end ? (int)std::count(end, end + strlen(end), ';') : -1;
+			m_overloads[fname].push_back({ paramCount, &func });
+		}
+	}
+
+	Instruction* GetVariable(const std::string& name) const
+	{
+		auto it = m_names.find(name);
+		return it == m_names.end() ? nullptr : it->second;
+	}
+	Function* GetFunction(const std::string& name) const
+	{
+		auto it = m_functions.find(name);
+		return it == m_functions.end() ? nullptr : it->second;
+	}
+	Function* GetFunction(const std::string& name, int argCount) const
+	{
+		auto it = m_overloads.find(name);
+		if (it == m_overloads.end())
+			return nullptr;
+		for (const auto& overload : it->second)
+			if (overload.first == argCount || overload.first < 0)
+				return overload.second;
+		return nullptr;
+	}
+
+private:
+	spvgentwo::Module* m_module;
+	std::unordered_map<std::string, Instruction*> m_names;
+	std::unordered_map<std::string, Function*> m_functions;
+	std::unordered_map<std::string, std::vector<std::pair<int, Function*>>> m_overloads;
+};
+
+// hands out result IDs past the module's current bound - assignIDs() renumbers the whole
+// module, this only touches the instructions that were added since
+class IdAllocator
+{
+public:
+	IdAllocator(spvgentwo::Module* module)
+	{
+		m_module = module;
+		m_bound = 1;
+		m_globalCount = 0;
+	}
+
+	// numbers the whole module, only needed once after it was loaded
+	void Reset()
+	{
+		expr::PhaseTimer timer(expr::Phase::AssignIDs);
+		m_module->assignIDs();
+
+		m_bound = 1;
+		m_module->iterateInstructions([&](Instruction& inst) {
+			spv::Id id = inst.getResultId();
+			if (id != spv::InvalidId && id >= m_bound)
+				m_bound = id + 1;
+		});
+		m_globalCount = m_module->getTypesAndConstants().size();
+	}
+	// for modules that were read from a binary with IDs up to the bound
+	inline void SetBound(spv::Id bound)
+	{
+		m_bound = bound;
+		m_globalCount = m_module->getTypesAndConstants().size();
+	}
+	inline spv::Id GetBound() const { return m_bound; }
+
+	// new types and constants end up in the global section, everything else is in the function -
+	// the global section only ever grows at the end, so entries before the last count have IDs
+	void Assign(Function& func)
+	{
+		size_t globalCount = m_module->getTypesAndConstants().size();
+		if (globalCount > m_globalCount) {
+			size_t index = 0;
+			for (Instruction& inst : m_module->getTypesAndConstants())
+				if (index++ >= m_globalCount)
+					m_assign(inst);
+		}
+		m_globalCount = globalCount;
+
+		m_assign(*func.getFunction());
+		for (Instruction& param : func.getParameters())
+			m_assign(param);
+		for (BasicBlock& bb : func) {
+			m_assign(*bb.getLabel());
+			for (Instruction& inst : bb)
+				m_assign(inst);
+		}
+	}
+
+private:
+	void m_assign(Instruction& inst)
+	{
+		for (Operand& op : inst)
+			if (op.isResultId() && op.resultId == spv::InvalidId)
+				op.resultId = m_bound++;
+	}
+
+	spvgentwo::Module* m_module;
+	spv::Id m_bound;
+	size_t m_globalCount; // types and constants that were numbered already
+};
+
+// vector types and constants of a module - spvgentwo looks them up in the module on
+// every call, this keeps them in a flat table/hash map for the lifetime of a session
+class TypeCache
+{
+public:
+	TypeCache(spvgentwo::Module* module)
+	{
+		m_module = module;
+		Clear();
+	}
+
+	void Clear()
+	{
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 5; j++)
+				m_types[i][j] = nullptr;
+		m_constants.clear();
+		m_values.clear();
+	}
+
+	// baseType is TokenType_Float/Int/Uint/Bool, compCount 2-4
+	Instruction* GetVectorType(int baseType, int compCount)
+	{
+		if (compCount < 2 || compCount > 4)
+			return nullptr;
+
+		Instruction*& ret = m_types[m_getBaseIndex(baseType)][compCount];
+		if (ret == nullptr) {
+			switch (m_getBaseIndex(baseType) * 8 + compCount) {
+			case 0 * 8 + 2: ret = m_module->type<vector_t<float, 2>>(); break;
+			case 0 * 8 + 3: ret = m_module->type<vector_t<float, 3>>(); break;
+			case 0 * 8 + 4: ret = m_module->type<vector_t<float, 4>>(); break;
+			case 1 * 8 + 2: ret = m_module->type<vector_t<int, 2>>(); break;
+			case 1 * 8 + 3: ret = m_module->type<vector_t<int, 3>>(); break;
+			case 1 * 8 + 4: ret = m_module->type<vector_t<int, 4>>(); break;
+			case 2 * 8 + 2: ret = m_module->type<vector_t<unsigned int, 2>>(); break;
+			case 2 * 8 + 3: ret = m_module->type<vector_t<unsigned int, 3>>(); break;
+			case 2 * 8 + 4: ret = m_module->type<vector_t<unsigned int, 4>>(); break;
+			case 3 * 8 + 2: ret = m_module->type<vector_t<bool, 2>>(); break;
+			case 3 * 8 + 3: ret = m_module->type<vector_t<bool, 3>>(); break;
+			case 3 * 8 + 4: ret = m_module->type<vector_t<bool, 4>>(); break;
+			}
+		}
+		return ret;
+	}
+
+	Instruction* GetConstant(float value) { return GetConstant(expr::TokenType_Float, 1, &value); }
+	Instruction* GetConstant(int value) { return GetConstant(expr::TokenType_Int, 1, &value); }
+	Instruction* GetConstant(unsigned int value) { return GetConstant(expr::TokenType_Uint, 1, &value); }
+	Instruction* GetConstant(bool value)
+	{
+		unsigned int bits = value;
+		return GetConstant(expr::TokenType_Bool, 1, &bits);
+	}
+
+	// scalar (compCount == 1) or composite constant, components are 4 bytes each (bools are 0/1)
+	Instruction* GetConstant(int baseType, int compCount, const void* comps)
+	{
+		ConstantKey key = { m_getBaseIndex(baseType), compCount, { 0 } };
+		memcpy(key.Bits, comps, compCount * sizeof(unsigned int));
+
+		Instruction*& ret = m_constants[key];
+		if (ret == nullptr) {
+			switch (key.Base) {
+			case 0: ret = m_createConstant<float>(compCount, (const float*)key.Bits); break;
+			case 1: ret = m_createConstant<int>(compCount, (const int*)key.Bits); break;
+			case 2: ret = m_createConstant<unsigned int>(compCount, key.Bits); break;
+			case 3: {
+				bool values[4];
+				for (int i = 0; i < compCount; i++)
+					values[i] = key.Bits[i] != 0;
+				ret = m_createConstant<bool>(compCount, values);
+			} break;
+			}
+
+			if (ret != nullptr)
+				m_values[ret] = key;
+		}
+		return ret;
+	}
+
+	// value of a constant that was created through the cache, false for any other instruction
+	bool GetConstantValue(Instruction* inst, int& baseType, int& compCount, unsigned int* bits)
+	{
+		static const int baseTypes[] = { expr::TokenType_Float, expr::TokenType_Int, expr::TokenType_Uint, expr::TokenType_Bool };
+
+		auto it = m_values.find(inst);
+		if (it == m_values.end())
+			return false;
+
+		baseType = baseTypes[it->second.Base];
+		compCount = it->second.Count;
+		memcpy(bits, it->second.Bits, compCount * sizeof(unsigned int));
+		return true;
+	}
+
+private:
+	struct ConstantKey
+	{
+		int Base, Count;
+		unsigned int Bits[4];
+
+		bool operator==(const ConstantKey& other) const
+		{
+			return Base == other.Base && Count == other.Count && memcmp(Bits, other.Bits, sizeof(Bits)) == 0;
+		}
+	};
+	struct ConstantKeyHash
+	{
+		size_t operator()(const ConstantKey& key) const
+		{
+			size_t hash = key.Base * 8 + key.Count;
+			for (int i = 0; i < key.Count; i++)
+				hash = hash * 16777619 ^ key.Bits[i];
+			return hash;
+		}
+	};
+
+	int m_getBaseIndex(int baseType)
+	{
+		switch (baseType) {
+		case expr::TokenType_Int: return 1;
+		case expr::TokenType_Uint: return 2;
+		case expr::TokenType_Bool: return 3;
+		default: break;
+		}
+		return 0;
+	}
+
+	template<typename T>
+	Instruction* m_createConstant(int compCount, const T* values)
+	{
+		switch (compCount) {
+		case 1: return m_module->constant(values[0]);
+		case 2: return m_module->constant(vector_t<T, 2>{ { values[0], values[1] } });
+		case 3: return m_module->constant(vector_t<T, 3>{ { values[0], values[1], values[2] } });
+		case 4: return m_module->constant(vector_t<T, 4>{ { values[0], values[1], values[2], values[3] } });
+		}
+		return nullptr;
+	}
+
+	spvgentwo::Module* m_module;
+	Instruction* m_types[4][5];
+	std::unordered_map<ConstantKey, Instruction*, ConstantKeyHash> m_constants;
+	std::unordered_map<Instruction*, ConstantKey> m_values;
+};
+
+class Compiler
+{
+	// forwards to whatever block code is currently emitted into
+	struct CurrentBlock
+	{
+		CurrentBlock(BasicBlock*& block) : Block(block) {}
+
+		Instruction* operator->() { return (*Block).operator->(); }
+		template<typename T>
+		auto ext() { return Block->template ext<T>(); }
+
+		BasicBlock*& Block;
+	};
+
+public:
+	Compiler(spvgentwo::Module* module, const ModuleIndex* index, TypeCache* cache, expr::Node* root, const char* funcName = "$$_shadered_immediate") :
+		m_func(module->addFunction<void>(funcName, spv::FunctionControlMask::Const))
+	{
+		m_module = module;
+		m_index = index;
+		m_cache = cache;
+		m_root = root;
+		m_result = nullptr;
+		m_block = &(*m_func);
+		m_branchCost = 16;
+		m_ids = nullptr;
+		m_error = false;
+	}
+
+	// without an allocator the whole module gets renumbered after every compile
+	inline void SetIdAllocator(IdAllocator* ids) { m_ids = ids; }
+
+	// branches of ternaries and right sides of && and || that cost more than this get real
+	// control flow so that only the branch that is taken runs, -1 always uses OpSelect
+	inline void SetBranchCost(int cost) { m_branchCost = cost; }
+
+	void SetVariable(const std::string& name, Instruction* inst)
+	{
+		m_vars[name] = inst;
+	}
+
+	int Compile()
+	{
+		Instruction* inst = nullptr;
+		{
+			expr::PhaseTimer timer(expr::Phase::Codegen);
+			inst = m_visit(m_root);
+
+			if (m_error || inst == nullptr)
+				return -1;
+
+			BasicBlock& bb = *m_block;
+			bb->opReturn();
+		}
+		m_assignIDs();
+
+		m_result = inst;
+		return (int)inst->getResultId();
+	}
+
+	// compiles all of the roots into the same function, so they share loads and common
+	// subexpressions - roots that fail to compile get a nullptr result
+	bool Compile(const std::vector<expr::Node*>& roots, std::vector<Instruction*>& results)
+	{
+		bool success = false;
+		{
+			expr::PhaseTimer timer(expr::Phase::Codegen);
+			for (expr::Node* root : roots) {
+				m_error = false;
+				Instruction* inst = root ? m_visit(root) : nullptr;
+				if (m_error)
+					inst = nullptr;
+
+				results.push_back(inst);
+				success |= (inst != nullptr);
+			}
+			m_error = false;
+
+			BasicBlock& bb = *m_block;
+			bb->opReturn();
+		}
+		m_assignIDs();
+
+		return success;
+	}
+
+	// IDs change when the module gets modified, so hold on to the instruction instead
+	inline Instruction* GetResult() { return m_result; }
+	inline Function& GetFunction() { return m_func; }
+
+	Instruction* GetVariable(const std::string& name)
+	{
+		if (m_vars.count(name))
+			return m_vars[name];
+		return nullptr;
+	}
+
+private:
+	void m_assignIDs()
+	{
+		expr::PhaseTimer timer(expr::Phase::AssignIDs);
+		if (m_ids != nullptr)
+			m_ids->Assign(m_func);
+		else
+			m_module->assignIDs();
+	}
+	Instruction* m_visit(expr::Node* node)
+	{
+		// shared nodes (see Optimizer::EliminateCommonSubexpressions) are only emitted once
+		auto visited = m_visited.find(node);
+		if (visited != m_visited.end())
+			return visited->second;
+
+		Instruction* ret = m_emit(node);
+		if (ret != nullptr)
+			m_visited[node] = ret;
+		return ret;
+	}
+	Instruction* m_emit(expr::Node* node)
+	{
+		if (m_error)
+			return nullptr;
+
+		// children can end in a different block than they started in (see m_branch)
+		CurrentBlock bb(m_block);
+
+		switch (node->GetNodeType()) {
+		case expr::NodeType::BinaryExpression: {
+			expr::BinaryExpressionNode* bexpr = ((expr::BinaryExpressionNode*)node);
+
+			// short-circuit && and || if the right side is expensive
+			bool isLogic = bexpr->Operator == expr::TokenType_LogicAnd || bexpr->Operator == expr::TokenType_LogicOr;
+			if (isLogic && m_isExpensive(bexpr->Right, nullptr)) {
+				Instruction* leftInstr = m_visit(bexpr->Left);
+				if (leftInstr != nullptr && leftInstr->getType()->isScalar()) {
+					if (bexpr->Operator == expr::TokenType_LogicAnd)
+						return m_branch(leftInstr, bexpr->Right, nullptr, m_cache->GetConstant(false));
+					else
+						return m_branch(leftInstr, nullptr, bexpr->Right, m_cache->GetConstant(true));
+				}
+			}
+
+			Instruction* leftInstr = m_visit(bexpr->Left);
+			Instruction* rightInstr = m_visit(bexpr->Right);
+
+			if (leftInstr == nullptr || rightInstr == nullptr) {
+				m_error = true;
+				return nullptr;
+			}
+
+			m_convert(bexpr->Operator, leftInstr, rightInstr, leftInstr, rightInstr);
+
+			if (leftInstr->getType()->isVector() && rightInstr->getType()->isVector())
+				if (leftInstr->getType()->getVectorComponentCount() != rightInstr->getType()->getVectorComponentCount()) {
+					m_error = true;
+					return nullptr;
+				}
+
+			if (leftInstr->getType()->getBaseType().isFloat()) {
+				if (bexpr->Operator == '+')
+					return bb->opFAdd(leftInstr, rightInstr);
+				else if (bexpr->Operator == '*') {
+					if (leftInstr->getType()->isVector() && rightInstr->getType()->isScalar())
+						return bb->opVectorTimesScalar(leftInstr, rightInstr);
+					else if (rightInstr->getType()->isVector() && leftInstr->getType()->isScalar())
+						return bb->opVectorTimesScalar(rightInstr, leftInstr);
+					else if (leftInstr->getType()->isVector() && rightInstr->getType()->isMatrix())
+						return bb->opVectorTimesMatrix(leftInstr, rightInstr);
+					else if (rightInstr->getType()->isVector() && leftInstr->getType()->isMatrix())
+						return bb->opMatrixTimesVector(rightInstr, leftInstr);
+					else if (rightInstr->getType()->isMatrix() && leftInstr->getType()->isMatrix())
+						return bb->opMatrixTimesMatrix(rightInstr, leftInstr);
+					return bb->opFMul(leftInstr, rightInstr);
+				}
+				else if (bexpr->Operator == '-')
+					return bb->opFSub(leftInstr, rightInstr);
+				else if (bexpr->Operator == '/')
+					return bb->opFDiv(leftInstr, rightInstr);
+				else if (bexpr->Operator == '%')
+					return bb->opFMod(leftInstr, rightInstr);
+				else if (bexpr->Operator == '<')
+					return bb->opFOrdLessThan(leftInstr, rightInstr);
+				else if (bexpr->Operator == '>')
+					return bb->opFOrdGreaterThan(leftInstr, rightInstr);
+				else if (bexpr->Operator == expr::TokenType_Equal)
+					return bb->opFOrdEqual(leftInstr, rightInstr);
+				else if (bexpr->Operator == expr::TokenType_NotEqual)
+					return bb->opFOrdNotEqual(leftInstr, rightInstr);
+				else if (bexpr->Operator == expr::TokenType_LessThanEqual)
+					return bb->opFOrdLessThanEqual(leftInstr, rightInstr);
+				else if (bexpr->Operator == expr::TokenType_GreaterThanEqual)
+					return bb->opFOrdGreaterThanEqual(leftInstr, rightInstr);
+			} else {
+				if (bexpr->Operator == '+')
+					return bb->opIAdd(leftInstr, rightInstr);
+				else if (bexpr->Operator == '*')
+					return bb->opIMul(leftInstr, rightInstr);
+				else if (bexpr->Operator == '-')
+					return bb->opISub(leftInstr, rightInstr);
+				else if (bexpr->Operator == '/')
+					return bb->opSDiv(leftInstr, rightInstr);
+				else if (bexpr->Operator == '%')
+					return bb->opSMod(leftInstr, rightInstr);
+				else if (bexpr->Operator == '<')
+					return bb->opSLessThan(leftInstr, rightInstr);
+				else if (bexpr->Operator == '>')
+					return bb->opSGreaterThan(leftInstr, rightInstr);
+				else if (bexpr->Operator == '&')
+					return bb->opBitwiseAnd(leftInstr, rightInstr);
+				else if (bexpr->Operator == '|')
+					return bb->opBitwiseOr(leftInstr, rightInstr);
+				else if (bexpr->Operator == '^')
+					return bb->opBitwiseXor(leftInstr, rightInstr);
+				else if (bexpr->Operator == expr::TokenType_BitshiftLeft) {
+					return bb->opShiftLeftLogical(leftInstr, rightInstr);
+				} else if (bexpr->Operator == expr::TokenType_BitshiftRight) {
+					if (leftInstr->getType()->isSigned())
+						return bb->opShiftRightArithmetic(leftInstr, rightInstr);
+					else
+						return bb->opShiftRightLogical(leftInstr, rightInstr);
+				} else if (bexpr->Operator == expr::TokenType_LogicOr)
+					return bb->opLogicalOr(leftInstr, rightInstr);
+				else if (bexpr->Operator == expr::TokenType_LogicAnd)
+					return bb->opLogicalAnd(leftInstr, rightInstr);
+				else if (bexpr->Operator == expr::TokenType_Equal)
+					return bb->opIEqual(leftInstr, rightInstr);
+				else if (bexpr->Operator == expr::TokenType_NotEqual)
+					return bb->opINotEqual(leftInstr, rightInstr);
+				else if (bexpr->Operator == expr::TokenType_LessThanEqual)
+					return bb->opSLessThanEqual(leftInstr, rightInstr);
+				else if (bexpr->Operator == expr::TokenType_GreaterThanEqual)
+					return bb->opSGreaterThanEqual(leftInstr, rightInstr);
+			}
+		} break;
+		case expr::NodeType::TernaryExpression: {
+			expr::TernaryExpressionNode* texpr = ((expr::TernaryExpressionNode*)node);
+
+			Instruction* conditionInstr = m_visit(texpr->Condition);
+			if (conditionInstr != nullptr && conditionInstr->getType()->isScalar() && m_isExpensive(texpr->OnTrue, texpr->OnFalse))
+				return m_branch(conditionInstr, texpr->OnTrue, texpr->OnFalse, nullptr);
+
+			Instruction* onTrueInstr = m_visit(texpr->OnTrue);
+			Instruction* onFalseInstr = m_visit(texpr->OnFalse);
+
+			if (conditionInstr == nullptr || onTrueInstr == nullptr || onFalseInstr == nullptr) {
+				m_error = true;
+				return nullptr;
+			}
+
+			return bb->opSelect(conditionInstr, onTrueInstr, onFalseInstr);
+		} break;
+		case expr::NodeType::IntegerLiteral: {
+			int value = ((expr::IntegerLiteralNode*)node)->Value;
+			return m_cache->GetConstant(value);
+		} break;
+		case expr::NodeType::FloatLiteral:
+			return m_cache->GetConstant(((expr::FloatLiteralNode*)node)->Value);
+			break;
+		case expr::NodeType::BooleanLiteral:
+			return m_cache->GetConstant(((expr::BooleanLiteralNode*)node)->Value);
+			break;
+		case expr::NodeType::Identifier: {
+			const char* name = ((expr::IdentifierNode*)node)->Name;
+			if (m_opLoads.count(name) == 0)
+				m_opLoads[name] = bb->opLoad(m_vars[name]);
+
+			return m_opLoads[name];
+		} break;
+		case expr::NodeType::UnaryExpression: {
+			expr::UnaryExpressionNode* uexpr = ((expr::UnaryExpressionNode*)node);
+			Instruction* childInstr = m_visit(uexpr->Child);
+
+			if (childInstr == nullptr) {
+				m_error = true;
+				return nullptr;
+			}
+
+			if (childInstr->getType()->getBaseType().isFloat()) {
+				if (uexpr->Operator == '-')
+					return bb->opFNegate(childInstr);
+				else if (uexpr->Operator == expr::TokenType_Increment) {
+					Instruction* ret = bb->opFAdd(childInstr, m_cache->GetConstant(1.0f));
+					if (uexpr->IsPost) return childInstr;
+					else return ret;
+				}
+				else if (uexpr->Operator == expr::TokenType_Decrement) {
+					Instruction* ret = bb->opFSub(childInstr, m_cache->GetConstant(1.0f));
+					if (uexpr->IsPost) return childInstr;
+					else return ret;
+				}
+			}
+			else {
+				if (uexpr->Operator == '-')
+					return bb->opSNegate(childInstr);
+				else if (uexpr->Operator == '!')
+					return bb->opLogicalNot(childInstr);
+				else if (uexpr->Operator == '~')
+					return bb->opNot(childInstr);
+				else if (uexpr->Operator == expr::TokenType_Increment) {
+					Instruction* ret = bb->opIAdd(childInstr, m_cache->GetConstant(1));
+					if (uexpr->IsPost) return childInstr;
+					else return ret;
+				}
+				else if (uexpr->Operator == expr::TokenType_Decrement) {
+					Instruction* ret = bb->opISub(childInstr, m_cache->GetConstant(1));
+					if (uexpr->IsPost) return childInstr;
+					else return ret;
+				}
+			}
+		} break;
+		case expr::NodeType::Cast: {
+			expr::CastNode* cast = (expr::CastNode*)node;
+			Instruction* childInstr = m_visit(cast->Object);
+
+			if (childInstr == nullptr) {
+				m_error = true;
+				return nullptr;
+			}
+
+			switch (cast->Type) {
+			case expr::TokenType_Int:
+			case expr::TokenType_Int2:
+			case expr::TokenType_Int3:
+			case expr::TokenType_Int4: {
+				if (childInstr->getType()->getBaseType().isFloat())
+					return bb->opConvertFToS(childInstr);
+			}break;
+			case expr::TokenType_Uint:
+			case expr::TokenType_Uint2:
+			case expr::TokenType_Uint3:
+			case expr::TokenType_Uint4: {
+				if (childInstr->getType()->getBaseType().isFloat())
+					return bb->opConvertFToU(childInstr);
+			}break;
+			case expr::TokenType_Float:
+			case expr::TokenType_Float2:
+			case expr::TokenType_Float3:
+			case expr::TokenType_Float4: {
+				if (childInstr->getType()->getBaseType().isSInt())
+					return bb->opConvertSToF(childInstr);
+				else if (childInstr->getType()->getBaseType().isUInt())
+					return bb->opConvertUToF(childInstr);
+			}break;
+			}
+
+			return childInstr; // skip unnecessary
+		} break;
+		case expr::NodeType::FunctionCall: {
+			expr::FunctionCallNode* fcall = (expr::FunctionCallNode*)node;
+			int tok = fcall->TokenType;
+			std::string fname(fcall->Name);
+			std::vector<Instruction*> args(fcall->Arguments.size(), nullptr);
+			
+			for (int i = 0; i < args.size(); i++) {
+				args[i] = m_visit(fcall->Arguments[i]);
+				if (args[i] == nullptr) {
+					m_error = true;
+					return nullptr;
+				}
+			}
+
+			// calls to functions defined in the module had their BuiltinID cleared before folding
+			if (fcall->BuiltinID == expr::Builtin_None && tok == expr::TokenType_Identifier) {
+				Function* userFunc = m_index->GetFunction(fname, (int)args.size());
+				if (userFunc == nullptr) {
+					m_error = true;
+					return nullptr;
+				}
+				return m_call(userFunc, args);
+			}
+
+			if (args.size() == 0) {
+				m_error = true;
+				return nullptr;
+			}
+
+			if (tok == expr::TokenType_Int) {
+				if (args[0]->getType()->getBaseType().isFloat())
+					return bb->opConvertFToS(args[0]);
+				return args[0];
+			}
+			else if (tok == expr::TokenType_Uint) {
+				if (args[0]->getType()->getBaseType().isFloat())
+					return bb->opConvertFToU(args[0]);
+				return args[0];
+			}
+			else if (tok == expr::TokenType_Float) {
+				if (args[0]->getType()->getBaseType().isSInt())
+					return bb->opConvertSToF(args[0]);
+				else if (args[0]->getType()->getBaseType().isUInt())
+					return bb->opConvertUToF(args[0]);
+				return args[0];
+			}
+			else if (m_isVector(tok)) 
+				return m_constructVector(m_getBaseType(tok), m_getCompCount(tok), args);
+
+			// the parser only sets BuiltinID when the argument count fits, check again for trees built elsewhere
+			const expr::BuiltinInfo* info = expr::GetBuiltinInfo((expr::Builtin)fcall->BuiltinID);
+			if (info == nullptr || args.size() < info->MinArgs || args.size() > info->MaxArgs) {
+				m_error = true;
+				return nullptr;
+			}
+
+			switch (fcall->BuiltinID) {
+			case expr::Builtin_Round: return bb.ext<ext::GLSL>()->opRound(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_RoundEven: return bb.ext<ext::GLSL>()->opRoundEven(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_Trunc: return bb.ext<ext::GLSL>()->opTrunc(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_Abs:
+				if (args[0]->getType()->getBaseType().isFloat())
+					return bb.ext<ext::GLSL>()->opFAbs(args[0]);
+				else
+					return bb.ext<ext::GLSL>()->opSAbs(args[0]);
+			case expr::Builtin_Sign:
+				if (args[0]->getType()->getBaseType().isFloat())
+					return bb.ext<ext::GLSL>()->opFSign(args[0]);
+				else
+					return bb.ext<ext::GLSL>()->opSSign(args[0]);
+			case expr::Builtin_Floor: return bb.ext<ext::GLSL>()->opFloor(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_Ceil: return bb.ext<ext::GLSL>()->opCeil(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_Fract: return bb.ext<ext::GLSL>()->opFract(m_simpleConvert(expr::TokenType_Float, args[0])); // TODO: HLSL's frac =/= GLSL's fract AFAIK
+			case expr::Builtin_Radians: return bb.ext<ext::GLSL>()->opRadians(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_Degrees: return bb.ext<ext::GLSL>()->opDegrees(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_Sin: return bb.ext<ext::GLSL>()->opSin(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_Cos: return bb.ext<ext::GLSL>()->opCos(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_Tan: return bb.ext<ext::GLSL>()->opTan(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_Asin: return bb.ext<ext::GLSL>()->opASin(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_Acos: return bb.ext<ext::GLSL>()->opACos(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_Atan:
+				if (args.size() == 1)
+					return bb.ext<ext::GLSL>()->opATan(m_simpleConvert(expr::TokenType_Float, args[0]));
+				else
+					return bb.ext<ext::GLSL>()->opAtan2(m_simpleConvert(expr::TokenType_Float, args[0]), m_simpleConvert(expr::TokenType_Float, args[1]));
+			case expr::Builtin_Sinh: return bb.ext<ext::GLSL>()->opSinh(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_Cosh: return bb.ext<ext::GLSL>()->opCosh(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_Tanh: return bb.ext<ext::GLSL>()->opTanh(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_Asinh: return bb.ext<ext::GLSL>()->opAsinh(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_Acosh: return bb.ext<ext::GLSL>()->opAcosh(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_Atanh: return bb.ext<ext::GLSL>()->opAtanh(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_Pow: return bb.ext<ext::GLSL>()->opPow(m_simpleConvert(expr::TokenType_Float, args[0]), m_simpleConvert(expr::TokenType_Float, args[1]));
+			case expr::Builtin_Exp: return bb.ext<ext::GLSL>()->opExp(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_Exp2: return bb.ext<ext::GLSL>()->opExp2(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_Log: return bb.ext<ext::GLSL>()->opLog(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_Log2: return bb.ext<ext::GLSL>()->opLog2(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_Sqrt: return bb.ext<ext::GLSL>()->opSqrt(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_InverseSqrt: return bb.ext<ext::GLSL>()->opInverseSqrt(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_Determinant: return bb.ext<ext::GLSL>()->opDeterminant(args[0]);
+			case expr::Builtin_Inverse: return bb.ext<ext::GLSL>()->opMatrixInverse(args[0]);
+			case expr::Builtin_Min:
+				if (args[0]->getType()->getBaseType().isFloat() || args[1]->getType()->getBaseType().isFloat())
+					return bb.ext<ext::GLSL>()->opFMin(m_simpleConvert(expr::TokenType_Float, args[0]), m_simpleConvert(expr::TokenType_Float, args[1]));
+				else if (args[0]->getType()->getBaseType().isSInt())
+					return bb.ext<ext::GLSL>()->opSMin(m_simpleConvert(expr::TokenType_Int, args[0]), m_simpleConvert(expr::TokenType_Int, args[1]));
+				else if (args[0]->getType()->getBaseType().isUInt())
+					return bb.ext<ext::GLSL>()->opUMin(m_simpleConvert(expr::TokenType_Uint, args[0]), m_simpleConvert(expr::TokenType_Uint, args[1]));
+				break;
+			case expr::Builtin_Max:
+				if (args[0]->getType()->getBaseType().isFloat() || args[1]->getType()->getBaseType().isFloat())
+					return bb.ext<ext::GLSL>()->opFMax(m_simpleConvert(expr::TokenType_Float, args[0]), m_simpleConvert(expr::TokenType_Float, args[1]));
+				else if (args[0]->getType()->getBaseType().isSInt())
+					return bb.ext<ext::GLSL>()->opSMax(m_simpleConvert(expr::TokenType_Int, args[0]), m_simpleConvert(expr::TokenType_Int, args[1]));
+				else if (args[0]->getType()->getBaseType().isUInt())
+					return bb.ext<ext::GLSL>()->opUMax(m_simpleConvert(expr::TokenType_Uint, args[0]), m_simpleConvert(expr::TokenType_Uint, args[1]));
+				break;
+			case expr::Builtin_Clamp:
+				if (args[0]->getType()->getBaseType().isFloat() || args[1]->getType()->getBaseType().isFloat() || args[2]->getType()->getBaseType().isFloat())
+					return bb.ext<ext::GLSL>()->opFClamp(m_simpleConvert(expr::TokenType_Float, args[0]), m_simpleConvert(expr::TokenType_Float, args[1]), m_simpleConvert(expr::TokenType_Float, args[2]));
+				else if (args[0]->getType()->getBaseType().isSInt())
+					return bb.ext<ext::GLSL>()->opSClamp(m_simpleConvert(expr::TokenType_Int, args[0]), m_simpleConvert(expr::TokenType_Int, args[1]), m_simpleConvert(expr::TokenType_Int, args[2]));
+				else if (args[0]->getType()->getBaseType().isUInt())
+					return bb.ext<ext::GLSL>()->opUClamp(m_simpleConvert(expr::TokenType_Uint, args[0]), m_simpleConvert(expr::TokenType_Uint, args[1]), m_simpleConvert(expr::TokenType_Uint, args[2]));
+				break;
+			case expr::Builtin_Mix:
+				if (args[0]->getType()->getBaseType().isFloat() || args[1]->getType()->getBaseType().isFloat() || args[2]->getType()->getBaseType().isFloat())
+					return bb.ext<ext::GLSL>()->opFMix(m_simpleConvert(expr::TokenType_Float, args[0]), m_simpleConvert(expr::TokenType_Float, args[1]), m_simpleConvert(expr::TokenType_Float, args[2]));
+				break;
+			case expr::Builtin_Step: return bb.ext<ext::GLSL>()->opStep(m_simpleConvert(expr::TokenType_Float, args[0]), m_simpleConvert(expr::TokenType_Float, args[1]));
+			case expr::Builtin_SmoothStep: return bb.ext<ext::GLSL>()->opSmoothStep(m_simpleConvert(expr::TokenType_Float, args[0]), m_simpleConvert(expr::TokenType_Float, args[1]), m_simpleConvert(expr::TokenType_Float, args[2]));
+			case expr::Builtin_Fma: return bb.ext<ext::GLSL>()->opFma(m_simpleConvert(expr::TokenType_Float, args[0]), m_simpleConvert(expr::TokenType_Float, args[1]), m_simpleConvert(expr::TokenType_Float, args[2]));
+			case expr::Builtin_Cross: return bb.ext<ext::GLSL>()->opCross(m_simpleConvert(expr::TokenType_Float, args[0]), m_simpleConvert(expr::TokenType_Float, args[1]));
+			case expr::Builtin_Dot: return bb->opDot(m_simpleConvert(expr::TokenType_Float, args[0]), m_simpleConvert(expr::TokenType_Float, args[1]));
+			case expr::Builtin_Length: return bb.ext<ext::GLSL>()->opLength(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_Distance: return bb.ext<ext::GLSL>()->opDistance(m_simpleConvert(expr::TokenType_Float, args[0]), m_simpleConvert(expr::TokenType_Float, args[1]));
+			case expr::Builtin_Normalize: return bb.ext<ext::GLSL>()->opNormalize(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_Any: return bb->opAny(args[0]);
+			case expr::Builtin_All: return bb->opAll(args[0]);
+			case expr::Builtin_Dfdx: return bb->opDPdx(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_Dfdy: return bb->opDPdy(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_Fwidth: return bb->opFwidth(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_DfdxFine: return bb->opDPdxFine(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_DfdyFine: return bb->opDPdyFine(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_FwidthFine: return bb->opFwidthFine(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_DfdxCoarse: return bb->opDPdxCoarse(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_DfdyCoarse: return bb->opDPdyCoarse(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_FwidthCoarse: return bb->opFwidthCoarse(m_simpleConvert(expr::TokenType_Float, args[0]));
+			case expr::Builtin_Texture: return bb->opImageSampleImplictLod(args[0], m_simpleConvert(expr::TokenType_Float, args[1]));
+			default: break;
+			}
+
+			m_error = true;
+			return nullptr;
+		} break;
+		case expr::NodeType::MemberAccess: {
+			expr::MemberAccessNode* maccess = (expr::MemberAccessNode*)node;
+			Instruction* obj = m_visit(maccess->Object);
+			if (obj == nullptr) {
+				m_error = true;
+				return nullptr;
+			}
+			if (obj->getType()->isVector() && maccess->SwizzleCount > 0)
+				return m_swizzle(obj, maccess->Swizzle, maccess->SwizzleCount);
+		} break;
+		case expr::NodeType::MethodCall: {
+			expr::MethodCallNode* mcall = (expr::MethodCallNode*)node;
+			std::string fname(mcall->Name);
+
+			Instruction* obj = m_visit(mcall->Object);
+			std::vector<Instruction*> args(mcall->Arguments.size(), nullptr);
+
+			for (int i = 0; i < args.size(); i++) {
+				args[i] = m_visit(mcall->Arguments[i]);
+				if (args[i] == nullptr) {
+					m_error = true;
+					return nullptr;
+				}
+			}
+
+			// HLSL stuff:
+			if (obj->getType()->isSampledImage()) {
+				if (fname == "Sample" && args.size() > 1)
+					return bb->opImageSampleImplictLod(obj, m_simpleConvert(expr::TokenType_Float, args[1]));
+			}
+		} break;
+		}
+
+		return nullptr;
+	}
+	bool m_isExpensive(expr::Node* a, expr::Node* b)
+	{
+		if (m_branchCost < 0 || expr::UsesDerivatives(a) || expr::UsesDerivatives(b))
+			return false;
+		return std::max(expr::EstimateCost(a), expr::EstimateCost(b)) > m_branchCost;
+	}
+	// if (cond) onTrue else onFalse, merged with OpPhi - a nullptr node stands for the
+	// given constant, which is how && and || skip their right side
+	Instruction* m_branch(Instruction* cond, expr::Node* onTrue, expr::Node* onFalse, Instruction* constant)
+	{
+		BasicBlock& trueBB = m_func.addBasicBlock("$$_true");
+		BasicBlock& falseBB = m_func.addBasicBlock("$$_false");
+		BasicBlock& mergeBB = m_func.addBasicBlock("$$_merge");
+
+		BasicBlock& bb = *m_block;
+		bb->opSelectionMerge(&mergeBB, spv::SelectionControlMask::MaskNone);
+		bb->opBranchConditional(cond, &trueBB, &falseBB);
+
+		BasicBlock* trueEnd = nullptr, * falseEnd = nullptr;
+		Instruction* trueInstr = onTrue ? m_visitBlock(onTrue, trueBB, mergeBB, trueEnd) : m_visitBlock(constant, trueBB, mergeBB, trueEnd);
+		Instruction* falseInstr = onFalse ? m_visitBlock(onFalse, falseBB, mergeBB, falseEnd) : m_visitBlock(constant, falseBB, mergeBB, falseEnd);
+
+		m_block = &mergeBB;
+		if (trueInstr == nullptr || falseInstr == nullptr) {
+			m_error = true;
+			return nullptr;
+		}
+
+		return mergeBB->opPhi(trueInstr, trueEnd, falseInstr, falseEnd);
+	}
+	// emits the node into the block and then jumps to merge - values created in the block
+	// don't dominate the code that comes after it, so they can't be reused afterwards
+	Instruction* m_visitBlock(expr::Node* node, BasicBlock& block, BasicBlock& merge, BasicBlock*& end)
+	{
+		auto visited = m_visited;
+		auto loads = m_opLoads;
+		auto shuffles = m_shuffles;
+
+		m_block = &block;
+		Instruction* ret = m_visit(node);
+		end = m_block; // nested branches end in their own merge block
+		(*m_block)->opBranch(&merge);
+
+		m_visited = std::move(visited);
+		m_opLoads = std::move(loads);
+		m_shuffles = std::move(shuffles);
+
+		return ret;
+	}
+	Instruction* m_visitBlock(Instruction* constant, BasicBlock& block, BasicBlock& merge, BasicBlock*& end)
+	{
+		end = &block;
+		block->opBranch(&merge);
+		return constant;
+	}
+	void m_convert(int op, Instruction* a, Instruction* b, Instruction*& outA, Instruction*& outB)
+	{
+		BasicBlock& bb = *m_block;
+
+		auto aType = a->getType();
+		auto bType = b->getType();
+		auto aBaseType = aType->getBaseType();
+		auto bBaseType = bType->getBaseType();
+
+		outA = a;
+		outB = b;
+
+		if (aBaseType.isFloat() && !bBaseType.isFloat())
+			outB = m_simpleConvert(expr::TokenType_Float, outB);
+		else if (bBaseType.isFloat() && !aBaseType.isFloat())
+			outA = m_simpleConvert(expr::TokenType_Float, outA);
+
+		if (op != '*' || (op == '*' && !bBaseType.isFloat() && !aBaseType.isFloat())) {
+			if (aType->isVector() && !bType->isVector()) {
+				switch (aType->getVectorComponentCount()) {
+				case 2: outB = bb->opCompositeConstruct(a->getTypeInstr(), outB, outB); break;
+				case 3: outB = bb->opCompositeConstruct(a->getTypeInstr(), outB, outB, outB); break;
+				case 4: outB = bb->opCompositeConstruct(a->getTypeInstr(), outB, outB, outB, outB); break;
+				}
+			}
+			else if (bType->isVector() && !aType->isVector()) {
+				switch (aType->getVectorComponentCount()) {
+				case 2: outA = bb->opCompositeConstruct(a->getTypeInstr(), outA, outA); break;
+				case 3: outA = bb->opCompositeConstruct(a->getTypeInstr(), outA, outA, outA); break;
+				case 4: outA = bb->opCompositeConstruct(a->getTypeInstr(), outA, outA, outA, outA); break;
+				}
+			}
+		}
+
+	}
+	Instruction* m_simpleConvert(int type, Instruction* inst)
+	{
+		BasicBlock& bb = *m_block;
+
+		// constants are converted at compile time
+		int constType, constCount;
+		unsigned int bits[4];
+		if (type != expr::TokenType_Bool && m_cache->GetConstantValue(inst, constType, constCount, bits) && constType != type && constType != expr::TokenType_Bool) {
+			for (int i = 0; i < constCount; i++)
+				bits[i] = m_convertConstant(constType, type, bits[i]);
+			return m_cache->GetConstant(type, constCount, bits);
+		}
+
+		if (type == expr::TokenType_Int) {
+			if (inst->getType()->getBaseType().isFloat())
+				return bb->opConvertFToS(inst);
+		}
+		else if (type == expr::TokenType_Uint) {
+			if (inst->getType()->getBaseType().isFloat())
+				return bb->opConvertFToU(inst);
+		}
+		else if (type == expr::TokenType_Float) {
+			if (inst->getType()->getBaseType().isSInt())
+				return bb->opConvertSToF(inst);
+			else if (inst->getType()->getBaseType().isUInt())
+				return bb->opConvertUToF(inst);
+		}
+		return inst;
+	}
+	unsigned int m_convertConstant(int from, int to, unsigned int bits)
+	{
+		float f;
+		memcpy(&f, &bits, sizeof(f));
+
+		unsigned int ret = bits; // int <-> uint keeps the bits
+		if (from == expr::TokenType_Float && to == expr::TokenType_Int)
+			ret = (unsigned int)(int)f;
+		else if (from == expr::TokenType_Float && to == expr::TokenType_Uint)
+			ret = (unsigned int)f;
+		else if (to == expr::TokenType_Float) {
+			f = from == expr::TokenType_Int ? (float)(int)bits : (float)bits;
+			memcpy(&ret, &f, sizeof(f));
+		}
+		return ret;
+	}
+	int m_getBaseType(int type)
+	{
+		switch (type) {
+		case expr::TokenType_Int:
+		case expr::TokenType_Int2:
+		case expr::TokenType_Int3:
+		case expr::TokenType_Int4:
+			return expr::TokenType_Int;
+		case expr::TokenType_Uint:
+		case expr::TokenType_Uint2:
+		case expr::TokenType_Uint3:
+		case expr::TokenType_Uint4:
+			return expr::TokenType_Uint;
+		case expr::TokenType_Bool:
+		case expr::TokenType_Bool2:
+		case expr::TokenType_Bool3:
+		case expr::TokenType_Bool4:
+			return expr::TokenType_Bool;
+		default: break;
+		}
+
+		return expr::TokenType_Float;
+	}
+	int m_getCompCount(int type) {
+		switch (type) {
+		case expr::TokenType_Float4:
+		case expr::TokenType_Bool4:
+		case expr::TokenType_Int4:
+		case expr::TokenType_Uint4:
+			return 4;
+		case expr::TokenType_Float3:
+		case expr::TokenType_Bool3:
+		case expr::TokenType_Int3:
+		case expr::TokenType_Uint3:
+			return 3;
+		case expr::TokenType_Float2:
+		case expr::TokenType_Bool2:
+		case expr::TokenType_Int2:
+		case expr::TokenType_Uint2:
+			return 2;
+		default: break;
+		}
+
+		return 4;
+	}
+	bool m_isVector(int type) {
+		switch (type) {
+		case expr::TokenType_Float4:
+		case expr::TokenType_Bool4:
+		case expr::TokenType_Int4:
+		case expr::TokenType_Uint4:
+		case expr::TokenType_Float3:
+		case expr::TokenType_Bool3:
+		case expr::TokenType_Int3:
+		case expr::TokenType_Uint3:
+		case expr::TokenType_Float2:
+		case expr::TokenType_Bool2:
+		case expr::TokenType_Int2:
+		case expr::TokenType_Uint2:
+			return true;
+		}
+
+		return false;
+	}
+	Instruction* m_call(Function* func, std::vector<Instruction*>& args)
+	{
+		BasicBlock& bb = *m_block;
+		switch (args.size()) {
+		case 0: return bb->call(func);
+		case 1: return bb->call(func, args[0]);
+		case 2: return bb->call(func, args[0], args[1]);
+		case 3: return bb->call(func, args[0], args[1], args[2]);
+		case 4: return bb->call(func, args[0], args[1], args[2], args[3]);
+		default: break;
+		}
+
+		m_error = true;
+		return nullptr;
+	}
+	Instruction* m_constructVector(int baseType, int compCount, std::vector<Instruction*>& comps)
+	{
+		Instruction* baseTypeInstr = m_cache->GetVectorType(baseType, compCount);
+
+		BasicBlock& bb = *m_block;
+
+		// components of vector arguments are kept as (vector, index) pairs as long as they
+		// don't need a conversion, so the whole constructor can end up as one shuffle
+		Instruction* args[4] = { nullptr };
+		Instruction* sources[4] = { nullptr };
+		int indices[4] = { 0 };
+		int curArg = 0;
+		for (int i = 0; i < comps.size() && curArg < 4; i++) {
+			if (comps[i]->getType()->isScalar()) {
+				args[curArg] = m_simpleConvert(baseType, comps[i]);
+				curArg++;
+			} else if (comps[i]->getType()->isVector()) {
+				bool isShuffleable = m_getInstrBaseType(comps[i]) == baseType && !m_isConstant(comps[i]);
+				for (int j = 0; j < comps[i]->getType()->getVectorComponentCount() && curArg < 4; j++) {
+					if (isShuffleable)
+						m_getShuffleSource(comps[i], j, sources[curArg], indices[curArg]);
+					else
+						args[curArg] = m_simpleConvert(baseType, m_extract(comps[i], j));
+					curArg++;
+				}
+			}
+		}
+		if (curArg == 0)
+			return nullptr;
+		for (int i = curArg; i < 4; i++) {
+			args[i] = args[i - 1];
+			sources[i] = sources[i - 1];
+			indices[i] = indices[i - 1];
+		}
+
+		// constant components -> one OpConstantComposite instead of constructing it on every run
+		unsigned int bits[4];
+		bool isConstant = true;
+		for (int i = 0; i < compCount && isConstant; i++) {
+			int constType, constCount;
+			isConstant = args[i] != nullptr && m_cache->GetConstantValue(args[i], constType, constCount, &bits[i]) && constCount == 1;
+		}
+		if (isConstant)
+			return m_cache->GetConstant(baseType, compCount, bits);
+
+		// components that all come from at most two vectors -> OpVectorShuffle
+		bool isShuffle = true;
+		for (int i = 0; i < compCount; i++)
+			isShuffle &= (sources[i] != nullptr);
+		if (isShuffle) {
+			Instruction* ret = m_shuffle(sources, indices, compCount);
+			if (ret != nullptr)
+				return ret;
+		}
+
+		for (int i = 0; i < compCount; i++)
+			if (args[i] == nullptr)
+				args[i] = m_extract(sources[i], indices[i]);
+
+		if (compCount == 2)
+			return bb->opCompositeConstruct(baseTypeInstr, args[0], args[1]);
+		else if (compCount == 3)
+			return bb->opCompositeConstruct(baseTypeInstr, args[0], args[1], args[2]);
+		else if (compCount == 4)
+			return bb->opCompositeConstruct(baseTypeInstr, args[0], args[1], args[2], args[3]);
+
+		return nullptr;
+	}
+	Instruction* m_extract(Instruction* vec, int index)
+	{
+		int constType, constCount;
+		unsigned int bits[4];
+		if (m_cache->GetConstantValue(vec, constType, constCount, bits) && index < constCount)
+			return m_cache->GetConstant(constType, 1, &bits[index]);
+
+		BasicBlock& bb = *m_block;
+		Instruction* source;
+		int sourceIndex;
+		m_getShuffleSource(vec, index, source, sourceIndex);
+		return bb->opCompositeExtract(source, sourceIndex);
+	}
+	Instruction* m_swizzle(Instruction* vec, const int* indices, int count)
+	{
+		int compCount = vec->getType()->getVectorComponentCount();
+		for (int i = 0; i < count; i++)
+			if (indices[i] >= compCount)
+				return nullptr;
+
+		if (count == 1)
+			return m_extract(vec, indices[0]);
+
+		// swizzles of constants are constants
+		int constType, constCount;
+		unsigned int bits[4], swizzled[4];
+		if (m_cache->GetConstantValue(vec, constType, constCount, bits)) {
+			for (int i = 0; i < count; i++)
+				swizzled[i] = bits[indices[i]];
+			return m_cache->GetConstant(constType, count, swizzled);
+		}
+
+		// swizzle of a swizzle shuffles the original vector
+		Instruction* sources[4];
+		int sourceIndices[4];
+		for (int i = 0; i < count; i++)
+			m_getShuffleSource(vec, indices[i], sources[i], sourceIndices[i]);
+
+		return m_shuffle(sources, sourceIndices, count);
+	}
+	// OpVectorShuffle takes two vectors, nullptr if the components come from more than two
+	Instruction* m_shuffle(Instruction** sources, const int* indices, int count)
+	{
+		Instruction* vecs[2] = { sources[0], sources[0] };
+		for (int i = 1; i < count; i++) {
+			if (sources[i] == vecs[0] || sources[i] == vecs[1])
+				continue;
+			if (vecs[1] != vecs[0])
+				return nullptr;
+			vecs[1] = sources[i];
+		}
+
+		// components of the second vector are numbered after the ones of the first vector
+		unsigned int firstCount = vecs[0]->getType()->getVectorComponentCount();
+		unsigned int comps[4];
+		for (int i = 0; i < count; i++)
+			comps[i] = (sources[i] == vecs[0] ? 0 : firstCount) + indices[i];
+
+		// the shuffle is a no-op if it just takes a whole vector as is
+		if (vecs[0] == vecs[1] && count == firstCount) {
+			bool isIdentity = true;
+			for (int i = 0; i < count; i++)
+				isIdentity &= (comps[i] == i);
+			if (isIdentity)
+				return vecs[0];
+		}
+
+		BasicBlock& bb = *m_block;
+		Instruction* ret = nullptr;
+		if (count == 2)
+			ret = bb->opVectorShuffle(vecs[0], vecs[1], comps[0], comps[1]);
+		else if (count == 3)
+			ret = bb->opVectorShuffle(vecs[0], vecs[1], comps[0], comps[1], comps[2]);
+		else if (count == 4)
+			ret = bb->opVectorShuffle(vecs[0], vecs[1], comps[0], comps[1], comps[2], comps[3]);
+
+		if (ret != nullptr) {
+			Shuffle& info = m_shuffles[ret];
+			for (int i = 0; i < count; i++) {
+				info.Sources[i] = sources[i];
+				info.Indices[i] = indices[i];
+			}
+		}
+		return ret;
+	}
+	// follows shuffles back to the vector that the component originally comes from
+	void m_getShuffleSource(Instruction* vec, int index, Instruction*& source, int& sourceIndex)
+	{
+		auto shuffle = m_shuffles.find(vec);
+		if (shuffle != m_shuffles.end()) {
+			source = shuffle->second.Sources[index];
+			sourceIndex = shuffle->second.Indices[index];
+		} else {
+			source = vec;
+			sourceIndex = index;
+		}
+	}
+	bool m_isConstant(Instruction* inst)
+	{
+		int constType, constCount;
+		unsigned int bits[4];
+		return m_cache->GetConstantValue(inst, constType, constCount, bits);
+	}
+	int m_getInstrBaseType(Instruction* inst)
+	{
+		if (inst->getType()->getBaseType().isSInt())
+			return expr::TokenType_Int;
+		else if (inst->getType()->getBaseType().isUInt())
+			return expr::TokenType_Uint;
+		else if (inst->getType()->getBaseType().isBool())
+			return expr::TokenType_Bool;
+		return expr::TokenType_Float;
+	}
+
+private:
+	expr::Node* m_root;
+	Function& m_func;
+	spvgentwo::Module* m_module;
+	const ModuleIndex* m_index;
+	TypeCache* m_cache;
+	Instruction* m_result;
+	BasicBlock* m_block; // code is emitted here, changes when branches are emitted
+	int m_branchCost;
+	IdAllocator* m_ids;
+	std::unordered_map<std::string, Instruction*> m_vars;
+	std::unordered_map<std::string, Instruction*> m_opLoads;
+	std::unordered_map<expr::Node*, Instruction*> m_visited;
+
+	// where the components of the emitted shuffles come from
+	struct Shuffle
+	{
+		Instruction* Sources[4];
+		int Indices[4];
+	};
+	std::unordered_map<Instruction*, Shuffle> m_shuffles;
+
+	bool m_error;
+};
+
+enum class OptimizationPreset
+{
+	None,
+	Fast,			// cheap cleanups for interactive use
+	Performance,	// for results that get cached
+	Size
+};
+
+struct FunctionOptimizationStats
+{
+	std::string Name;
+	size_t InstructionsBefore, InstructionsAfter;
+};
+struct OptimizationStats
+{
+	double Milliseconds;
+	size_t InstructionsBefore, InstructionsAfter; // summed over the immediate functions
+	std::vector<FunctionOptimizationStats> Functions;
+	bool IsApplied; // false if the optimizer failed or removed one of the result IDs
+};
+
+// runs spirv-tools over a compiled module - result IDs are checked afterwards and the
+// unoptimized binary is kept if the optimizer removed or replaced any of them
+class OptimizerStage
+{
+public:
+	static bool Run(OptimizationPreset preset, std::vector<unsigned int>& binary, const std::vector<int>& resultIds, OptimizationStats& stats)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		std::unordered_set<unsigned int> ids;
+		std::map<std::string, size_t> before;
+		m_parse(binary, ids, before);
+		m_setCounts(stats, before, before);
+		stats.IsApplied = false;
+
+		// the passes only visit functions that are reachable from an entry point, which the immediate
+		// functions aren't - the copy that gets optimized has a temporary entry point for each of them.
+		// Without an entry point to copy from there's nothing the passes could do for them
+		std::vector<unsigned int> input = binary;
+		if (preset != OptimizationPreset::None && m_addEntryPoints(input)) {
+			// the immediate functions don't store their results anywhere, so anything that
+			// removes unused results can't be part of these
+			spvtools::Optimizer opt(SPV_ENV_UNIVERSAL_1_3);
+			if (preset == OptimizationPreset::Performance || preset == OptimizationPreset::Size) {
+				opt.RegisterPass(spvtools::CreateCCPPass());
+				opt.RegisterPass(spvtools::CreateRedundancyEliminationPass());
+			}
+			opt.RegisterPass(spvtools::CreateSimplificationPass());
+			opt.RegisterPass(spvtools::CreateDeadBranchElimPass());
+			opt.RegisterPass(spvtools::CreateBlockMergePass());
+			if (preset == OptimizationPreset::Size)
+				opt.RegisterPass(spvtools::CreateRemoveDuplicatesPass());
+
+			std::vector<unsigned int> optimized;
+			if (opt.Run(input.data(), input.size(), &optimized)) {
+				m_removeEntryPoints(optimized);
+
+				std::unordered_set<unsigned int> optimizedIds;
+				std::map<std::string, size_t> after;
+				bool hasResults = m_parse(optimized, optimizedIds, after) > 0;
+				for (int id : resultIds)
+					hasResults &= (id < 0 || optimizedIds.count(id) > 0);
+
+				if (hasResults) {
+					binary = std::move(optimized);
+					m_setCounts(stats, before, after);
+					stats.IsApplied = true;
+				}
+			}
+		}
+
+		stats.Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		return stats.IsApplied;
+	}
+
+private:
+	static constexpr const char* ImmediatePrefix = "$$_shadered_immediate";
+
+	static bool m_isImmediate(const std::string& name)
+	{
+		return name.compare(0, strlen(ImmediatePrefix), ImmediatePrefix) == 0;
+	}
+	// literal strings are nul terminated and padded to whole words
+	static std::string m_decodeString(const unsigned int* words, size_t count)
+	{
+		std::string ret;
+		for (size_t i = 0; i < count * 4; i++) {
+			char c = (char)(words[i / 4] >> (8 * (i % 4)));
+			if (c == 0)
+				break;
+			ret += c;
+		}
+		return ret;
+	}
+	static void m_encodeString(const std::string& str, std::vector<unsigned int>& out)
+	{
+		size_t start = out.size();
+		out.resize(start + str.size() / 4 + 1, 0);
+		for (size_t i = 0; i < str.size(); i++)
+			out[start + i / 4] |= (unsigned int)(unsigned char)str[i] << (8 * (i % 4));
+	}
+
+	// every immediate function gets an OpEntryPoint with the execution model, modes and interface
+	// of the module's first entry point - false if there's no entry point or no immediate function
+	static bool m_addEntryPoints(std::vector<unsigned int>& binary)
+	{
+		std::vector<unsigned int> entry;
+		std::vector<std::vector<unsigned int>> modes;
+		std::vector<std::pair<unsigned int, std::string>> immediates;
+		size_t entryEnd = 0, modeEnd = 0;
+
+		for (size_t i = 5; i < binary.size();) {
+			unsigned int count = binary[i] >> 16, op = binary[i] & 0xFFFF;
+			if (count == 0 || i + count > binary.size())
+				return false;
+
+			if (op == (unsigned int)spv::Op::OpEntryPoint) {
+				if (entry.empty())
+					entry.assign(binary.begin() + i, binary.begin() + i + count);
+				entryEnd = i + count;
+			} else if (op == (unsigned int)spv::Op::OpExecutionMode) {
+				if (!entry.empty() && binary[i + 1] == entry[2])
+					modes.emplace_back(binary.begin() + i, binary.begin() + i + count);
+				modeEnd = i + count;
+			} else if (op == (unsigned int)spv::Op::OpName && count > 2) {
+				std::string name = m_decodeString(&binary[i + 2], count - 2);
+				if (m_isImmediate(name))
+					immediates.push_back({ binary[i + 1], name });
+			} else if (op == (unsigned int)spv::Op::OpFunction)
+				break; // debug names come before the first function
+
+			i += count;
+		}
+		if (entry.size() < 4 || immediates.empty())
+			return false;
+
+		size_t nameWords = m_decodeString(&entry[3], entry.size() - 3).size() / 4 + 1;
+		std::vector<unsigned int> interfaceIds(entry.begin() + std::min(entry.size(), 3 + nameWords), entry.end());
+
+		std::vector<unsigned int> entries, entryModes;
+		for (const auto& immediate : immediates) {
+			size_t start = entries.size();
+			entries.push_back(0);
+			entries.push_back(entry[1]);
+			entries.push_back(immediate.first);
+			m_encodeString(immediate.second, entries);
+			entries.insert(entries.end(), interfaceIds.begin(), interfaceIds.end());
+			entries[start] = ((unsigned int)(entries.size() - start) << 16) | (unsigned int)spv::Op::OpEntryPoint;
+
+			for (std::vector<unsigned int> mode : modes) {
+				mode[1] = immediate.first;
+				entryModes.insert(entryModes.end(), mode.begin(), mode.end());
+			}
+		}
+
+		// the layout wants all entry points before the execution modes
+		binary.insert(binary.begin() + (modeEnd ? modeEnd : entryEnd), entryModes.begin(), entryModes.end());
+		binary.insert(binary.begin() + entryEnd, entries.begin(), entries.end());
+		return true;
+	}
+	static void m_removeEntryPoints(std::vector<unsigned int>& binary)
+	{
+		std::unordered_set<unsigned int> functions;
+		std::vector<unsigned int> ret(binary.begin(), binary.begin() + std::min<size_t>(5, binary.size()));
+
+		for (size_t i = 5; i < binary.size();) {
+			unsigned int count = binary[i] >> 16, op = binary[i] & 0xFFFF;
+			if (count == 0 || i + count > binary.size())
+				return;
+
+			bool isTemporary = false;
+			if (op == (unsigned int)spv::Op::OpEntryPoint && count > 3 && m_isImmediate(m_decodeString(&binary[i + 3], count - 3))) {
+				functions.insert(binary[i + 2]);
+				isTemporary = true;
+			} else if (op == (unsigned int)spv::Op::OpExecutionMode && count > 1)
+				isTemporary = functions.count(binary[i + 1]) > 0;
+
+			if (!isTemporary)
+				ret.insert(ret.end(), binary.begin() + i, binary.begin() + i + count);
+			i += count;
+		}
+		binary = std::move(ret);
+	}
+
+	static void m_setCounts(OptimizationStats& stats, const std::map<std::string, size_t>& before, const std::map<std::string, size_t>& after)
+	{
+		stats.InstructionsBefore = stats.InstructionsAfter = 0;
+		stats.Functions.clear();
+		for (const auto& pair : before) {
+			auto it = after.find(pair.first);
+			size_t count = it == after.end() ? 0 : it->second;
+			stats.Functions.push_back({ pair.first, pair.second, count });
+			stats.InstructionsBefore += pair.second;
+			stats.InstructionsAfter += count;
+		}
+	}
+
+	// returns the number of instructions and collects the result IDs, 0 if the binary is invalid.
+	// counts has the number of instructions in each immediate function, by name
+	static size_t m_parse(const std::vector<unsigned int>& binary, std::unordered_set<unsigned int>& ids, std::map<std::string, size_t>& counts)
+	{
+		struct Data
+		{
+			size_t Count;
+			std::unordered_set<unsigned int>* IDs;
+			std::unordered_map<unsigned int, std::string> Names;
+			std::unordered_map<unsigned int, size_t> FunctionCounts;
+			unsigned int Function;
+		} data = { 0, &ids, {}, {}, 0 };
+
+		spv_context context = spvContextCreate(SPV_ENV_UNIVERSAL_1_3);
+		spv_result_t result = spvBinaryParse(context, &data, binary.data(), binary.size(), nullptr,
+			[](void* userData, const spv_parsed_instruction_t* inst) -> spv_result_t {
+				Data* data = (Data*)userData;
+				data->Count++;
+				if (inst->result_id != 0)
+					data->IDs->insert(inst->result_id);
+
+				if (inst->opcode == (uint16_t)spv::Op::OpName && inst->num_words > 2) {
+					std::string name = m_decodeString(inst->words + 2, inst->num_words - 2);
+					if (m_isImmediate(name))
+						data->Names[inst->words[1]] = name;
+				} else if (inst->opcode == (uint16_t)spv::Op::OpFunction)
+					data->Function = inst->result_id;
+
+				if (data->Function != 0)
+					data->FunctionCounts[data->Function]++;
+				if (inst->opcode == (uint16_t)spv::Op::OpFunctionEnd)
+					data->Function = 0;
+				return SPV_SUCCESS;
+			}, nullptr);
+		spvContextDestroy(context);
+
+		counts.clear();
+		for (const auto& pair : data.Names)
+			counts[pair.second] = data.FunctionCounts[pair.first];
+
+		return result == SPV_SUCCESS ? data.Count : 0;
+	}
+};
+
+// reads a module from memory instead of a file
+class BinaryMemoryReader : public IReader
+{
+public:
+	BinaryMemoryReader(const unsigned int* words, size_t count)
+	{
+		m_words = words;
+		m_count = count;
+		m_pos = 0;
+	}
+
+	bool get(unsigned int& word) override
+	{
+		if (m_pos >= m_count)
+			return false;
+		word = m_words[m_pos++];
+		return true;
+	}
+
+private:
+	const unsigned int* m_words;
+	size_t m_count, m_pos;
+};
+
+// directory of compiled results that survives between runs - every entry is one file named
+// after its key. Files are written to a temporary name first and then renamed, so readers
+// never see half written entries. Loading an entry updates its write time, and once the
+// directory grows over the size cap the entries that weren't used for the longest get removed.
+// The directory is only walked once on construction and again when the running total
+// of the stored sizes goes over the cap
+class ExpressionCache
+{
+public:
+	ExpressionCache(const std::string& directory, size_t maxSize = 64 * 1024 * 1024)
+	{
+		m_dir = directory;
+		m_maxSize = maxSize;
+		m_hits = m_misses = 0;
+
+		std::error_code ec;
+		std::filesystem::create_directories(m_dir, ec);
+
+		std::vector<Entry> entries;
+		m_totalSize = m_scan(entries);
+	}
+
+	static uint64_t Hash(const void* data, size_t size, uint64_t seed = 14695981039346656037ull)
+	{
+		// FNV-1a
+		const unsigned char* bytes = (const unsigned char*)data;
+		for (size_t i = 0; i < size; i++)
+			seed = (seed ^ bytes[i]) * 1099511628211ull;
+		return seed;
+	}
+
+	bool Load(uint64_t key, std::vector<unsigned int>& data)
+	{
+		std::filesystem::path path = m_getPath(key);
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file.is_open())
+			return m_miss();
+
+		size_t size = (size_t)file.tellg();
+		if (size < sizeof(Header) || (size - sizeof(Header)) % sizeof(unsigned int) != 0)
+			return m_miss();
+
+		Header header;
+		file.seekg(0);
+		file.read((char*)&header, sizeof(Header));
+
+		data.resize((size - sizeof(Header)) / sizeof(unsigned int));
+		file.read((char*)data.data(), data.size() * sizeof(unsigned int));
+		file.close();
+
+		if (header.Magic != Magic || header.Key != key || header.Checksum != Hash(data.data(), data.size() * sizeof(unsigned int)))
+			return m_miss();
+
+		std::error_code ec;
+		std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+
+		m_hits++;
+		expr::CountEvent(expr::Counter::CacheHits);
+		return true;
+	}
+	bool Store(uint64_t key, const std::vector<unsigned int>& data)
+	{
+		Header header;
+		header.Magic = Magic;
+		header.Key = key;
+		header.Checksum = Hash(data.data(), data.size() * sizeof(unsigned int));
+
+		// unique per thread so that sessions sharing the directory don't write into the same file
+		std::filesystem::path path = m_getPath(key);
+		std::filesystem::path temp = path;
+		temp += ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+		std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return false;
+		file.write((const char*)&header, sizeof(Header));
+		file.write((const char*)data.data(), data.size() * sizeof(unsigned int));
+		file.close();
+
+		std::error_code ec;
+		if (file.fail()) {
+			std::filesystem::remove(temp, ec);
+			return false;
+		}
+
+		// an entry that gets replaced no longer counts towards the total
+		uintmax_t oldSize = std::filesystem::file_size(path, ec);
+		if (ec)
+			oldSize = 0;
+		std::filesystem::rename(temp, path, ec);
+		if (ec) {
+			std::filesystem::remove(temp, ec);
+			return false;
+		}
+
+		uintmax_t newSize = sizeof(Header) + data.size() * sizeof(unsigned int);
+		m_totalSize += newSize;
+		m_totalSize -= std::min(oldSize, m_totalSize);
+		if (m_totalSize > m_maxSize)
+			m_evict();
+		return true;
+	}
+
+	inline size_t GetHitCount() { return m_hits; }
+	inline size_t GetMissCount() { return m_misses; }
+
+private:
+	static const unsigned int Magic = 0x43505845; // "EXPC"
+
+	struct Header
+	{
+		unsigned int Magic;
+		uint64_t Key;
+		uint64_t Checksum;
+	};
+	struct Entry
+	{
+		std::filesystem::path Path;
+		std::filesystem::file_time_type Time;
+		uintmax_t Size;
+	};
+
+	std::filesystem::path m_getPath(uint64_t key)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+		return std::filesystem::path(m_dir) / name;
+	}
+	bool m_miss()
+	{
+		m_misses++;
+		expr::CountEvent(expr::Counter::CacheMisses);
+		return false;
+	}
+	uintmax_t m_scan(std::vector<Entry>& entries)
+	{
+		std::error_code ec;
+		uintmax_t total = 0;
+		for (const auto& file : std::filesystem::directory_iterator(m_dir, ec)) {
+			if (!file.is_regular_file(ec) || file.path().extension() != ".bin")
+				continue;
+
+			Entry entry = { file.path(), file.last_write_time(ec), file.file_size(ec) };
+			if (ec)
+				continue;
+			total += entry.Size;
+			entries.push_back(entry);
+		}
+		return total;
+	}
+	void m_evict()
+	{
+		// rescan instead of trusting the running total - other sessions might share the directory
+		std::vector<Entry> entries;
+		uintmax_t total = m_scan(entries);
+
+		if (total > m_maxSize) {
+			std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+				return a.Time < b.Time;
+			});
+
+			std::error_code ec;
+			for (size_t i = 0; i < entries.size() && total > m_maxSize; i++)
+				if (std::filesystem::remove(entries[i].Path, ec))
+					total -= entries[i].Size;
+		}
+
+		m_totalSize = total;
+	}
+
+	std::string m_dir;
+	size_t m_maxSize;
+	size_t m_hits, m_misses;
+	uintmax_t m_totalSize;
+};
+
+// loads and indexes the shader module once - watch expressions are then compiled into it,
+// each one as its own function, and removed again once they aren't needed anymore
+class CompileSession
+{
+public:
+	CompileSession(IAllocator* alloc, ILogger* logger) :
+		m_grammar(alloc),
+		m_module(alloc, spv::Version, logger),
+		m_index(&m_module),
+		m_cache(&m_module),
+		m_ids(&m_module)
+	{
+		m_nextHandle = 0;
+		m_threadCount = 1;
+		m_diskCache = nullptr;
+		m_isHashValid = false;
+		m_moduleHash = 0;
+	}
+
+	// compiled batches get stored in and loaded from the cache, nullptr disables it
+	inline void SetCache(ExpressionCache* cache) { m_diskCache = cache; }
+
+	// expressions of a batch get parsed and folded on this many threads - code is always
+	// emitted on the calling thread in the order of the batch, so the module doesn't
+	// depend on the thread count
+	inline void SetThreadCount(int count) { m_threadCount = std::max(count, 1); }
+
+	bool Load(const char* filename)
+	{
+		m_error = "";
+
+		BinaryFileReader reader(filename);
+		return m_load(reader);
+	}
+	bool Load(const std::vector<unsigned int>& binary)
+	{
+		m_error = "";
+
+		BinaryMemoryReader reader(binary.data(), binary.size());
+		return m_load(reader);
+	}
+
+	// returns a handle to the compiled expression or -1 on error
+	int Compile(const std::string& expression)
+	{
+		return CompileBatch({ expression });
+	}
+
+	// compiles a whole watch list into one function - loads and common subexpressions are
+	// shared between the expressions, so evaluating the list is a single call. The handle
+	// stays valid if only some of the expressions fail, their result IDs are -1. Setting
+	// cancel from another thread stops the compile before the next phase
+	int CompileBatch(const std::vector<std::string>& expressions, const std::atomic<bool>* cancel = nullptr)
+	{
+		m_error = "";
+
+		// the module after the compile depends on the module before it, the expressions
+		// and the function name (which has the handle in it)
+		uint64_t key = 0;
+		if (m_diskCache != nullptr) {
+			key = m_getModuleHash();
+			key = ExpressionCache::Hash(&m_nextHandle, sizeof(m_nextHandle), key);
+			for (const auto& e : expressions)
+				key = m_hashExpression(e, key);
+
+			int handle = m_loadCached(key);
+			if (handle >= 0)
+				return handle;
+		}
+
+		std::vector<expr::Parser*> parsers;
+		for (const auto& e : expressions)
+			parsers.push_back(new expr::Parser(e.c_str(), e.size()));
+
+		std::vector<expr::Node*> roots(parsers.size(), nullptr);
+		m_parse(parsers, roots, cancel);
+
+		std::unordered_map<std::string, Instruction*> vars;
+		for (size_t i = 0; i < parsers.size() && !m_isCancelled(cancel); i++)
+			roots[i] = m_resolve(*parsers[i], roots[i], vars);
+
+		if (!parsers.empty() && !m_isCancelled(cancel))
+			expr::Optimizer(*parsers[0]).EliminateCommonSubexpressions(roots);
+
+		// nothing has been added to the module up to this point
+		if (m_isCancelled(cancel)) {
+			m_freeParsers(parsers);
+			m_error = "";
+			m_fail("cancelled");
+			return -1;
+		}
+
+		int handle = m_nextHandle++;
+		std::string funcName = "$$_shadered_immediate_" + std::to_string(handle);
+
+		Compiler comp(&m_module, &m_index, &m_cache, nullptr, funcName.c_str());
+		comp.SetIdAllocator(&m_ids);
+		for (const auto& pair : vars)
+			comp.SetVariable(pair.first, pair.second);
+
+		std::vector<Instruction*> results;
+		bool success = comp.Compile(roots, results);
+
+		m_freeParsers(parsers);
+
+		if (!success) {
+			m_module.removeFunction(&comp.GetFunction());
+			m_isHashValid = false;
+			m_fail("failed to compile the expression");
+			return -1;
+		}
+
+		m_expressions[handle] = { &comp.GetFunction(), results, funcName };
+		m_isHashValid = false;
+
+		if (m_diskCache != nullptr)
+			m_storeCached(key, handle);
+
+		return handle;
+	}
+
+	bool Remove(int handle)
+	{
+		auto it = m_expressions.find(handle);
+		if (it == m_expressions.end())
+			return false;
+
+		m_module.removeFunction(it->second.Func);
+		m_expressions.erase(it);
+		m_isHashValid = false;
+
+		return true;
+	}
+
+	int GetResultId(int handle, int index = 0)
+	{
+		auto it = m_expressions.find(handle);
+		if (it == m_expressions.end() || index < 0 || index >= it->second.Results.size())
+			return -1;
+
+		Instruction* result = it->second.Results[index];
+		if (result == nullptr)
+			return -1;
+
+		return (int)result->getResultId();
+	}
+
+	// the optimizer works on the whole binary, the module itself is left as is
+	void GetBinary(std::vector<unsigned int>& out, OptimizationPreset preset = OptimizationPreset::None, OptimizationStats* stats = nullptr)
+	{
+		out.clear();
+		BinaryVectorWriter writer(out);
+		m_module.write(&writer);
+
+		// spvgentwo only updates the ID bound in the header (word 3) in assignIDs()
+		if (out.size() > 3)
+			out[3] = m_ids.GetBound();
+
+		if (preset != OptimizationPreset::None || stats != nullptr) {
+			std::vector<int> resultIds;
+			for (const auto& expr : m_expressions)
+				for (Instruction* result : expr.second.Results)
+					if (result != nullptr)
+						resultIds.push_back((int)result->getResultId());
+
+			OptimizationStats localStats;
+			OptimizerStage::Run(preset, out, resultIds, stats ? *stats : localStats);
+		}
+	}
+
+	inline Module& GetModule() { return m_module; }
+	inline const std::string& ErrorMessage() { return m_error; }
+
+private:
+	struct Expression
+	{
+		Function* Func;
+		std::vector<Instruction*> Results;
+		std::string Name;
+	};
+
+	// parses and folds the expressions - parsers don't share any state, so every thread
+	// just takes the next expression that nobody has started on yet
+	void m_parse(std::vector<expr::Parser*>& parsers, std::vector<expr::Node*>& roots, const std::atomic<bool>* cancel)
+	{
+		std::atomic<size_t> next(0);
+		auto worker = [&]() {
+			for (size_t i = next++; i < parsers.size() && !m_isCancelled(cancel); i = next++) {
+				expr::Node* root = parsers[i]->Parse();
+				if (!parsers[i]->Error()) {
+					m_bindFunctions(root);
+					roots[i] = expr::Optimizer(*parsers[i]).Fold(root);
+				}
+			}
+		};
+
+		int threadCount = std::min(m_threadCount, (int)parsers.size());
+		std::vector<std::thread> threads;
+		for (int i = 1; i < threadCount; i++)
+			threads.emplace_back(worker);
+		worker();
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+
+	// functions defined in the module take priority over builtins with the same name, so
+	// the passes that fold and simplify builtins have to leave those calls alone
+	void m_bindFunctions(expr::Node* root)
+	{
+		std::vector<expr::Node*> stack = { root }, children;
+		while (!stack.empty()) {
+			expr::Node* node = stack.back();
+			stack.pop_back();
+			if (node == nullptr)
+				continue;
+
+			if (node->GetNodeType() == expr::NodeType::FunctionCall) {
+				expr::FunctionCallNode* fcall = (expr::FunctionCallNode*)node;
+				if (fcall->TokenType == expr::TokenType_Identifier && m_index.GetFunction(fcall->Name, (int)fcall->Arguments.size()) != nullptr)
+					fcall->BuiltinID = expr::Builtin_None;
+			}
+
+			children.clear();
+			expr::GetChildren(node, children);
+			stack.insert(stack.end(), children.begin(), children.end());
+		}
+	}
+
+	void m_freeParsers(std::vector<expr::Parser*>& parsers)
+	{
+		for (expr::Parser* parser : parsers) {
+			parser->Clear();
+			delete parser;
+		}
+		parsers.clear();
+	}
+	static bool m_isCancelled(const std::atomic<bool>* cancel)
+	{
+		return cancel != nullptr && cancel->load(std::memory_order_relaxed);
+	}
+
+	// resolves the variables of a parsed expression, nullptr on error
+	expr::Node* m_resolve(expr::Parser& parser, expr::Node* root, std::unordered_map<std::string, Instruction*>& vars)
+	{
+		if (parser.Error()) {
+			m_fail(parser.ErrorMessage().c_str());
+			return nullptr;
+		}
+
+		// variables that were folded away don't have to exist in the module
+		std::vector<std::string> names;
+		expr::GetVariables(root, names);
+		for (const std::string& name : names) {
+			Instruction* var = m_index.GetVariable(name);
+			if (var == nullptr) {
+				m_fail(("missing variable: " + name).c_str());
+				return nullptr;
+			}
+			vars[name] = var;
+		}
+
+		return root;
+	}
+	// tokens instead of the source, so that whitespace and the way literals are written don't matter
+	uint64_t m_hashExpression(const std::string& expression, uint64_t seed)
+	{
+		expr::Tokenizer tokenizer(expression.c_str(), expression.size());
+		while (tokenizer.Next()) {
+			int type = tokenizer.GetTokenType();
+			seed = ExpressionCache::Hash(&type, sizeof(type), seed);
+
+			if (type == expr::TokenType_FloatLiteral) {
+				float value = tokenizer.GetFloatValue();
+				seed = ExpressionCache::Hash(&value, sizeof(value), seed);
+			} else if (type == expr::TokenType_IntegerLiteral || type == expr::TokenType_BooleanLiteral) {
+				int value = tokenizer.GetIntValue();
+				seed = ExpressionCache::Hash(&value, sizeof(value), seed);
+			} else if (type == expr::TokenType_Identifier) {
+				const char* name = tokenizer.GetIdentifier();
+				seed = ExpressionCache::Hash(name, strlen(name), seed);
+			}
+		}
+
+		// separates the expressions of a batch
+		int end = 0;
+		return ExpressionCache::Hash(&end, sizeof(end), seed);
+	}
+	uint64_t m_getModuleHash()
+	{
+		if (!m_isHashValid) {
+			std::vector<unsigned int> binary;
+			GetBinary(binary);
+			m_moduleHash = ExpressionCache::Hash(binary.data(), binary.size() * sizeof(unsigned int));
+			m_isHashValid = true;
+		}
+		return m_moduleHash;
+	}
+
+	// entries hold the number of results, the result IDs and then the whole module
+	void m_storeCached(uint64_t key, int handle)
+	{
+		const Expression& expr = m_expressions[handle];
+
+		std::vector<unsigned int> binary;
+		GetBinary(binary);
+
+		std::vector<unsigned int> data;
+		data.push_back((unsigned int)expr.Results.size());
+		for (Instruction* result : expr.Results)
+			data.push_back(result ? result->getResultId() : 0);
+		data.insert(data.end(), binary.begin(), binary.end());
+
+		m_diskCache->Store(key, data);
+
+		m_moduleHash = ExpressionCache::Hash(binary.data(), binary.size() * sizeof(unsigned int));
+		m_isHashValid = true;
+	}
+	int m_loadCached(uint64_t key)
+	{
+		std::vector<unsigned int> data;
+		if (!m_diskCache->Load(key, data) || data.empty() || data.size() <= (size_t)data[0] + 1)
+			return -1;
+
+		unsigned int resultCount = data[0];
+		const unsigned int* binary = data.data() + resultCount + 1;
+		size_t binarySize = data.size() - resultCount - 1;
+
+		// the module gets replaced, so every instruction pointer has to be looked up again
+		std::unordered_map<int, std::vector<unsigned int>> oldIds;
+		for (const auto& expr : m_expressions)
+			for (Instruction* result : expr.second.Results)
+				oldIds[expr.first].push_back(result ? result->getResultId() : 0);
+
+		int handle = m_nextHandle++;
+		m_expressions[handle] = { nullptr, {}, "$$_shadered_immediate_" + std::to_string(handle) };
+		oldIds[handle] = std::vector<unsigned int>(data.begin() + 1, data.begin() + 1 + resultCount);
+
+		m_module.reset();
+		BinaryMemoryReader reader(binary, binarySize);
+		bool success = m_module.read(&reader, m_grammar);
+		if (success) {
+			m_module.resolveIDs();
+			m_module.reconstructTypeAndConstantInfo();
+			m_module.reconstructNames();
+		}
+		m_index.Build();
+		m_cache.Clear();
+		m_ids.SetBound(binarySize > 3 ? binary[3] : 1);
+
+		for (auto& expr : m_expressions) {
+			expr.second.Func = m_index.GetFunction(expr.second.Name);
+			expr.second.Results.clear();
+			if (expr.second.Func == nullptr) {
+				success = false;
+				continue;
+			}
+
+			std::unordered_map<unsigned int, Instruction*> instructions;
+			for (BasicBlock& bb : *expr.second.Func)
+				for (Instruction& inst : bb)
+					instructions[inst.getResultId()] = &inst;
+
+			for (unsigned int id : oldIds[expr.first]) {
+				auto it = instructions.find(id);
+				expr.second.Results.push_back((id == 0 || it == instructions.end()) ? nullptr : it->second);
+			}
+		}
+
+		// the entry passed the checksum, so this only happens if the cache was written by
+		// something else - the old module is gone at this point
+		if (!success) {
+			m_expressions.clear();
+			m_isHashValid = false;
+			m_fail("failed to load the cached module");
+			return -1;
+		}
+
+		m_moduleHash = ExpressionCache::Hash(binary, binarySize * sizeof(unsigned int));
+		m_isHashValid = true;
+		return handle;
+	}
+	bool m_load(IReader& reader)
+	{
+		if (!m_module.read(&reader, m_grammar))
+			return m_fail("failed to read the shader module");
+
+		m_module.resolveIDs();
+		m_module.reconstructTypeAndConstantInfo();
+		m_module.reconstructNames();
+
+		// GLSL builtins (bb.ext<ext::GLSL>()) add the OpExtInstImport on first use, which Assign()
+		// wouldn't number - modules that don't import GLSL.std.450 yet (DXC output) get it here so
+		// that Reset() gives it an ID. Cached binaries are written from these modules and have it too
+		m_module.getExtensionInstructionImport("GLSL.std.450");
+
+		m_index.Build();
+		m_cache.Clear();
+		m_ids.Reset();
+		m_isHashValid = false;
+
+		return true;
+	}
+	bool m_fail(const char* msg)
+	{
+		if (m_error.empty())
+			m_error = msg;
+		return false;
+	}
+
+	Grammar m_grammar;
+	Module m_module;
+	ModuleIndex m_index;
+	TypeCache m_cache;
+	IdAllocator m_ids;
+
+	std::unordered_map<int, Expression> m_expressions;
+	int m_nextHandle;
+	int m_threadCount;
+
+	ExpressionCache* m_diskCache;
+	uint64_t m_moduleHash;
+	bool m_isHashValid;
+
+	std::string m_error;
+};
+
+struct AsyncCompileResult
+{
+	int Handle;					// -1 if the compile failed or was cancelled
+	std::vector<int> ResultIds;	// one per expression
+	bool IsCancelled;
+	std::string Error;
+};
+
+// compiles on a background thread so that typing doesn't wait for the compiler - every
+// watch slot holds one compiled batch, and submitting new text for a slot cancels whatever
+// is still queued or running for it. The session must only be used through the queue
+// (see Execute) while the queue exists
+class AsyncCompileQueue
+{
+public:
+	AsyncCompileQueue(CompileSession* session)
+	{
+		m_session = session;
+		m_isRunning = true;
+		m_thread = std::thread([this]() { m_run(); });
+	}
+	~AsyncCompileQueue()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (auto& slot : m_slots)
+				slot.second->store(true);
+			m_isRunning = false;
+		}
+		m_condition.notify_one();
+		m_thread.join();
+	}
+
+	// the previous batch of the slot gets removed from the module once this one compiles
+	std::future<AsyncCompileResult> Submit(int slot, const std::vector<std::string>& expressions)
+	{
+		auto cancel = std::make_shared<std::atomic<bool>>(false);
+		auto promise = std::make_shared<std::promise<AsyncCompileResult>>();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto it = m_slots.find(slot);
+			if (it != m_slots.end())
+				it->second->store(true);
+			m_slots[slot] = cancel;
+
+			m_queue.push_back([this, slot, expressions, cancel, promise]() {
+				promise->set_value(m_compile(slot, expressions, *cancel));
+			});
+		}
+		m_condition.notify_one();
+
+		return promise->get_future();
+	}
+
+	// runs func(session) on the background thread, in order with the compiles
+	template<typename F>
+	auto Execute(F func) -> std::future<decltype(func(std::declval<CompileSession&>()))>
+	{
+		using Result = decltype(func(std::declval<CompileSession&>()));
+
+		auto task = std::make_shared<std::packaged_task<Result()>>([this, func]() { return func(*m_session); });
+		std::future<Result> future = task->get_future();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_queue.push_back([task]() { (*task)(); });
+		}
+		m_condition.notify_one();
+
+		return future;
+	}
+
+private:
+	// only ever called on the background thread
+	AsyncCompileResult m_compile(int slot, const std::vector<std::string>& expressions, const std::atomic<bool>& cancel)
+	{
+		AsyncCompileResult result = { -1, {}, false, "" };
+		if (!cancel.load()) {
+			result.Handle = m_session->CompileBatch(expressions, &cancel);
+			if (result.Handle < 0)
+				result.Error = m_session->ErrorMessage();
+		}
+
+		// compiles that finished after a newer one was submitted are thrown away as well
+		if (cancel.load()) {
+			if (result.Handle >= 0)
+				m_session->Remove(result.Handle);
+			result = { -1, {}, true, "cancelled" };
+			return result;
+		}
+
+		if (result.Handle >= 0) {
+			auto old = m_handles.find(slot);
+			if (old != m_handles.end())
+				m_session->Remove(old->second);
+			m_handles[slot] = result.Handle;
+
+			for (size_t i = 0; i < expressions.size(); i++)
+				result.ResultIds.push_back(m_session->GetResultId(result.Handle, (int)i));
+		}
+
+		return result;
+	}
+	void m_run()
+	{
+		while (true) {
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_condition.wait(lock, [this]() { return !m_isRunning || !m_queue.empty(); });
+
+				// cancelled compiles are cheap, so the queue is always drained
+				if (m_queue.empty())
+					return;
+				job = std::move(m_queue.front());
+				m_queue.pop_front();
+			}
+			job();
+		}
+	}
+
+	CompileSession* m_session;
+	std::unordered_map<int, int> m_handles; // slot -> handle, only used on the background thread
+
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::deque<std::function<void()>> m_queue;
+	std::unordered_map<int, std::shared_ptr<std::atomic<bool>>> m_slots;
+	bool m_isRunning;
+
+	std::thread m_thread;
+};
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "../Parser.h"
+#include "../ClosureEvaluator.h"
+#include "../PredicateEvaluator.h"
+
+// runs conditional breakpoint style predicates over a set of invocations and checks that
+// PredicateEvaluator finds the same invocations as evaluating each one on its own, also for
+// the conjuncts that index behind a guard (out of range indices read 0)
+static const char* corpus[] = {
+	"float(i) * 2.0 + 1.0 < 9.0 && v[i] > 0.5",
+	"i < 4 && v[i] > 0.5 && x > 0.25",
+	"length(v) > 1.0 && i >= 0 && i < 4 && v[3 - i] < 0.8",
+	"x > 0.5 && i % 2 == 0",
+	"sin(x * 10.0) > 0.0 && x < 0.75 && i != 3",
+};
+
+int main()
+{
+	const int count = 10;
+	int failures = 0;
+
+	expr::Value v;
+	v.Type = expr::ValueType::Float4;
+	v.Float[0] = 0.9f; v.Float[1] = 0.2f; v.Float[2] = 0.7f; v.Float[3] = 0.6f;
+
+	std::vector<expr::Value> is(count), xs(count);
+	for (int i = 0; i < count; i++) {
+		is[i] = expr::MakeInt(i);
+		xs[i] = expr::MakeFloat(i / (float)count);
+	}
+
+	for (const char* e : corpus) {
+		expr::Parser parser(e, strlen(e));
+		expr::Node* root = parser.Parse();
+		if (parser.Error()) {
+			printf("%s: %s\n", e, parser.ErrorMessage().c_str());
+			failures++;
+			continue;
+		}
+
+		std::vector<int> expected;
+		expr::ClosureEvaluator reference(root);
+		reference.SetVariable("v", v);
+		bool success = true;
+		for (int i = 0; i < count && success; i++) {
+			expr::Value ret;
+			reference.SetVariable("i", is[i]);
+			reference.SetVariable("x", xs[i]);
+			success = reference.Evaluate(ret);
+			if (success && ret.Bool[0])
+				expected.push_back(i);
+		}
+
+		std::vector<int> matches;
+		expr::PredicateEvaluator eval(root);
+		eval.SetVariable("v", v);
+		eval.BindVariable("i", is.data(), count);
+		eval.BindVariable("x", xs.data(), count);
+		eval.SetBatchSize(4);
+		success = success && eval.Find(count, matches) && matches == expected;
+
+		printf("%-55s %d match(es) %s\n", e, (int)matches.size(), success ? "ok" : "MISMATCH");
+		if (eval.Error())
+			printf("    %s\n", eval.ErrorMessage().c_str());
+		failures += !success;
+	}
+
+	printf("%d failure(s)\n", failures);
+	return failures != 0;
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "../Parser.h"
+#include "../Optimizer.h"
+#include "../BatchEvaluator.h"
+
+// evaluates an expression for every pixel of a small "frame" and prints the
+// hottest subexpressions together with how many lanes were active in them
+int main()
+{
+	const char* e = "length(uv - vec2(0.5)) < 0.25 ? sin(uv.x * 40.0) * cos(uv.y * 40.0) : pow(uv.x * uv.y, 2.2)";
+	const int width = 64, height = 64;
+	const int laneCount = 32;
+
+	expr::Parser parser(e, strlen(e));
+	expr::Node* root = parser.Parse();
+	if (parser.Error()) {
+		printf("%s\n", parser.ErrorMessage().c_str());
+		return 1;
+	}
+
+	expr::Optimizer optimizer(parser);
+	root = optimizer.EliminateCommonSubexpressions(optimizer.Fold(root));
+
+	expr::BatchEvaluator eval(root);
+	eval.SetProfiling(true);
+
+	expr::Value uv[laneCount], out[laneCount];
+	for (int i = 0; i < width * height; i += laneCount) {
+		for (int l = 0; l < laneCount; l++) {
+			uv[l].Type = expr::ValueType::Float2;
+			uv[l].Float[0] = ((i + l) % width + 0.5f) / width;
+			uv[l].Float[1] = ((i + l) / width + 0.5f) / height;
+		}
+
+		eval.SetVariable("uv", uv, laneCount);
+		if (!eval.Evaluate(laneCount, out)) {
+			printf("%s\n", eval.ErrorMessage().c_str());
+			return 1;
+		}
+	}
+
+	std::vector<expr::NodeProfile> profile;
+	eval.GetProfile(profile);
+
+	double total = profile.empty() ? 0.0 : profile[0].InclusiveTime;
+	printf("%s\n", e);
+	for (const expr::NodeProfile& node : profile) {
+		if (node.SourceEnd <= node.SourceStart || node.ExclusiveTime < total * 0.05)
+			continue;
+
+		// underline the subexpression
+		printf("%*s%s\n", (int)node.SourceStart, "", std::string(node.SourceEnd - node.SourceStart, '^').c_str());
+		printf("%*s%.1f%% self, %.1f%% total, %zu batches, %.0f%% lanes active\n\n", (int)node.SourceStart, "",
+			node.ExclusiveTime / total * 100.0, node.InclusiveTime / total * 100.0, node.Count, node.GetOccupancy() * 100.0);
+	}
+
+	parser.Clear();
+	return 0;
+}
\ No newline at end of file
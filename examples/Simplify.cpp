@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "../Parser.h"
+#include "../Optimizer.h"
+#include "../Interpreter.h"
+
+// runs the algebraic simplifier over a corpus of expressions and checks that the
+// results stay the same (within tolerance) for a set of inputs
+static const char* corpus[] = {
+	"x * 1.0 + 0.0",
+	"1.0 * (x + y) - 0.0",
+	"v * 1.0 + w * 0.0",
+	"pow(x, 2.0) + pow(v, 2.0).y",
+	"pow(abs(x), 0.5) + pow(abs(y) + 1.0, -0.5)",
+	"pow(abs(y) + 1.0, -1.0) * pow(z, 3.0)",
+	"x / 4.0 + y / 3.0",
+	"v / 2.0 + w / vec3(4.0, 8.0, 0.5)",
+	"x * y + z",
+	"z + v.x * w.y",
+	"v * w + v",
+	"i * 1 + i * 0 + (i + 0)",
+	"-(-x) + float(!!(x > y))",
+	"x / 1.0 + (v * 1).z",
+	"dot(v, w) / 10.0 + length(v * 1.0) * 1.0",
+	"mix(x, y, 0.25) * 2.0 / 5.0",
+	"(x * 0.5 + y * 0.25) * z + 1.0 / (abs(x) + 1.0)",
+	"float((false && bvec2(x > y, true)).y) + float((true || bvec3(false)).z)",
+	"float(false && v.x > 0.0) + (true ? 1 : 2.0) * x + (false ? v : w).y",
+	"(true ? i : 3) + int(false ? 1 : 2.5)",
+	"(-2147483647 - 1) / -1 + (-2147483647 - 1) % -1 + (i << 33) + (i >> -1) + (1 << 40)",
+};
+
+static bool compare(const expr::Value& a, const expr::Value& b, float tolerance)
+{
+	if (a.Type != b.Type)
+		return false;
+
+	for (int i = 0; i < expr::GetComponentCount(a.Type); i++) {
+		if (expr::GetBaseType(a.Type) != expr::ValueType::Float) {
+			if (a.Uint[i] != b.Uint[i]) return false;
+		} else if (fabsf(a.Float[i] - b.Float[i]) > tolerance * fmaxf(1.0f, fabsf(a.Float[i])))
+			return false;
+	}
+	return true;
+}
+
+static void setVariables(expr::Evaluator& eval, int seed)
+{
+	float s = (float)seed;
+	expr::Value v, w;
+	v.Type = w.Type = expr::ValueType::Float3;
+	for (int i = 0; i < 3; i++) {
+		v.Float[i] = sinf(s * 1.3f + i) * 4.0f;
+		w.Float[i] = cosf(s * 0.7f + i * 2.0f) * 3.0f;
+	}
+
+	eval.SetVariable("x", expr::MakeFloat(sinf(s) * 10.0f));
+	eval.SetVariable("y", expr::MakeFloat(cosf(s * 2.0f) * 5.0f));
+	eval.SetVariable("z", expr::MakeFloat(s * 0.125f - 1.0f));
+	eval.SetVariable("i", expr::MakeInt(seed * 7 - 20));
+	eval.SetVariable("v", v);
+	eval.SetVariable("w", w);
+}
+
+int main()
+{
+	int failures = 0;
+	const expr::MathMode modes[] = { expr::MathMode::Precise, expr::MathMode::Fast };
+	const float tolerances[] = { 1e-6f, 1e-5f };
+
+	for (int m = 0; m < 2; m++) {
+		for (const char* e : corpus) {
+			size_t len = strlen(e);
+			expr::Parser reference(e, len), simplified(e, len);
+			expr::Node* refRoot = reference.Parse();
+			expr::Node* root = simplified.Parse();
+
+			expr::Optimizer optimizer(simplified);
+			optimizer.SetVariableType("x", expr::ValueType::Float);
+			optimizer.SetVariableType("y", expr::ValueType::Float);
+			optimizer.SetVariableType("z", expr::ValueType::Float);
+			optimizer.SetVariableType("i", expr::ValueType::Int);
+			optimizer.SetVariableType("v", expr::ValueType::Float3);
+			optimizer.SetVariableType("w", expr::ValueType::Float3);
+			root = optimizer.Simplify(optimizer.Fold(root), modes[m]);
+
+			expr::Interpreter refEval(refRoot), eval(root);
+			bool success = true;
+			for (int seed = 0; seed < 16 && success; seed++) {
+				expr::Value a, b;
+				setVariables(refEval, seed);
+				setVariables(eval, seed);
+				success = refEval.Evaluate(a) && eval.Evaluate(b) && compare(a, b, tolerances[m]);
+			}
+
+			printf("[%s] %-50s %s\n", m == 0 ? "precise" : "fast", e, success ? "ok" : "MISMATCH");
+			failures += !success;
+
+			reference.Clear();
+			simplified.Clear();
+		}
+	}
+
+	printf("%d failure(s)\n", failures);
+	return failures != 0;
+}
\ No newline at end of file
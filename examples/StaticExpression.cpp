@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "../Parser.h"
+#include "../Interpreter.h"
+#include "../ClosureEvaluator.h"
+#include "../StaticExpression.h"
+
+// evaluates expressions that were parsed at compile time and checks that the results (type
+// and value) match the native evaluators, which parse the same source at run time
+static constexpr char src0[] = "clamp(x * 0.5 + y, 0.0, 1.0)";
+static constexpr char src1[] = "x < y && y > 0.5 || !(x == y)";
+static constexpr char src2[] = "smoothstep(0.0, 1.0, x) * mix(x, y, 0.25)";
+static constexpr char src3[] = "abs(int(x * 10.0) - 3) + min(2, int(y * 4.0))";
+static constexpr char src4[] = "(int)(x * 100.0) % 7 ^ 0x0F";
+static constexpr char src5[] = "true & (x > 0.5)";
+static constexpr char src6[] = "-true + 3 * (y >= x)";
+static constexpr char src7[] = "uint(x * 10.0) * 3 + max(y, 1)";
+static constexpr char src8[] = "atan(y, x) + fract(x * 3.7) + 1e-3";
+static constexpr char src9[] = "0.1 + 16777217.0 + 7.0e-39 * x + 1.000000059604644775390625";
+static constexpr char src10[] = "step(0.5, x) + sign(y - 0.5) + degrees(radians(x))";
+static constexpr char src11[] = "pow(x, 2.2) * inversesqrt(y + 1.0)";
+static constexpr char src12[] = "7 / 2 + int(x) % 3 << 2";
+static constexpr char src13[] = "x > y ? x : y   ";
+static constexpr char src14[] = "x > y ? 1 : 2.0";
+
+static constexpr auto tree0 = expr::ParseStatic(src0);
+static constexpr auto tree1 = expr::ParseStatic(src1);
+static constexpr auto tree2 = expr::ParseStatic(src2);
+static constexpr auto tree3 = expr::ParseStatic(src3);
+static constexpr auto tree4 = expr::ParseStatic(src4);
+static constexpr auto tree5 = expr::ParseStatic(src5);
+static constexpr auto tree6 = expr::ParseStatic(src6);
+static constexpr auto tree7 = expr::ParseStatic(src7);
+static constexpr auto tree8 = expr::ParseStatic(src8);
+static constexpr auto tree9 = expr::ParseStatic(src9);
+static constexpr auto tree10 = expr::ParseStatic(src10);
+static constexpr auto tree11 = expr::ParseStatic(src11);
+static constexpr auto tree12 = expr::ParseStatic(src12);
+static constexpr auto tree13 = expr::ParseStatic(src13);
+static constexpr auto tree14 = expr::ParseStatic(src14);
+
+// expressions the evaluators reject have to be rejected at compile time too
+static_assert(expr::ParseStatic("x ? 1.0 : 2.0").Error != nullptr, "float condition");
+static_assert(expr::ParseStatic("~true").Error != nullptr, "~ on a bool");
+static_assert(expr::ParseStatic("1.5 & 2").Error != nullptr, "bitwise float");
+
+static bool isSame(const expr::Value& a, const expr::Value& b)
+{
+	if (a.Type != b.Type)
+		return false;
+	switch (expr::GetBaseType(a.Type)) {
+	case expr::ValueType::Float: return memcmp(&a.Float[0], &b.Float[0], sizeof(float)) == 0 || (isnan(a.Float[0]) && isnan(b.Float[0]));
+	case expr::ValueType::Bool: return a.Bool[0] == b.Bool[0];
+	default: return a.Int[0] == b.Int[0];
+	}
+}
+
+template<typename T>
+static expr::Value makeValue(T val)
+{
+	if constexpr (std::is_same<T, float>::value) return expr::MakeFloat(val);
+	else if constexpr (std::is_same<T, int>::value) return expr::MakeInt(val);
+	else if constexpr (std::is_same<T, unsigned int>::value) return expr::MakeUint(val);
+	else return expr::MakeBool(val);
+}
+
+template<const auto& Tree>
+static int check(const char* source)
+{
+	expr::Parser parser(source, strlen(source));
+	expr::Node* root = parser.Parse();
+	if (parser.Error()) {
+		printf("%s: %s\n", source, parser.ErrorMessage().c_str());
+		return 1;
+	}
+
+	expr::Interpreter interpreter(root);
+	expr::ClosureEvaluator closure(root);
+
+	const float inputs[] = { 0.0f, 0.25f, 0.5f, 0.75f, 1.3f, -2.1f };
+	int failures = 0;
+	for (float x : inputs) {
+		for (float y : inputs) {
+			float vars[expr::StaticExpression<Tree>::VariableCount + 1] = { 0.0f };
+			for (int i = 0; i < Tree.VariableCount; i++) {
+				std::string name(Tree.GetVariableName(i));
+				float value = name[0] == 'x' ? x : y;
+				vars[i] = value;
+				interpreter.SetVariable(name, expr::MakeFloat(value));
+				closure.SetVariable(name, expr::MakeFloat(value));
+			}
+
+			expr::Value expected, compiled;
+			expr::Value actual = makeValue(expr::StaticExpression<Tree>::EvaluateArray(vars));
+			if (!interpreter.Evaluate(expected) || !closure.Evaluate(compiled) || !isSame(actual, expected) || !isSame(actual, compiled))
+				failures++;
+		}
+	}
+
+	printf("%-60s %s\n", source, failures == 0 ? "ok" : "MISMATCH");
+	parser.Clear();
+	return failures != 0;
+}
+
+int main()
+{
+	int failures = 0;
+	failures += check<tree0>(src0);
+	failures += check<tree1>(src1);
+	failures += check<tree2>(src2);
+	failures += check<tree3>(src3);
+	failures += check<tree4>(src4);
+	failures += check<tree5>(src5);
+	failures += check<tree6>(src6);
+	failures += check<tree7>(src7);
+	failures += check<tree8>(src8);
+	failures += check<tree9>(src9);
+	failures += check<tree10>(src10);
+	failures += check<tree11>(src11);
+	failures += check<tree12>(src12);
+	failures += check<tree13>(src13);
+	failures += check<tree14>(src14);
+
+	printf("%d failure(s)\n", failures);
+	return failures != 0;
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <vector>
+#include <string>
+
+#include "../WatchManager.h"
+
+// steps through a small debugger session and checks that WatchManager only evaluates the
+// watches whose inputs changed, and that removed watches leave nothing behind
+static int failures = 0;
+
+static void check(bool success, const char* what)
+{
+	printf("%-60s %s\n", what, success ? "ok" : "FAILED");
+	failures += !success;
+}
+static bool hasValue(expr::WatchManager& watches, int handle, float expected)
+{
+	expr::Value val;
+	return watches.GetValue(handle, val) && val.Type == expr::ValueType::Float && val.Float[0] == expected;
+}
+
+int main()
+{
+	expr::WatchManager watches;
+	watches.SetVariable("a", expr::MakeFloat(1.0f));
+	watches.SetVariable("b", expr::MakeFloat(2.0f));
+	watches.SetVariable("c", expr::MakeFloat(3.0f));
+
+	int ab = watches.Add("a + b");
+	int bc = watches.Add("b * c");
+	int c = watches.Add("c - 1.0");
+	check(watches.Add("a +") == -1, "invalid expression isn't added");
+
+	// new watches start out dirty
+	std::vector<int> updated;
+	watches.Update(updated);
+	check(updated == std::vector<int>({ ab, bc, c }), "first update evaluates every watch, sorted");
+	check(hasValue(watches, ab, 3.0f) && hasValue(watches, bc, 6.0f) && hasValue(watches, c, 2.0f), "values after the first update");
+
+	updated.clear();
+	watches.Update(updated);
+	check(updated.empty(), "nothing is dirty after an update");
+
+	// same value again doesn't mark anything
+	watches.SetVariable("a", expr::MakeFloat(1.0f));
+	watches.SetVariable("c", expr::MakeFloat(3.0f));
+	watches.Update(updated);
+	check(updated.empty(), "unchanged values are skipped");
+
+	// only the watches that read the variable get evaluated
+	watches.SetVariable("a", expr::MakeFloat(5.0f));
+	watches.Update(updated);
+	check(updated == std::vector<int>({ ab }), "only the watch that reads a is re-evaluated");
+	check(hasValue(watches, ab, 7.0f) && hasValue(watches, bc, 6.0f), "values after changing a");
+
+	updated.clear();
+	watches.SetVariable("b", expr::MakeFloat(4.0f));
+	watches.SetVariable("b", expr::MakeFloat(3.0f)); // both changes end up in one evaluation
+	watches.Update(updated);
+	check(updated == std::vector<int>({ ab, bc }), "watches that read b are re-evaluated once");
+	check(hasValue(watches, ab, 8.0f) && hasValue(watches, bc, 9.0f) && hasValue(watches, c, 2.0f), "values after changing b");
+
+	// a variable of another type is a change even if the bits match
+	updated.clear();
+	watches.SetVariable("c", expr::MakeInt(3));
+	watches.Update(updated);
+	check(updated == std::vector<int>({ bc, c }), "type change marks the readers as dirty");
+
+	// watches that read several of the variables are only reported once
+	std::vector<int> affected = { 42 };
+	watches.GetAffected({ "a", "b", "c", "unknown" }, affected);
+	check(affected == std::vector<int>({ 42, ab, bc, c }), "GetAffected appends every watch once");
+	affected.clear();
+	watches.GetAffected({ "b", "b" }, affected);
+	check(affected == std::vector<int>({ ab, bc }), "GetAffected ignores repeated variables");
+
+	// removing a watch takes it out of the readers of its variables
+	watches.Remove(ab);
+	watches.Remove(ab);
+	affected.clear();
+	watches.GetAffected({ "a", "b" }, affected);
+	check(affected == std::vector<int>({ bc }), "removed watch isn't affected anymore");
+	check(!watches.IsWatched("a") && watches.IsWatched("b"), "variables without readers are dropped");
+	check(watches.GetVariables(ab).empty(), "removed watch has no variables");
+
+	updated.clear();
+	watches.SetVariable("a", expr::MakeFloat(6.0f));
+	watches.Update(updated);
+	check(updated.empty(), "changing a variable nobody reads evaluates nothing");
+
+	// watches added later pick up the current values
+	int late = watches.Add("a * 2.0");
+	updated.clear();
+	watches.Update(updated);
+	check(updated == std::vector<int>({ late }) && hasValue(watches, late, 12.0f), "new watch uses the current values");
+
+	printf("%d failure(s)\n", failures);
+	return failures != 0;
+}
\ No newline at end of file